@@ -0,0 +1,312 @@
+/*!
+ *  \file   AsyncTreeWriter.cc
+ *  \brief  Hands completed event records of a TreeColumnRegistry to a
+ *          background thread which fills, compresses and writes the trees
+ */
+#include "AsyncTreeWriter.h"
+
+#include <TROOT.h>
+#include <TTree.h>
+
+#include <algorithm>
+#include <iostream>
+
+//____________________________________________________________________________..
+AsyncTreeWriter::~AsyncTreeWriter()
+{
+  flush();
+}
+
+//____________________________________________________________________________..
+void AsyncTreeWriter::setDepth(unsigned int depth)
+{
+  if (!m_outputs.empty())
+  {
+    // the records and the writer thread of the booked outputs are sized for the current depth
+    if (depth != m_depth)
+    {
+      std::cout << "AsyncTreeWriter::setDepth - outputs are already booked with depth " << m_depth
+                << ", depth " << depth << " is ignored; set it before Init" << std::endl;
+    }
+    return;
+  }
+  m_depth = depth;
+}
+
+//____________________________________________________________________________..
+int AsyncTreeWriter::addTree(TTree *tree, unsigned int treeBit, unsigned int collections)
+{
+  m_outputs.emplace_back();
+  Output &output = m_outputs.back();
+  output.tree = tree;
+  for (const auto &column : bind(output, treeBit, collections))
+  {
+    TreeColumnRegistry::createBranch(tree, *column.first, column.second);
+  }
+  return m_outputs.size() - 1;
+}
+
+//____________________________________________________________________________..
+int AsyncTreeWriter::addNTuple(const std::string &name, TFile *file, unsigned int treeBit, unsigned int collections)
+{
+  if (!RNTupleSink::available())
+  {
+    return -1;
+  }
+  m_outputs.emplace_back();
+  Output &output = m_outputs.back();
+  output.ntuple.reset(new RNTupleSink(name, file));
+  for (const auto &column : bind(output, treeBit, collections))
+  {
+    output.ntuple->addColumn(*column.first, column.second);
+  }
+  output.ntuple->open();
+  return m_outputs.size() - 1;
+}
+
+//____________________________________________________________________________..
+std::vector<std::pair<const TreeColumnRegistry::Column *, void *>> AsyncTreeWriter::bind(Output &output, unsigned int treeBit, unsigned int collections)
+{
+  std::vector<std::pair<const TreeColumnRegistry::Column *, void *>> bound;
+  if (m_depth == 0)
+  {
+    for (const auto &column : m_columns.columns())
+    {
+      if (selected(column, treeBit, collections)) bound.push_back({&column, column.address});
+    }
+    return bound;
+  }
+
+  std::size_t array_size = 0;
+  for (const auto &column : m_columns.columns())
+  {
+    if (!selected(column, treeBit, collections)) continue;
+    if (sharedVector(column))
+    {
+      std::cout << "AsyncTreeWriter::bind - vector column " << column.name
+                << " is already bound to another output, the later commit would write it empty; not booked" << std::endl;
+      continue;
+    }
+    bound.push_back({&column, nullptr});
+    switch (column.type)
+    {
+    case TreeColumnRegistry::kFloatVector:
+      output.float_vectors.push_back(static_cast<std::vector<float> *>(column.address));
+      break;
+    case TreeColumnRegistry::kIntVector:
+      output.int_vectors.push_back(static_cast<std::vector<int> *>(column.address));
+      break;
+    case TreeColumnRegistry::kFloatScalar:
+      output.float_scalars.push_back(static_cast<float *>(column.address));
+      break;
+    case TreeColumnRegistry::kIntScalar:
+      output.int_scalars.push_back(static_cast<int *>(column.address));
+      break;
+    case TreeColumnRegistry::kFloatArray:
+      output.float_arrays.push_back({static_cast<float *>(column.address), column.size});
+      array_size += column.size;
+      break;
+    }
+  }
+
+  // size every record once; the bound addresses stay valid because nothing is resized afterwards
+  output.records.resize(m_depth + 1);
+  for (auto &record : output.records)
+  {
+    record.float_vectors.resize(output.float_vectors.size());
+    record.int_vectors.resize(output.int_vectors.size());
+    record.float_scalars.resize(output.float_scalars.size());
+    record.int_scalars.resize(output.int_scalars.size());
+    record.float_arrays.resize(array_size);
+  }
+  output.bound = std::move(output.records.back());
+  output.records.pop_back();
+  for (unsigned int i = 0; i < m_depth; i++)
+  {
+    output.free_records.push_back(i);
+  }
+
+  std::size_t ifv = 0, iiv = 0, ifs = 0, iis = 0, offset = 0;
+  for (auto &column : bound)
+  {
+    switch (column.first->type)
+    {
+    case TreeColumnRegistry::kFloatVector: column.second = &output.bound.float_vectors[ifv++]; break;
+    case TreeColumnRegistry::kIntVector: column.second = &output.bound.int_vectors[iiv++]; break;
+    case TreeColumnRegistry::kFloatScalar: column.second = &output.bound.float_scalars[ifs++]; break;
+    case TreeColumnRegistry::kIntScalar: column.second = &output.bound.int_scalars[iis++]; break;
+    case TreeColumnRegistry::kFloatArray:
+      column.second = output.bound.float_arrays.data() + offset;
+      offset += column.first->size;
+      break;
+    }
+  }
+
+  if (!m_thread.joinable() && !m_stop)
+  {
+    // the writer thread fills while the next event is reconstructed
+    ROOT::EnableThreadSafety();
+    m_thread = std::thread(&AsyncTreeWriter::run, this);
+  }
+  return bound;
+}
+
+//____________________________________________________________________________..
+bool AsyncTreeWriter::sharedVector(const TreeColumnRegistry::Column &column) const
+{
+  for (const auto &output : m_outputs)
+  {
+    if (column.type == TreeColumnRegistry::kFloatVector &&
+        std::find(output.float_vectors.begin(), output.float_vectors.end(), column.address) != output.float_vectors.end()) return true;
+    if (column.type == TreeColumnRegistry::kIntVector &&
+        std::find(output.int_vectors.begin(), output.int_vectors.end(), column.address) != output.int_vectors.end()) return true;
+  }
+  return false;
+}
+
+//____________________________________________________________________________..
+bool AsyncTreeWriter::selected(const TreeColumnRegistry::Column &column, unsigned int treeBit, unsigned int collections)
+{
+  if (!(column.trees & treeBit)) return false;
+  return column.collection < 0 || (collections & (1U << column.collection));
+}
+
+//____________________________________________________________________________..
+void AsyncTreeWriter::commit(int id)
+{
+  Output &output = m_outputs[id];
+  if (m_depth == 0)
+  {
+    if (fill(output) < 0) m_fill_errors++;
+    return;
+  }
+  if (!m_thread.joinable())
+  {
+    // after flush() every record is free again
+    stage(output, output.records[0]);
+    write(output, output.records[0]);
+    return;
+  }
+
+  unsigned int slot = 0;
+  {
+    std::unique_lock<std::mutex> lock(m_mutex);
+    if (output.free_records.empty())
+    {
+      m_stalls++;
+      m_released.wait(lock, [&output] { return !output.free_records.empty(); });
+    }
+    slot = output.free_records.back();
+    output.free_records.pop_back();
+  }
+
+  // the record is owned by this thread until it is queued
+  stage(output, output.records[slot]);
+
+  {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    m_queue.push_back({&output, slot});
+    m_max_queued = std::max(m_max_queued, m_queue.size());
+  }
+  m_queued.notify_one();
+}
+
+//____________________________________________________________________________..
+void AsyncTreeWriter::flush()
+{
+  {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    m_stop = true;
+  }
+  m_queued.notify_one();
+  if (m_thread.joinable())
+  {
+    m_thread.join();
+  }
+  for (auto &output : m_outputs)
+  {
+    if (output.ntuple) output.ntuple->close();
+  }
+}
+
+//____________________________________________________________________________..
+int AsyncTreeWriter::fill(Output &output)
+{
+  return output.ntuple ? output.ntuple->fill() : output.tree->Fill();
+}
+
+//____________________________________________________________________________..
+void AsyncTreeWriter::stage(Output &output, Record &record)
+{
+  for (std::size_t i = 0; i < output.float_vectors.size(); i++)
+  {
+    record.float_vectors[i].swap(*output.float_vectors[i]);
+  }
+  for (std::size_t i = 0; i < output.int_vectors.size(); i++)
+  {
+    record.int_vectors[i].swap(*output.int_vectors[i]);
+  }
+  for (std::size_t i = 0; i < output.float_scalars.size(); i++)
+  {
+    record.float_scalars[i] = *output.float_scalars[i];
+  }
+  for (std::size_t i = 0; i < output.int_scalars.size(); i++)
+  {
+    record.int_scalars[i] = *output.int_scalars[i];
+  }
+  float *dest = record.float_arrays.data();
+  for (const auto &array : output.float_arrays)
+  {
+    dest = std::copy(array.first, array.first + array.second, dest);
+  }
+}
+
+//____________________________________________________________________________..
+void AsyncTreeWriter::write(Output &output, Record &record)
+{
+  // swapping the outer vectors would move the buffers the branches point at, so swap element-wise
+  for (std::size_t i = 0; i < record.float_vectors.size(); i++)
+  {
+    output.bound.float_vectors[i].swap(record.float_vectors[i]);
+  }
+  for (std::size_t i = 0; i < record.int_vectors.size(); i++)
+  {
+    output.bound.int_vectors[i].swap(record.int_vectors[i]);
+  }
+  std::copy(record.float_scalars.begin(), record.float_scalars.end(), output.bound.float_scalars.begin());
+  std::copy(record.int_scalars.begin(), record.int_scalars.end(), output.bound.int_scalars.begin());
+  std::copy(record.float_arrays.begin(), record.float_arrays.end(), output.bound.float_arrays.begin());
+
+  if (fill(output) < 0)
+  {
+    m_fill_errors++;
+  }
+
+  // the record now holds the previous event; empty it but keep the capacity for the producer
+  for (auto &column : record.float_vectors) column.clear();
+  for (auto &column : record.int_vectors) column.clear();
+}
+
+//____________________________________________________________________________..
+void AsyncTreeWriter::run()
+{
+  std::unique_lock<std::mutex> lock(m_mutex);
+  while (true)
+  {
+    m_queued.wait(lock, [this] { return m_stop || !m_queue.empty(); });
+    if (m_queue.empty())
+    {
+      // stopped and drained
+      return;
+    }
+    auto job = m_queue.front();
+    m_queue.pop_front();
+    lock.unlock();
+
+    write(*job.first, job.first->records[job.second]);
+
+    lock.lock();
+    job.first->free_records.push_back(job.second);
+    m_released.notify_all();
+  }
+}
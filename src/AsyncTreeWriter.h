@@ -0,0 +1,144 @@
+// Tell emacs that this is a C++ source
+//  -*- C++ -*-.
+/*!
+ *  \file   AsyncTreeWriter.h
+ *  \brief  Hands completed event records of a TreeColumnRegistry to a
+ *          background thread which fills, compresses and writes the trees
+ */
+
+#ifndef ASYNCTREEWRITER_H
+#define ASYNCTREEWRITER_H
+
+#include "RNTupleSink.h"
+#include "TreeColumnRegistry.h"
+
+#include <condition_variable>
+#include <cstddef>
+#include <deque>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <utility>
+#include <vector>
+
+class TFile;
+class TTree;
+
+/*!
+ * Every tree added to the writer gets a bound record, which its branches
+ * point at, and depth spare records. commit() swaps the vector columns of
+ * the registry into a spare record and copies the scalars and fixed arrays,
+ * then queues it; the writer thread swaps the record into the bound one and
+ * calls TTree::Fill(). Swapping recycles the vector capacity in both
+ * directions, so no event data is copied. When all spare records of a tree
+ * are queued, commit() blocks until the writer has caught up.
+ *
+ * With a depth of 0 the branches point at the registry buffers and commit()
+ * is a plain TTree::Fill() on the calling thread. After commit() the vector
+ * columns of the tree are empty in the asynchronous mode; they are expected
+ * to be reset before the next event anyway.
+ *
+ * All outputs of one writer are filled from the same thread, so they may
+ * share a file. An output is either a TTree or an RNTuple of the same
+ * columns. flush() must be called before the trees are written and their
+ * file is closed; it also commits the RNTuples.
+ */
+class AsyncTreeWriter
+{
+ public:
+  enum OutputFormat
+  {
+    kTTree,
+    kRNTuple
+  };
+
+  explicit AsyncTreeWriter(TreeColumnRegistry &columns)
+    : m_columns(columns)
+  {
+  }
+  ~AsyncTreeWriter();
+
+  AsyncTreeWriter(const AsyncTreeWriter &) = delete;
+  AsyncTreeWriter &operator=(const AsyncTreeWriter &) = delete;
+
+  /// number of events which may wait for the writer thread per tree; 0 fills synchronously.
+  /// The depth is fixed by the first addTree()/addNTuple(), later changes are ignored with a warning
+  void setDepth(unsigned int depth);
+  unsigned int depth() const { return m_depth; }
+
+  /*!
+   * book the branches of the columns flagged with treeBit on tree; returns the id to commit() with.
+   * collections (bit 1 << collection) restricts the vector columns to some collections, scalars
+   * are always included; outputs sharing a registry must not share vector columns, with a
+   * nonzero depth a vector column already bound to another output is refused.
+   */
+  int addTree(TTree *tree, unsigned int treeBit, unsigned int collections = ~0U);
+
+  /// write the same columns as addTree() as RNTuple name in file; -1 if this ROOT has no RNTuple
+  int addNTuple(const std::string &name, TFile *file, unsigned int treeBit, unsigned int collections = ~0U);
+
+  /// hand the current content of the tree's columns over to be filled
+  void commit(int id);
+
+  /// fill everything still queued and stop the writer thread; later commits are synchronous
+  void flush();
+
+  /// number of commits which had to wait for a free record
+  std::size_t stalls() const { return m_stalls; }
+  std::size_t maxQueued() const { return m_max_queued; }
+  std::size_t fillErrors() const { return m_fill_errors; }
+
+ private:
+  struct Record
+  {
+    std::vector<std::vector<float>> float_vectors;
+    std::vector<std::vector<int>> int_vectors;
+    std::vector<float> float_scalars;
+    std::vector<int> int_scalars;
+    std::vector<float> float_arrays;  // all fixed arrays back to back
+  };
+
+  struct Output
+  {
+    TTree *tree = nullptr;
+    std::unique_ptr<RNTupleSink> ntuple;
+    // registry buffers of this tree, in registration order
+    std::vector<std::vector<float> *> float_vectors;
+    std::vector<std::vector<int> *> int_vectors;
+    std::vector<float *> float_scalars;
+    std::vector<int *> int_scalars;
+    std::vector<std::pair<float *, std::size_t>> float_arrays;
+
+    Record bound;
+    std::vector<Record> records;
+    std::vector<unsigned int> free_records;
+  };
+
+  std::vector<std::pair<const TreeColumnRegistry::Column *, void *>> bind(Output &output, unsigned int treeBit, unsigned int collections);
+  static bool selected(const TreeColumnRegistry::Column &column, unsigned int treeBit, unsigned int collections);
+  bool sharedVector(const TreeColumnRegistry::Column &column) const;
+  int fill(Output &output);
+  void stage(Output &output, Record &record);
+  void write(Output &output, Record &record);
+  void run();
+
+  TreeColumnRegistry &m_columns;
+  unsigned int m_depth = 0;
+
+  // deque: the branches of an output point into its bound record, which must not move
+  std::deque<Output> m_outputs;
+
+  std::mutex m_mutex;
+  std::condition_variable m_queued;
+  std::condition_variable m_released;
+  std::deque<std::pair<Output *, unsigned int>> m_queue;
+  bool m_stop = false;
+  std::thread m_thread;
+
+  std::size_t m_stalls = 0;
+  std::size_t m_max_queued = 0;
+  std::size_t m_fill_errors = 0;
+};
+
+#endif // ASYNCTREEWRITER_H
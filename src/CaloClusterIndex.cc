@@ -0,0 +1,175 @@
+/*!
+ *  \file   CaloClusterIndex.cc
+ *  \brief  Per-event phi x z binned index of calorimeter clusters for track matching
+ */
+#include "CaloClusterIndex.h"
+
+#include <math.h>
+#include <algorithm>
+#include <limits>
+
+namespace
+{
+    const unsigned int kNotBinned = std::numeric_limits<unsigned int>::max();
+    const int kMaxBins = 4096;
+
+    //! floor() of v as a bin number, saturated so that far away values cannot overflow an int
+    int floor_bin(double v)
+    {
+        if (v < -kMaxBins) return -kMaxBins - 2;
+        if (v > 2 * kMaxBins) return 2 * kMaxBins + 2;
+        return static_cast<int>(std::floor(v));
+    }
+}
+
+//____________________________________________________________________________..
+void CaloClusterIndex::clear()
+{
+    m_x.clear();
+    m_y.clear();
+    m_phi.clear();
+    m_eta.clear();
+    m_z.clear();
+    m_r.clear();
+    m_flags.clear();
+    m_cell_start.clear();
+    m_cell_items.clear();
+    m_cell_of.clear();
+}
+
+//____________________________________________________________________________..
+void CaloClusterIndex::add(float x, float y, float z, double radius, unsigned int flags)
+{
+    // keep these expressions in sync with the brute force matching they replace
+    float phi = atan2(y, x);
+    float eta = asinh(z/sqrt(x*x + y*y));
+    double R = sqrt(x*x + y*y);
+    float radius_scale = radius / R;
+    float z_at_radius = radius_scale*z;
+
+    m_x.push_back(x);
+    m_y.push_back(y);
+    m_phi.push_back(phi);
+    m_eta.push_back(eta);
+    m_z.push_back(z_at_radius);
+    m_r.push_back(R);
+    m_flags.push_back(flags);
+}
+
+//____________________________________________________________________________..
+void CaloClusterIndex::build(float dphi_cut, float dz_cut)
+{
+    m_dphi_cut = dphi_cut;
+    m_dz_cut = dz_cut;
+
+    m_nphi = 1;
+    m_phi_width = 2 * M_PI;
+    if (dphi_cut > 0)
+    {
+        m_nphi = std::clamp(static_cast<int>(2 * M_PI / dphi_cut), 1, kMaxBins);
+        m_phi_width = 2 * M_PI / m_nphi;
+    }
+
+    float z_max = 0;
+    m_z_min = 0;
+    bool first = true;
+    for (unsigned int i = 0; i < m_z.size(); i++)
+    {
+        if (!std::isfinite(m_phi[i]) || !std::isfinite(m_z[i])) continue;
+        if (first || m_z[i] < m_z_min) m_z_min = m_z[i];
+        if (first || m_z[i] > z_max) z_max = m_z[i];
+        first = false;
+    }
+
+    m_nz = 1;
+    m_z_width = std::max(z_max - m_z_min, 1.f);
+    if (dz_cut > 0)
+    {
+        double range = static_cast<double>(z_max) - m_z_min;
+        if (range / dz_cut < kMaxBins - 1)
+        {
+            m_nz = static_cast<int>(range / dz_cut) + 1;
+            m_z_width = dz_cut;
+        }
+        else
+        {
+            m_nz = kMaxBins;
+            m_z_width = range / (kMaxBins - 1);
+        }
+    }
+
+    // counting sort of the clusters into the cells, which keeps insertion order inside each cell
+    const unsigned int ncells = m_nphi * m_nz;
+    m_cell_start.assign(ncells + 1, 0);
+    m_cell_of.assign(m_phi.size(), kNotBinned);
+    for (unsigned int i = 0; i < m_phi.size(); i++)
+    {
+        if (!std::isfinite(m_phi[i]) || !std::isfinite(m_z[i])) continue;
+        m_cell_of[i] = phiBin(m_phi[i]) * m_nz + zBin(m_z[i]);
+        m_cell_start[m_cell_of[i] + 1]++;
+    }
+    for (unsigned int c = 0; c < ncells; c++)
+    {
+        m_cell_start[c + 1] += m_cell_start[c];
+    }
+    m_cell_items.resize(m_cell_start[ncells]);
+    std::vector<unsigned int> fill(m_cell_start.begin(), m_cell_start.end() - 1);
+    for (unsigned int i = 0; i < m_phi.size(); i++)
+    {
+        if (m_cell_of[i] == kNotBinned) continue;
+        m_cell_items[fill[m_cell_of[i]]++] = i;
+    }
+}
+
+//____________________________________________________________________________..
+int CaloClusterIndex::phiBin(float phi) const
+{
+    int bin = floor_bin((phi + M_PI) / m_phi_width);
+    bin %= m_nphi;
+    return bin < 0 ? bin + m_nphi : bin;
+}
+
+//____________________________________________________________________________..
+int CaloClusterIndex::zBin(float z) const
+{
+    return std::clamp(floor_bin((z - m_z_min) / m_z_width), 0, m_nz - 1);
+}
+
+//____________________________________________________________________________..
+void CaloClusterIndex::query(float phi, float z, std::vector<unsigned int> &out) const
+{
+    out.clear();
+    // fabs(d) < cut can never pass for a non-positive cut or a non-finite track position
+    if (m_cell_start.empty() || !(m_dphi_cut > 0) || !(m_dz_cut > 0)) return;
+    if (!std::isfinite(phi) || !std::isfinite(z)) return;
+
+    // one extra cell on each side absorbs the float rounding of the bin edges
+    int phi_lo = floor_bin((phi - m_dphi_cut + M_PI) / m_phi_width) - 1;
+    int phi_hi = floor_bin((phi + m_dphi_cut + M_PI) / m_phi_width) + 1;
+    if (phi_hi - phi_lo + 1 >= m_nphi)
+    {
+        phi_lo = 0;
+        phi_hi = m_nphi - 1;
+    }
+
+    int z_lo = floor_bin((z - m_dz_cut - m_z_min) / m_z_width) - 1;
+    int z_hi = floor_bin((z + m_dz_cut - m_z_min) / m_z_width) + 1;
+    if (z_hi < 0 || z_lo > m_nz - 1) return;
+    z_lo = std::max(z_lo, 0);
+    z_hi = std::min(z_hi, m_nz - 1);
+
+    for (int ip = phi_lo; ip <= phi_hi; ip++)
+    {
+        int wrapped = ((ip % m_nphi) + m_nphi) % m_nphi;
+        unsigned int first = m_cell_start[wrapped * m_nz + z_lo];
+        unsigned int last = m_cell_start[wrapped * m_nz + z_hi + 1];
+        if (first == last) continue;
+        out.insert(out.end(), m_cell_items.begin() + first, m_cell_items.begin() + last);
+    }
+
+    // each cell is in insertion order, but several cells have to be merged
+    if (out.size() > 1)
+    {
+        std::sort(out.begin(), out.end());
+    }
+}
@@ -0,0 +1,75 @@
+// Tell emacs that this is a C++ source
+//  -*- C++ -*-.
+/*!
+ *  \file   CaloClusterIndex.h
+ *  \brief  Per-event phi x z binned index of calorimeter clusters for track matching
+ */
+
+#ifndef CALOCLUSTERINDEX_H
+#define CALOCLUSTERINDEX_H
+
+#include <cstddef>
+#include <vector>
+
+/*!
+ * Cluster phi, eta and z projected to a reference radius are computed once
+ * per cluster (same float expressions as the former per-track loop) and
+ * stored in flat arrays. The clusters are bucketed in phi (wrapping around)
+ * and z with cells at least as wide as the matching window, so a track only
+ * needs to look at the neighbouring cells. query() returns a superset of the
+ * clusters inside the window, in insertion order; the caller applies the
+ * exact dphi/dz cut, which keeps the matches identical to a full scan.
+ */
+class CaloClusterIndex
+{
+ public:
+  CaloClusterIndex() = default;
+
+  /// drop all clusters, keeping the allocated capacity
+  void clear();
+
+  /// add a cluster; its position in the index is the number of clusters added before it
+  void add(float x, float y, float z, double radius, unsigned int flags = 0);
+
+  /// bin the clusters for a matching window of |dphi| < dphi_cut and |dz| < dz_cut
+  void build(float dphi_cut, float dz_cut);
+
+  /// indices of the clusters in the cells around (phi, z), sorted in insertion order
+  void query(float phi, float z, std::vector<unsigned int> &out) const;
+
+  std::size_t size() const { return m_phi.size(); }
+  float x(unsigned int i) const { return m_x[i]; }
+  float y(unsigned int i) const { return m_y[i]; }
+  float phi(unsigned int i) const { return m_phi[i]; }
+  float eta(unsigned int i) const { return m_eta[i]; }
+  float z(unsigned int i) const { return m_z[i]; }
+  double r(unsigned int i) const { return m_r[i]; }
+  unsigned int flags(unsigned int i) const { return m_flags[i]; }
+
+ private:
+  int phiBin(float phi) const;
+  int zBin(float z) const;
+
+  std::vector<float> m_x;
+  std::vector<float> m_y;
+  std::vector<float> m_phi;
+  std::vector<float> m_eta;
+  std::vector<float> m_z;
+  std::vector<double> m_r;
+  std::vector<unsigned int> m_flags;
+
+  float m_dphi_cut = 0;
+  float m_dz_cut = 0;
+  int m_nphi = 1;
+  int m_nz = 1;
+  float m_phi_width = 0;
+  float m_z_width = 0;
+  float m_z_min = 0;
+
+  // compressed cell storage: the clusters of cell c are m_cell_items[m_cell_start[c] .. m_cell_start[c+1])
+  std::vector<unsigned int> m_cell_start;
+  std::vector<unsigned int> m_cell_items;
+  std::vector<unsigned int> m_cell_of;
+};
+
+#endif // CALOCLUSTERINDEX_H
@@ -0,0 +1,105 @@
+/*!
+ *  \file   CaloGeometryLUT.cc
+ *  \brief  Channel-indexed calorimeter tower geometry, built once per run from the TOWERGEOM_* nodes
+ */
+#include "CaloGeometryLUT.h"
+
+#include <calobase/RawTowerDefs.h>
+#include <calobase/RawTowerGeom.h>
+#include <calobase/RawTowerGeomContainer.h>
+#include <calobase/TowerInfoDefs.h>
+
+#include <phool/PHCompositeNode.h>
+#include <phool/PHDataNode.h>
+#include <phool/PHNodeIterator.h>
+#include <phool/getClass.h>
+
+#include <cmath>
+#include <iostream>
+
+namespace
+{
+  const RawTowerDefs::CalorimeterId kCaloIds[CaloGeometryLUT::kNCalos] = {RawTowerDefs::CalorimeterId::CEMC, RawTowerDefs::CalorimeterId::HCALIN, RawTowerDefs::CalorimeterId::HCALOUT};
+}
+
+//____________________________________________________________________________..
+CaloGeometryLUT *CaloGeometryLUT::get(PHCompositeNode *topNode, const std::string &cemc_geometry)
+{
+  const std::string node_name = "CaloGeometryLUT_" + cemc_geometry;
+  CaloGeometryLUT *lut = findNode::getClass<CaloGeometryLUT>(topNode, node_name);
+  if (lut)
+  {
+    return lut;
+  }
+
+  const std::string geometry_names[kNCalos] = {cemc_geometry, "TOWERGEOM_HCALIN", "TOWERGEOM_HCALOUT"};
+  RawTowerGeomContainer *geometries[kNCalos];
+  for (int icalo = 0; icalo < kNCalos; icalo++)
+  {
+    geometries[icalo] = findNode::getClass<RawTowerGeomContainer>(topNode, geometry_names[icalo]);
+    if (!geometries[icalo])
+    {
+      std::cout << "CaloGeometryLUT::get - " << geometry_names[icalo] << " not found" << std::endl;
+      return nullptr;
+    }
+  }
+
+  lut = new CaloGeometryLUT;
+  for (int icalo = 0; icalo < kNCalos; icalo++)
+  {
+    lut->build(static_cast<Calo>(icalo), geometries[icalo]);
+  }
+
+  PHNodeIterator iter(topNode);
+  PHCompositeNode *runNode = dynamic_cast<PHCompositeNode *>(iter.findFirst("PHCompositeNode", "RUN"));
+  (runNode ? runNode : topNode)->addNode(new PHDataNode<CaloGeometryLUT>(lut, node_name));
+  return lut;
+}
+
+//____________________________________________________________________________..
+void CaloGeometryLUT::build(Calo calo, RawTowerGeomContainer *geometry)
+{
+  Table &t = m_tables[calo];
+  t.neta = geometry->get_etabins();
+  t.nphi = geometry->get_phibins();
+  const std::size_t nchannels = t.neta * t.nphi;
+  t.key.assign(nchannels, 0);
+  t.ieta.assign(nchannels, -1);
+  t.iphi.assign(nchannels, -1);
+  t.eta.assign(nchannels, NAN);
+  t.phi.assign(nchannels, NAN);
+  t.x.assign(nchannels, NAN);
+  t.y.assign(nchannels, NAN);
+  t.z.assign(nchannels, NAN);
+  t.channel_of_bin.assign(nchannels, -1);
+
+  for (std::size_t channel = 0; channel < nchannels; channel++)
+  {
+    // same key and bins as TowerInfoContainer::encode_key / getTowerEtaBin / getTowerPhiBin
+    const unsigned int key = calo == kCEMC ? TowerInfoDefs::encode_emcal(channel) : TowerInfoDefs::encode_hcal(channel);
+    const int ieta = TowerInfoDefs::getCaloTowerEtaBin(key);
+    const int iphi = TowerInfoDefs::getCaloTowerPhiBin(key);
+    t.key[channel] = key;
+    t.ieta[channel] = ieta;
+    t.iphi[channel] = iphi;
+    if (ieta >= 0 && ieta < t.neta && iphi >= 0 && iphi < t.nphi)
+    {
+      t.channel_of_bin[ieta * t.nphi + iphi] = channel;
+    }
+
+    RawTowerGeom *tower_geom = geometry->get_tower_geometry(RawTowerDefs::encode_towerid(kCaloIds[calo], ieta, iphi));
+    if (!tower_geom) continue;
+    t.eta[channel] = tower_geom->get_eta();
+    t.phi[channel] = tower_geom->get_phi();
+    t.x[channel] = tower_geom->get_center_x();
+    t.y[channel] = tower_geom->get_center_y();
+    t.z[channel] = tower_geom->get_center_z();
+  }
+}
+
+//____________________________________________________________________________..
+int CaloGeometryLUT::channelOfTowerId(Calo calo, unsigned int towerid) const
+{
+  if (RawTowerDefs::decode_caloid(towerid) != kCaloIds[calo]) return -1;
+  return channel(calo, RawTowerDefs::decode_index1(towerid), RawTowerDefs::decode_index2(towerid));
+}
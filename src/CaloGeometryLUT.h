@@ -0,0 +1,90 @@
+// Tell emacs that this is a C++ source
+//  -*- C++ -*-.
+/*!
+ *  \file   CaloGeometryLUT.h
+ *  \brief  Channel-indexed calorimeter tower geometry, built once per run from the TOWERGEOM_* nodes
+ */
+
+#ifndef CALOGEOMETRYLUT_H
+#define CALOGEOMETRYLUT_H
+
+#include <string>
+#include <vector>
+
+class PHCompositeNode;
+class RawTowerGeomContainer;
+
+/*!
+ * For CEMC, HCALIN and HCALOUT, dense arrays indexed by the TowerInfo
+ * channel hold the TowerInfo key, the eta/phi bins and the geometry of the
+ * tower (eta, phi and centre x, y, z), and a bin table maps (ieta, iphi)
+ * back to the channel. A tower lookup in the event loop is then one array
+ * index instead of encode_key -> getTowerEtaBin/PhiBin -> encode_towerid ->
+ * RawTowerGeomContainer map lookup.
+ *
+ * get() shares one table per CEMC geometry node between all modules via a
+ * PHDataNode under RUN. Channels without a geometry have NaN coordinates.
+ */
+class CaloGeometryLUT
+{
+ public:
+  enum Calo
+  {
+    kCEMC = 0,
+    kHCALIN = 1,
+    kHCALOUT = 2,
+    kNCalos = 3
+  };
+
+  struct Table
+  {
+    int neta = 0;
+    int nphi = 0;
+    std::vector<unsigned int> key;  // TowerInfo key
+    std::vector<int> ieta;
+    std::vector<int> iphi;
+    std::vector<float> eta;
+    std::vector<float> phi;
+    std::vector<float> x;
+    std::vector<float> y;
+    std::vector<float> z;
+    std::vector<int> channel_of_bin;  // [ieta * nphi + iphi]
+  };
+
+  CaloGeometryLUT() = default;
+
+  /// the table of the run from the node tree, built from TOWERGEOM_* on first use; nullptr if a geometry node is missing
+  static CaloGeometryLUT *get(PHCompositeNode *topNode, const std::string &cemc_geometry = "TOWERGEOM_CEMC");
+
+  /// fill the arrays of calo from geometry
+  void build(Calo calo, RawTowerGeomContainer *geometry);
+
+  const Table &table(Calo calo) const { return m_tables[calo]; }
+  std::size_t size(Calo calo) const { return m_tables[calo].key.size(); }
+
+  /// per channel tables; channel must be below size(calo), callers check it against their container size
+  unsigned int key(Calo calo, unsigned int channel) const { return m_tables[calo].key[channel]; }
+  int ieta(Calo calo, unsigned int channel) const { return m_tables[calo].ieta[channel]; }
+  int iphi(Calo calo, unsigned int channel) const { return m_tables[calo].iphi[channel]; }
+  float eta(Calo calo, unsigned int channel) const { return m_tables[calo].eta[channel]; }
+  float phi(Calo calo, unsigned int channel) const { return m_tables[calo].phi[channel]; }
+  float x(Calo calo, unsigned int channel) const { return m_tables[calo].x[channel]; }
+  float y(Calo calo, unsigned int channel) const { return m_tables[calo].y[channel]; }
+  float z(Calo calo, unsigned int channel) const { return m_tables[calo].z[channel]; }
+
+  /// channel of tower (ieta, iphi), -1 outside the calorimeter
+  int channel(Calo calo, int ieta, int iphi) const
+  {
+    const Table &t = m_tables[calo];
+    if (ieta < 0 || ieta >= t.neta || iphi < 0 || iphi >= t.nphi) return -1;
+    return t.channel_of_bin[ieta * t.nphi + iphi];
+  }
+
+  /// channel of a RawTowerDefs tower key, e.g. of a RawCluster tower; -1 if it is not in calo
+  int channelOfTowerId(Calo calo, unsigned int towerid) const;
+
+ private:
+  Table m_tables[kNCalos];
+};
+
+#endif // CALOGEOMETRYLUT_H
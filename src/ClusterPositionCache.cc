@@ -0,0 +1,29 @@
+/*!
+ *  \file   ClusterPositionCache.cc
+ *  \brief  Per-event cache of tracker cluster global positions
+ */
+#include "ClusterPositionCache.h"
+
+#include <trackbase/TrkrCluster.h>
+
+//____________________________________________________________________________..
+const Acts::Vector3 &ClusterPositionCache::get(TrkrDefs::cluskey key, TrkrCluster *cluster)
+{
+  auto iter = m_positions.find(key);
+  if (iter == m_positions.end())
+  {
+    iter = m_positions.emplace(key, m_geometry->getGlobalPosition(key, cluster)).first;
+  }
+  return iter->second;
+}
+
+//____________________________________________________________________________..
+Acts::Vector3 ClusterPositionCache::position(TrkrDefs::cluskey key, TrkrCluster *cluster) const
+{
+  auto iter = m_positions.find(key);
+  if (iter == m_positions.end())
+  {
+    return m_geometry->getGlobalPosition(key, cluster);
+  }
+  return iter->second;
+}
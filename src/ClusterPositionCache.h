@@ -0,0 +1,49 @@
+// Tell emacs that this is a C++ source
+//  -*- C++ -*-.
+/*!
+ *  \file   ClusterPositionCache.h
+ *  \brief  Per-event cache of tracker cluster global positions
+ */
+
+#ifndef CLUSTERPOSITIONCACHE_H
+#define CLUSTERPOSITIONCACHE_H
+
+#include <trackbase/ActsGeometry.h>
+#include <trackbase/TrkrDefs.h>
+
+#include <cstddef>
+#include <unordered_map>
+
+class TrkrCluster;
+
+/*!
+ * getGlobalPosition() is evaluated at most once per cluster key and event;
+ * every later request for the same key returns the stored position.
+ * clear() has to be called at the start of each event, since cluster keys
+ * are only unique within an event.
+ *
+ * position() never modifies the cache, so it may be called from several
+ * threads as long as nobody calls get() or clear() at the same time.
+ */
+class ClusterPositionCache
+{
+ public:
+  ClusterPositionCache() = default;
+
+  void setGeometry(ActsGeometry *geometry) { m_geometry = geometry; }
+  void clear() { m_positions.clear(); }
+  void reserve(std::size_t n) { m_positions.reserve(n); }
+  std::size_t size() const { return m_positions.size(); }
+
+  /// global position of the cluster, computed on first use in this event
+  const Acts::Vector3 &get(TrkrDefs::cluskey key, TrkrCluster *cluster);
+
+  /// stored position of the cluster, or a freshly computed one which is not stored
+  Acts::Vector3 position(TrkrDefs::cluskey key, TrkrCluster *cluster) const;
+
+ private:
+  ActsGeometry *m_geometry = nullptr;
+  std::unordered_map<TrkrDefs::cluskey, Acts::Vector3> m_positions;
+};
+
+#endif // CLUSTERPOSITIONCACHE_H
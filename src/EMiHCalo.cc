@@ -39,6 +39,7 @@
 #include <Acts/Geometry/TrackingGeometry.hpp>
 
 #include <CLHEP/Vector/ThreeVector.h>
+#include <algorithm>
 #include <math.h>
 #include <vector>
 
@@ -69,81 +70,95 @@ int EMiHCalo::Init(PHCompositeNode *topNode)
     std::cout << topNode << std::endl;
     std::cout << "EMiHCalo::Init(PHCompositeNode *topNode) Initializing" << std::endl;
     _outfile = new TFile(_outfilename.c_str(), "RECREATE");
+    m_file_options.applyToFile(_outfile);
     delete _tree;
 
+    // the dense and the sparse tower columns are never written together
+    unsigned int collections = ~0U;
+    if (!m_write_towers)
+    {
+        collections &= ~((1U << kTowerColumns) | (1U << kSparseTowerColumns) | (1U << kSparseFitColumns));
+    }
+    else if (m_sparse_towers)
+    {
+        collections &= ~(1U << kTowerColumns);
+        if (!m_sparse_fit_info) collections &= ~(1U << kSparseFitColumns);
+    }
+    else
+    {
+        collections &= ~((1U << kSparseTowerColumns) | (1U << kSparseFitColumns));
+    }
+
     _tree = new TTree("tree", "A tree with track/calo info");
-    _tree->Branch("_run_test", &_run_test);
-    // EMCal variables
-    _tree->Branch("_emcalgeo_id", &_emcalgeo_id);
-    _tree->Branch("_emcalgeo_phibin", &_emcalgeo_phibin);
-    _tree->Branch("_emcalgeo_etabin", &_emcalgeo_etabin);
-
-    _tree->Branch("_emcal_e", &_emcal_e);
-    _tree->Branch("_emcal_phi", &_emcal_phi);
-    _tree->Branch("_emcal_eta", &_emcal_eta);
-    _tree->Branch("_emcal_iphi", &_emcal_iphi);
-    _tree->Branch("_emcal_ieta", &_emcal_ieta);
-    _tree->Branch("_emcal_time", &_emcal_time);
-    _tree->Branch("_emcal_chi2", &_emcal_chi2);
-    _tree->Branch("_emcal_pedestal", &_emcal_pedestal);
-    // IHCAL variables
-    _tree->Branch("_ihcal_e", &_ihcal_e);
-    _tree->Branch("_ihcal_phi", &_ihcal_phi);
-    _tree->Branch("_ihcal_eta", &_ihcal_eta);
-    _tree->Branch("_ihcal_iphi", &_ihcal_iphi);
-    _tree->Branch("_ihcal_ieta", &_ihcal_ieta);
-    _tree->Branch("_ihcal_time", &_ihcal_time);
-    _tree->Branch("_ihcal_chi2", &_ihcal_chi2);
-    _tree->Branch("_ihcal_pedestal", &_ihcal_pedestal);
-    // OHCAL variables
-    _tree->Branch("_ohcal_e", &_ohcal_e);
-    _tree->Branch("_ohcal_phi", &_ohcal_phi);
-    _tree->Branch("_ohcal_eta", &_ohcal_eta);
-    _tree->Branch("_ohcal_iphi", &_ohcal_iphi);
-    _tree->Branch("_ohcal_ieta", &_ohcal_ieta);
-    _tree->Branch("_ohcal_time", &_ohcal_time);
-    _tree->Branch("_ohcal_chi2", &_ohcal_chi2);
-    _tree->Branch("_ohcal_pedestal", &_ohcal_pedestal);
-
-    // EMCal cluster information
-    _tree->Branch("_emcal_cluster_id", &_emcal_cluster_id);
-    _tree->Branch("_emcal_cluster_e", &_emcal_cluster_e);
-    _tree->Branch("_emcal_cluster_phi", &_emcal_cluster_phi);
-    _tree->Branch("_emcal_cluster_eta", &_emcal_cluster_eta);
-    _tree->Branch("_emcal_cluster_x", &_emcal_cluster_x);
-    _tree->Branch("_emcal_cluster_y", &_emcal_cluster_y);
-    _tree->Branch("_emcal_cluster_z", &_emcal_cluster_z);
-    _tree->Branch("_emcal_cluster_R", &_emcal_cluster_R);
-    _tree->Branch("_emcal_cluster_ecore", &_emcal_cluster_ecore);
-    _tree->Branch("_emcal_cluster_chi2", &_emcal_cluster_chi2);
-    _tree->Branch("_emcal_cluster_prob", &_emcal_cluster_prob);
-    // EMCal full cluster corrections
-    _tree->Branch("_emcal_clusfull_e", &_emcal_clusfull_e);
-    _tree->Branch("_emcal_clusfull_eta", &_emcal_clusfull_eta);
-    _tree->Branch("_emcal_clusfull_phi", &_emcal_clusfull_phi);
-    _tree->Branch("_emcal_clusfull_x", &_emcal_clusfull_x);
-    _tree->Branch("_emcal_clusfull_y", &_emcal_clusfull_y);
-    _tree->Branch("_emcal_clusfull_z", &_emcal_clusfull_z);
-    _tree->Branch("_emcal_clusfull_R", &_emcal_clusfull_R);
-    _tree->Branch("_emcal_clusfull_pt", &_emcal_clusfull_pt);
-    // EMCal core cluster corrections
-    _tree->Branch("_emcal_cluscore_e", &_emcal_cluscore_e);
-    _tree->Branch("_emcal_cluscore_eta", &_emcal_cluscore_eta);
-    _tree->Branch("_emcal_cluscore_phi", &_emcal_cluscore_phi);
-    _tree->Branch("_emcal_cluscore_x", &_emcal_cluscore_x);
-    _tree->Branch("_emcal_cluscore_y", &_emcal_cluscore_y);
-    _tree->Branch("_emcal_cluscore_z", &_emcal_cluscore_z);
-    _tree->Branch("_emcal_cluscore_R", &_emcal_cluscore_R);
-    _tree->Branch("_emcal_cluscore_pt", &_emcal_cluscore_pt);
-
-    _tree->Branch("_mbd_z", &_mbd_z);
+    m_main_output = m_writer.addTree(_tree, kMainTree, collections);
+    m_file_options.applyToTree(_tree);
 
     return Fun4AllReturnCodes::EVENT_OK;
 }
 
+//____________________________________________________________________________..
+int EMiHCalo::InitRun(PHCompositeNode *topNode)
+{
+    m_calo_lut = CaloGeometryLUT::get(topNode);
+    if (!m_calo_lut)
+    {
+        std::cout << "EMiHCalo::InitRun - calorimeter tower geometry is missing, quitting" << std::endl;
+        return Fun4AllReturnCodes::ABORTRUN;
+    }
+    if (m_sparse_towers && !m_geometry_written)
+    {
+        WriteGeometryTree();
+    }
+    if (m_monitor_channels)
+    {
+        BookChannelMonitor();
+    }
+    return Fun4AllReturnCodes::EVENT_OK;
+}
+
+//____________________________________________________________________________..
+void EMiHCalo::WriteGeometryTree()
+{
+    // one entry per (calo, channel); the sparse _*_tower_channel columns index it
+    int calo = 0, channel = 0, ieta = 0, iphi = 0;
+    float eta = 0, phi = 0, x = 0, y = 0, z = 0;
+    _outfile->cd();
+    TTree *geometry = new TTree("towergeom", "tower geometry of the sparse tower columns");
+    geometry->Branch("calo", &calo);
+    geometry->Branch("channel", &channel);
+    geometry->Branch("ieta", &ieta);
+    geometry->Branch("iphi", &iphi);
+    geometry->Branch("eta", &eta);
+    geometry->Branch("phi", &phi);
+    geometry->Branch("x", &x);
+    geometry->Branch("y", &y);
+    geometry->Branch("z", &z);
+    m_file_options.applyToTree(geometry);
+    for (calo = 0; calo < CaloGeometryLUT::kNCalos; calo++)
+    {
+        CaloGeometryLUT::Calo c = static_cast<CaloGeometryLUT::Calo>(calo);
+        for (channel = 0; channel < (int) m_calo_lut->size(c); channel++)
+        {
+            ieta = m_calo_lut->ieta(c, channel);
+            iphi = m_calo_lut->iphi(c, channel);
+            eta = m_calo_lut->eta(c, channel);
+            phi = m_calo_lut->phi(c, channel);
+            x = m_calo_lut->x(c, channel);
+            y = m_calo_lut->y(c, channel);
+            z = m_calo_lut->z(c, channel);
+            geometry->Fill();
+        }
+    }
+    // the branches point at the locals of this function
+    geometry->ResetBranchAddresses();
+    m_geometry_written = true;
+}
+
 //____________________________________________________________________________..
 int EMiHCalo::process_event(PHCompositeNode *topNode)
 {
+    ResetTreeVectors();
+
     bool hasMBDvertex = true;
 
     GlobalVertexMap *vertexmap = findNode::getClass<GlobalVertexMap>(topNode, "GlobalVertexMap");
@@ -252,8 +267,6 @@ int EMiHCalo::process_event(PHCompositeNode *topNode)
     //     std::cout << "EMiHCalo::process_event: TOWER_CALIB_CEMC not found!!!" << std::endl;
     // }
 
-    ResetTreeVectors();
-    
     _run_test.push_back(1);
     FillTree();
 
@@ -266,6 +279,18 @@ int EMiHCalo::process_event(PHCompositeNode *topNode)
 int EMiHCalo::End(PHCompositeNode *topNode)
 {
     std::cout << topNode << std::endl;
+    // the writer thread has to be done with the tree before it is written
+    m_writer.flush();
+    if (m_writer.depth() > 0)
+    {
+        std::cout << "EMiHCalo::End output queue: " << m_writer.stalls() << " stalls, at most "
+                  << m_writer.maxQueued() << " events queued, " << m_writer.fillErrors() << " fill errors" << std::endl;
+    }
+    if (m_channel_monitor.booked())
+    {
+        std::size_t flagged = m_channel_monitor.write(_outfile);
+        std::cout << "EMiHCalo::End channel QA over " << m_channel_monitor.events() << " events: " << flagged << " flagged channels" << std::endl;
+    }
     _outfile->cd();
     _outfile->Write();
     _outfile->Close();
@@ -274,77 +299,14 @@ int EMiHCalo::End(PHCompositeNode *topNode)
 
 void EMiHCalo::ResetTreeVectors()
 {
-    _run_test.clear();
-    // EMCal vectors
-    _emcalgeo_id.clear();
-    _emcalgeo_phibin.clear();
-    _emcalgeo_etabin.clear();
-
-    _emcal_e.clear();
-    _emcal_phi.clear();
-    _emcal_eta.clear();
-    _emcal_iphi.clear();
-    _emcal_ieta.clear();
-    _emcal_time.clear();
-    _emcal_chi2.clear();
-    _emcal_pedestal.clear();
-
-    // IHCAL vectors
-    _ihcal_e.clear();
-    _ihcal_phi.clear();
-    _ihcal_eta.clear();
-    _ihcal_iphi.clear();
-    _ihcal_ieta.clear();
-    _ihcal_time.clear();
-    _ihcal_chi2.clear();
-    _ihcal_pedestal.clear();
-
-    // OHCAL vectors
-    _ohcal_e.clear();
-    _ohcal_phi.clear();
-    _ohcal_eta.clear();
-    _ohcal_iphi.clear();
-    _ohcal_ieta.clear();
-    _ohcal_time.clear();
-    _ohcal_chi2.clear();
-    _ohcal_pedestal.clear();
-
-    // EMCal cluster information
-    _emcal_cluster_id.clear();
-    _emcal_cluster_e.clear();
-    _emcal_cluster_phi.clear();
-    _emcal_cluster_eta.clear();
-    _emcal_cluster_x.clear();
-    _emcal_cluster_y.clear();
-    _emcal_cluster_z.clear();
-    _emcal_cluster_ecore.clear();
-    _emcal_cluster_chi2.clear();
-    _emcal_cluster_prob.clear();
-
-    // EMCal full cluster corrections
-    _emcal_clusfull_e.clear();
-    _emcal_clusfull_eta.clear();
-    _emcal_clusfull_phi.clear();
-    _emcal_clusfull_x.clear();
-    _emcal_clusfull_y.clear();
-    _emcal_clusfull_z.clear();
-    _emcal_clusfull_pt.clear();
-
-    // EMCal core cluster corrections
-    _emcal_cluscore_e.clear();
-    _emcal_cluscore_eta.clear();
-    _emcal_cluscore_phi.clear();
-    _emcal_cluscore_x.clear();
-    _emcal_cluscore_y.clear();
-    _emcal_cluscore_z.clear();
-    _emcal_cluscore_pt.clear();
+    m_columns.reset(kMainTree);
 }
 
 
 // //____________________________________________________________________________..
 void EMiHCalo::FillTree()
 {
-    if (!clustersEM || !EMCAL_Container || !EMCalGeo || !IHCalGeo || !OHCalGeo || !IHCAL_Container || !OHCAL_Container )
+    if (!clustersEM || !EMCAL_Container || !EMCalGeo || !IHCalGeo || !OHCalGeo || !IHCAL_Container || !OHCAL_Container || !m_calo_lut)
     {
         std::cout << PHWHERE << "missing node trees, can't continue with track calo matching"
               << std::endl;
@@ -352,7 +314,7 @@ void EMiHCalo::FillTree()
     }
 
     // 遍历所有塔
-    for (unsigned int i = 0; i < EMCalGeo->size(); i++)
+    for (unsigned int i = 0; Verbosity() > 1 && i < EMCalGeo->size(); i++)
     {
         RawTowerGeom* geom = EMCalGeo->get_tower_geometry(i);
         if (!geom) continue;
@@ -362,113 +324,119 @@ void EMiHCalo::FillTree()
                   << std::endl;
     }
 
-    // loop over all calo tower
-    TowerInfo *tInfo_emc = nullptr;
-    TowerInfo *tInfo_ihc = nullptr;
-    TowerInfo *tInfo_ohc = nullptr;
-
-    for(unsigned int iem = 0; iem < EMCAL_Container->size(); iem++)
+    if (m_monitor_channels)
     {
-        tInfo_emc = EMCAL_Container->get_tower_at_channel(iem); 
-
-        if(!tInfo_emc)
-        {
-            continue;
-        }
-
-        if(!tInfo_emc->get_isGood())
-        {
-            continue;
-        }
-
-        //if(tInfo_emc->get_energy() < 0.2) continue;
-
-        unsigned int towerinfo_key = EMCAL_Container->encode_key(iem);
-        int ti_ieta = EMCAL_Container->getTowerEtaBin(towerinfo_key);
-        int ti_iphi = EMCAL_Container->getTowerPhiBin(towerinfo_key);
-
-        const RawTowerDefs::keytype key = RawTowerDefs::encode_towerid(RawTowerDefs::CalorimeterId::CEMC, ti_ieta, ti_iphi);
-        RawTowerGeom *tower_geom = EMCalGeo->get_tower_geometry(key);
-
-        // _emcalgeo_id.push_back(tower_geom->get_id());
-        // _emcalgeo_phibin.push_back(ti_iphi);
-        // _emcalgeo_etabin.push_back(ti_ieta);
-        // std::cout<<"rawtower id is: "<<tower_geom->get_id()<<std::endl;
-
-        _emcal_e.push_back(tInfo_emc->get_energy());
-        _emcal_phi.push_back(tower_geom->get_phi());
-        _emcal_eta.push_back(tower_geom->get_eta());
-        _emcal_iphi.push_back(ti_iphi);
-        _emcal_ieta.push_back(ti_ieta);
-        _emcal_time.push_back(tInfo_emc->get_time());
-        _emcal_chi2.push_back(tInfo_emc->get_chi2());
-        _emcal_pedestal.push_back(tInfo_emc->get_pedestal());
+        FillChannelMonitor();
     }
 
-    for(unsigned int ihcal = 0; ihcal < IHCAL_Container->size(); ihcal++)
+    if (m_write_towers && m_sparse_towers)
     {
-        tInfo_ihc = IHCAL_Container->get_tower_at_channel(ihcal);
-
-        if(!tInfo_ihc)
-        {
-            continue;
-        }
-
-        if(!tInfo_ihc->get_isGood())
-        {
-            continue;
-        }
-
-        //if(tInfo_ihc->get_energy() < 0.2) continue;
-
-        unsigned int towerinfo_key = IHCAL_Container->encode_key(ihcal);
-        int ti_ieta = IHCAL_Container->getTowerEtaBin(towerinfo_key);
-        int ti_iphi = IHCAL_Container->getTowerPhiBin(towerinfo_key);
-        
-        const RawTowerDefs::keytype key = RawTowerDefs::encode_towerid(RawTowerDefs::CalorimeterId::HCALIN, ti_ieta, ti_iphi);
-        RawTowerGeom *tower_geom = IHCalGeo->get_tower_geometry(key);
-
-        _ihcal_e.push_back(tInfo_ihc->get_energy());
-        _ihcal_phi.push_back(tower_geom->get_phi());
-        _ihcal_eta.push_back(tower_geom->get_eta());
-        _ihcal_iphi.push_back(ti_iphi);
-        _ihcal_ieta.push_back(ti_ieta);
-        _ihcal_time.push_back(tInfo_ihc->get_time());
-        _ihcal_chi2.push_back(tInfo_ihc->get_chi2());
-        _ihcal_pedestal.push_back(tInfo_ihc->get_pedestal());
+        FillSparseTowers(CaloGeometryLUT::kCEMC, EMCAL_Container);
+        FillSparseTowers(CaloGeometryLUT::kHCALIN, IHCAL_Container);
+        FillSparseTowers(CaloGeometryLUT::kHCALOUT, OHCAL_Container);
     }
-
-    for(unsigned int ohcal = 0; ohcal < OHCAL_Container->size(); ohcal++)
+    else if (m_write_towers)
     {
-        tInfo_ohc = OHCAL_Container->get_tower_at_channel(ohcal);
-
-        if(!tInfo_ohc)
+        // loop over all calo tower
+        TowerInfo *tInfo_emc = nullptr;
+        TowerInfo *tInfo_ihc = nullptr;
+        TowerInfo *tInfo_ohc = nullptr;
+
+        // channels beyond the geometry table have no eta/phi and are skipped
+        const unsigned int n_iem = std::min<std::size_t>(EMCAL_Container->size(), m_calo_lut->size(CaloGeometryLUT::kCEMC));
+        for(unsigned int iem = 0; iem < n_iem; iem++)
         {
-            continue;
+            tInfo_emc = EMCAL_Container->get_tower_at_channel(iem); 
+
+            if(!tInfo_emc)
+            {
+                continue;
+            }
+
+            if(!tInfo_emc->get_isGood())
+            {
+                continue;
+            }
+
+            //if(tInfo_emc->get_energy() < 0.2) continue;
+
+            int ti_ieta = m_calo_lut->ieta(CaloGeometryLUT::kCEMC, iem);
+            int ti_iphi = m_calo_lut->iphi(CaloGeometryLUT::kCEMC, iem);
+
+            // _emcalgeo_id.push_back(tower_geom->get_id());
+            // _emcalgeo_phibin.push_back(ti_iphi);
+            // _emcalgeo_etabin.push_back(ti_ieta);
+            // std::cout<<"rawtower id is: "<<tower_geom->get_id()<<std::endl;
+
+            _emcal_e.push_back(tInfo_emc->get_energy());
+            _emcal_phi.push_back(m_calo_lut->phi(CaloGeometryLUT::kCEMC, iem));
+            _emcal_eta.push_back(m_calo_lut->eta(CaloGeometryLUT::kCEMC, iem));
+            _emcal_iphi.push_back(ti_iphi);
+            _emcal_ieta.push_back(ti_ieta);
+            _emcal_time.push_back(tInfo_emc->get_time());
+            _emcal_chi2.push_back(tInfo_emc->get_chi2());
+            _emcal_pedestal.push_back(tInfo_emc->get_pedestal());
         }
 
-        if(!tInfo_ohc->get_isGood())
+        const unsigned int n_ihcal = std::min<std::size_t>(IHCAL_Container->size(), m_calo_lut->size(CaloGeometryLUT::kHCALIN));
+        for(unsigned int ihcal = 0; ihcal < n_ihcal; ihcal++)
         {
-            continue;
+            tInfo_ihc = IHCAL_Container->get_tower_at_channel(ihcal);
+
+            if(!tInfo_ihc)
+            {
+                continue;
+            }
+
+            if(!tInfo_ihc->get_isGood())
+            {
+                continue;
+            }
+
+            //if(tInfo_ihc->get_energy() < 0.2) continue;
+
+            int ti_ieta = m_calo_lut->ieta(CaloGeometryLUT::kHCALIN, ihcal);
+            int ti_iphi = m_calo_lut->iphi(CaloGeometryLUT::kHCALIN, ihcal);
+
+            _ihcal_e.push_back(tInfo_ihc->get_energy());
+            _ihcal_phi.push_back(m_calo_lut->phi(CaloGeometryLUT::kHCALIN, ihcal));
+            _ihcal_eta.push_back(m_calo_lut->eta(CaloGeometryLUT::kHCALIN, ihcal));
+            _ihcal_iphi.push_back(ti_iphi);
+            _ihcal_ieta.push_back(ti_ieta);
+            _ihcal_time.push_back(tInfo_ihc->get_time());
+            _ihcal_chi2.push_back(tInfo_ihc->get_chi2());
+            _ihcal_pedestal.push_back(tInfo_ihc->get_pedestal());
         }
 
-        //if(tInfo_ohc->get_energy() < 0.2) continue;
-
-        unsigned int towerinfo_key = OHCAL_Container->encode_key(ohcal);
-        int ti_ieta = OHCAL_Container->getTowerEtaBin(towerinfo_key);
-        int ti_iphi = OHCAL_Container->getTowerPhiBin(towerinfo_key);
-        
-        const RawTowerDefs::keytype key = RawTowerDefs::encode_towerid(RawTowerDefs::CalorimeterId::HCALOUT, ti_ieta, ti_iphi);
-        RawTowerGeom *tower_geom = OHCalGeo->get_tower_geometry(key);
-
-        _ohcal_e.push_back(tInfo_ohc->get_energy());
-        _ohcal_phi.push_back(tower_geom->get_phi());
-        _ohcal_eta.push_back(tower_geom->get_eta());
-        _ohcal_iphi.push_back(ti_iphi); 
-        _ohcal_ieta.push_back(ti_ieta);
-        _ohcal_time.push_back(tInfo_ohc->get_time());
-        _ohcal_chi2.push_back(tInfo_ohc->get_chi2());
-        _ohcal_pedestal.push_back(tInfo_ohc->get_pedestal());
+        const unsigned int n_ohcal = std::min<std::size_t>(OHCAL_Container->size(), m_calo_lut->size(CaloGeometryLUT::kHCALOUT));
+        for(unsigned int ohcal = 0; ohcal < n_ohcal; ohcal++)
+        {
+            tInfo_ohc = OHCAL_Container->get_tower_at_channel(ohcal);
+
+            if(!tInfo_ohc)
+            {
+                continue;
+            }
+
+            if(!tInfo_ohc->get_isGood())
+            {
+                continue;
+            }
+
+            //if(tInfo_ohc->get_energy() < 0.2) continue;
+
+            int ti_ieta = m_calo_lut->ieta(CaloGeometryLUT::kHCALOUT, ohcal);
+            int ti_iphi = m_calo_lut->iphi(CaloGeometryLUT::kHCALOUT, ohcal);
+
+            _ohcal_e.push_back(tInfo_ohc->get_energy());
+            _ohcal_phi.push_back(m_calo_lut->phi(CaloGeometryLUT::kHCALOUT, ohcal));
+            _ohcal_eta.push_back(m_calo_lut->eta(CaloGeometryLUT::kHCALOUT, ohcal));
+            _ohcal_iphi.push_back(ti_iphi); 
+            _ohcal_ieta.push_back(ti_ieta);
+            _ohcal_time.push_back(tInfo_ohc->get_time());
+            _ohcal_chi2.push_back(tInfo_ohc->get_chi2());
+            _ohcal_pedestal.push_back(tInfo_ohc->get_pedestal());
+        }
     }
 
     // Loop over the EMCal clusters
@@ -613,7 +581,7 @@ void EMiHCalo::FillTree()
     //     _CEMC_Hit_particle_z.push_back(vtx->get_z());
     // }
 
-    _tree->Fill();
+    m_writer.commit(m_main_output);
 }
 
 
@@ -654,4 +622,65 @@ void EMiHCalo::FillTree()
 // RawClusterContainer *clustersEM = findNode::getClass<RawClusterContainer>(topNode, "TOPOCLUSTER_EMCAL");
 // RawClusterContainer *clustersHAD = findNode::getClass<RawClusterContainer>(topNode, "TOPOCLUSTER_HCAL");
 
-// findNode::getClass<RawClusterContainer>(topNode, "CLUSTERINFO_" + m_detector);
\ No newline at end of file
+// findNode::getClass<RawClusterContainer>(topNode, "CLUSTERINFO_" + m_detector);
+
+//____________________________________________________________________________..
+void EMiHCalo::FillSparseTowers(CaloGeometryLUT::Calo calo, TowerInfoContainer *container)
+{
+    const float e_min = m_sparse_e_min[calo];
+    for (unsigned int channel = 0; channel < container->size(); channel++)
+    {
+        TowerInfo *tower = container->get_tower_at_channel(channel);
+        if (!tower || !tower->get_isGood()) continue;
+        if (tower->get_energy() < e_min) continue;
+
+        _sparse_channel_columns[calo]->push_back(channel);
+        _sparse_e_columns[calo]->push_back(tower->get_energy());
+        _sparse_time_columns[calo]->push_back(tower->get_time());
+        if (m_sparse_fit_info)
+        {
+            _sparse_chi2_columns[calo]->push_back(tower->get_chi2());
+            _sparse_pedestal_columns[calo]->push_back(tower->get_pedestal());
+        }
+    }
+}
+
+//____________________________________________________________________________..
+void EMiHCalo::BookChannelMonitor()
+{
+    // the statistics run over the whole job; they only start over if the geometry of a run has other channel counts
+    bool same = m_channel_monitor.booked();
+    for (int calo = 0; calo < CaloGeometryLUT::kNCalos; calo++)
+    {
+        same = same && m_channel_monitor.channels(calo) == m_calo_lut->size(static_cast<CaloGeometryLUT::Calo>(calo));
+    }
+    if (same) return;
+
+    if (m_channel_monitor.booked())
+    {
+        std::cout << "EMiHCalo::InitRun - tower geometry changed, channel QA restarts" << std::endl;
+    }
+    m_channel_monitor.book({m_calo_lut->size(CaloGeometryLUT::kCEMC), m_calo_lut->size(CaloGeometryLUT::kHCALIN), m_calo_lut->size(CaloGeometryLUT::kHCALOUT)});
+    for (int calo = 0; calo < CaloGeometryLUT::kNCalos; calo++)
+    {
+        m_channel_monitor.setOccupancyThreshold(calo, m_channel_qa_e_min[calo]);
+    }
+}
+
+//____________________________________________________________________________..
+void EMiHCalo::FillChannelMonitor()
+{
+    TowerInfoContainer *containers[CaloGeometryLUT::kNCalos] = {EMCAL_Container, IHCAL_Container, OHCAL_Container};
+
+    // gather the towers into the flat stage, then update all channels in one pass
+    for (int calo = 0; calo < CaloGeometryLUT::kNCalos; calo++)
+    {
+        for (unsigned int channel = 0; channel < containers[calo]->size(); channel++)
+        {
+            TowerInfo *tower = containers[calo]->get_tower_at_channel(channel);
+            if (!tower) continue;
+            m_channel_monitor.set(calo, channel, tower->get_isGood(), tower->get_energy(), tower->get_time(), tower->get_pedestal());
+        }
+    }
+    m_channel_monitor.update();
+}
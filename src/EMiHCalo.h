@@ -52,6 +52,12 @@
 #include <TH1F.h>
 #include <TH2F.h>
 
+#include "AsyncTreeWriter.h"
+#include "CaloGeometryLUT.h"
+#include "OutputFileOptions.h"
+#include "TowerChannelMonitor.h"
+#include "TreeColumnRegistry.h"
+
 #include <string>
 #include <vector>
 
@@ -75,6 +81,9 @@ public:
         using Fun4AllServer::dumpHistos() method).
      */
     int Init(PHCompositeNode *topNode) override;
+
+    /// tower geometry lookup table of the run
+    int InitRun(PHCompositeNode *topNode) override;
     
     /** Called for each event.
         This is where you do the real work.
@@ -87,77 +96,149 @@ public:
     void ResetTreeVectors();
     void FillTree();
 
+    /// write only (channel, e, time) of the towers above threshold instead of every good tower; eta/phi come from the towergeom tree
+    void setSparseTowers(bool sparse) {m_sparse_towers = sparse;}
+    /// sparse mode energy threshold in GeV, one fixed cut for every channel of calo; there is no per-channel noise in the towers to scale it by
+    void setSparseTowerThreshold(CaloGeometryLUT::Calo calo, float e_min) {m_sparse_e_min[calo] = e_min;}
+    /// keep the waveform fit chi2 and pedestal of the sparse towers
+    void keepSparseTowerFitInfo(bool keep) {m_sparse_fit_info = keep;}
+    /// no tower columns at all, e.g. when only the channel QA is wanted
+    void writeTowers(bool write) {m_write_towers = write;}
+
+    /// running per-channel tower statistics; End() writes the channel_qa_summary and channel_qa_flagged trees
+    void monitorChannels(bool monitor) {m_monitor_channels = monitor;}
+    /// towers above e_min (GeV) count towards the channel occupancy
+    void setChannelQAThreshold(CaloGeometryLUT::Calo calo, float e_min) {m_channel_qa_e_min[calo] = e_min;}
+    /// hot/dead/drift flag cuts
+    TowerChannelMonitor &channelMonitor() {return m_channel_monitor;}
+
+    /// fill the tree on a background thread with up to depth events in flight; 0 fills in process_event
+    void setOutputQueueDepth(unsigned int depth) {m_writer.setDepth(depth);}
+
+    /// output file tuning: compression (ROOT::RCompressionSetting::EAlgorithm, level), basket sizes, TTree::SetAutoFlush/SetAutoSave
+    void setCompression(int algorithm, int level) {m_file_options.setCompression(algorithm, level);}
+    void setBasketSize(const std::string &pattern, int bytes) {m_file_options.setBasketSize(pattern, bytes);}
+    void setAutoFlush(long long value) {m_file_options.setAutoFlush(value);}
+    void setAutoSave(long long value) {m_file_options.setAutoSave(value);}
+
 private:
     std::string _outfilename;
     TFile *_outfile = nullptr;
     TTree *_tree = nullptr;
 
-    std::vector<float> _mbd_z;
+    enum OutputTree
+    {
+        kMainTree = 1U << 0
+    };
+    enum ColumnCollection
+    {
+        kEventColumns = 0,
+        kTowerColumns,
+        kClusterColumns,
+        kSparseTowerColumns,
+        kSparseFitColumns
+    };
+
+    void FillSparseTowers(CaloGeometryLUT::Calo calo, TowerInfoContainer *container);
+    void BookChannelMonitor();
+    void FillChannelMonitor();
+    void WriteGeometryTree();
+
+    // every output column is declared once below; the registry books the branches and resets them
+    TreeColumnRegistry m_columns;
+    AsyncTreeWriter m_writer{m_columns};
+    OutputFileOptions m_file_options;
+    int m_main_output = -1;
 
-    std::vector<float> _run_test;
+    std::vector<float> &_run_test = m_columns.add<float>("_run_test", kEventColumns, kMainTree);
     // EMCal tower vectors
-    std::vector<float> _emcalgeo_id;
-    std::vector<float> _emcalgeo_phibin;
-    std::vector<float> _emcalgeo_etabin;
-
-    std::vector<float> _emcal_e;
-    std::vector<float> _emcal_phi;
-    std::vector<float> _emcal_eta;
-    std::vector<int>   _emcal_iphi;
-    std::vector<int>   _emcal_ieta;
-    std::vector<float> _emcal_time;
-    std::vector<float> _emcal_chi2;
-    std::vector<float> _emcal_pedestal;
+    std::vector<float> &_emcalgeo_id = m_columns.add<float>("_emcalgeo_id", kTowerColumns, kMainTree);
+    std::vector<float> &_emcalgeo_phibin = m_columns.add<float>("_emcalgeo_phibin", kTowerColumns, kMainTree);
+    std::vector<float> &_emcalgeo_etabin = m_columns.add<float>("_emcalgeo_etabin", kTowerColumns, kMainTree);
+
+    std::vector<float> &_emcal_e = m_columns.add<float>("_emcal_e", kTowerColumns, kMainTree);
+    std::vector<float> &_emcal_phi = m_columns.add<float>("_emcal_phi", kTowerColumns, kMainTree);
+    std::vector<float> &_emcal_eta = m_columns.add<float>("_emcal_eta", kTowerColumns, kMainTree);
+    std::vector<int> &_emcal_iphi = m_columns.add<int>("_emcal_iphi", kTowerColumns, kMainTree);
+    std::vector<int> &_emcal_ieta = m_columns.add<int>("_emcal_ieta", kTowerColumns, kMainTree);
+    std::vector<float> &_emcal_time = m_columns.add<float>("_emcal_time", kTowerColumns, kMainTree);
+    std::vector<float> &_emcal_chi2 = m_columns.add<float>("_emcal_chi2", kTowerColumns, kMainTree);
+    std::vector<float> &_emcal_pedestal = m_columns.add<float>("_emcal_pedestal", kTowerColumns, kMainTree);
     // IHCAL tower vectors
-    std::vector<float> _ihcal_e;
-    std::vector<float> _ihcal_phi;
-    std::vector<float> _ihcal_eta;
-    std::vector<int>   _ihcal_iphi;
-    std::vector<int>   _ihcal_ieta;
+    std::vector<float> &_ihcal_e = m_columns.add<float>("_ihcal_e", kTowerColumns, kMainTree);
+    std::vector<float> &_ihcal_phi = m_columns.add<float>("_ihcal_phi", kTowerColumns, kMainTree);
+    std::vector<float> &_ihcal_eta = m_columns.add<float>("_ihcal_eta", kTowerColumns, kMainTree);
+    std::vector<int> &_ihcal_iphi = m_columns.add<int>("_ihcal_iphi", kTowerColumns, kMainTree);
+    std::vector<int> &_ihcal_ieta = m_columns.add<int>("_ihcal_ieta", kTowerColumns, kMainTree);
     
-    std::vector<float> _ihcal_time;
-    std::vector<float> _ihcal_chi2;
-    std::vector<float> _ihcal_pedestal;
+    std::vector<float> &_ihcal_time = m_columns.add<float>("_ihcal_time", kTowerColumns, kMainTree);
+    std::vector<float> &_ihcal_chi2 = m_columns.add<float>("_ihcal_chi2", kTowerColumns, kMainTree);
+    std::vector<float> &_ihcal_pedestal = m_columns.add<float>("_ihcal_pedestal", kTowerColumns, kMainTree);
     // OHCAL tower vectors
-    std::vector<float> _ohcal_e;
-    std::vector<float> _ohcal_phi;
-    std::vector<float> _ohcal_eta;
-    std::vector<int>   _ohcal_iphi;
-    std::vector<int>   _ohcal_ieta;
-    std::vector<float> _ohcal_time;
-    std::vector<float> _ohcal_chi2;
-    std::vector<float> _ohcal_pedestal;
+    std::vector<float> &_ohcal_e = m_columns.add<float>("_ohcal_e", kTowerColumns, kMainTree);
+    std::vector<float> &_ohcal_phi = m_columns.add<float>("_ohcal_phi", kTowerColumns, kMainTree);
+    std::vector<float> &_ohcal_eta = m_columns.add<float>("_ohcal_eta", kTowerColumns, kMainTree);
+    std::vector<int> &_ohcal_iphi = m_columns.add<int>("_ohcal_iphi", kTowerColumns, kMainTree);
+    std::vector<int> &_ohcal_ieta = m_columns.add<int>("_ohcal_ieta", kTowerColumns, kMainTree);
+    std::vector<float> &_ohcal_time = m_columns.add<float>("_ohcal_time", kTowerColumns, kMainTree);
+    std::vector<float> &_ohcal_chi2 = m_columns.add<float>("_ohcal_chi2", kTowerColumns, kMainTree);
+    std::vector<float> &_ohcal_pedestal = m_columns.add<float>("_ohcal_pedestal", kTowerColumns, kMainTree);
+
+    // sparse tower vectors, channel indexes the towergeom tree of the calorimeter
+    std::vector<int> &_emcal_tower_channel = m_columns.add<int>("_emcal_tower_channel", kSparseTowerColumns, kMainTree);
+    std::vector<float> &_emcal_tower_e = m_columns.add<float>("_emcal_tower_e", kSparseTowerColumns, kMainTree);
+    std::vector<float> &_emcal_tower_time = m_columns.add<float>("_emcal_tower_time", kSparseTowerColumns, kMainTree);
+    std::vector<float> &_emcal_tower_chi2 = m_columns.add<float>("_emcal_tower_chi2", kSparseFitColumns, kMainTree);
+    std::vector<float> &_emcal_tower_pedestal = m_columns.add<float>("_emcal_tower_pedestal", kSparseFitColumns, kMainTree);
+    std::vector<int> &_ihcal_tower_channel = m_columns.add<int>("_ihcal_tower_channel", kSparseTowerColumns, kMainTree);
+    std::vector<float> &_ihcal_tower_e = m_columns.add<float>("_ihcal_tower_e", kSparseTowerColumns, kMainTree);
+    std::vector<float> &_ihcal_tower_time = m_columns.add<float>("_ihcal_tower_time", kSparseTowerColumns, kMainTree);
+    std::vector<float> &_ihcal_tower_chi2 = m_columns.add<float>("_ihcal_tower_chi2", kSparseFitColumns, kMainTree);
+    std::vector<float> &_ihcal_tower_pedestal = m_columns.add<float>("_ihcal_tower_pedestal", kSparseFitColumns, kMainTree);
+    std::vector<int> &_ohcal_tower_channel = m_columns.add<int>("_ohcal_tower_channel", kSparseTowerColumns, kMainTree);
+    std::vector<float> &_ohcal_tower_e = m_columns.add<float>("_ohcal_tower_e", kSparseTowerColumns, kMainTree);
+    std::vector<float> &_ohcal_tower_time = m_columns.add<float>("_ohcal_tower_time", kSparseTowerColumns, kMainTree);
+    std::vector<float> &_ohcal_tower_chi2 = m_columns.add<float>("_ohcal_tower_chi2", kSparseFitColumns, kMainTree);
+    std::vector<float> &_ohcal_tower_pedestal = m_columns.add<float>("_ohcal_tower_pedestal", kSparseFitColumns, kMainTree);
+
+    std::vector<int> *_sparse_channel_columns[CaloGeometryLUT::kNCalos] = {&_emcal_tower_channel, &_ihcal_tower_channel, &_ohcal_tower_channel};
+    std::vector<float> *_sparse_e_columns[CaloGeometryLUT::kNCalos] = {&_emcal_tower_e, &_ihcal_tower_e, &_ohcal_tower_e};
+    std::vector<float> *_sparse_time_columns[CaloGeometryLUT::kNCalos] = {&_emcal_tower_time, &_ihcal_tower_time, &_ohcal_tower_time};
+    std::vector<float> *_sparse_chi2_columns[CaloGeometryLUT::kNCalos] = {&_emcal_tower_chi2, &_ihcal_tower_chi2, &_ohcal_tower_chi2};
+    std::vector<float> *_sparse_pedestal_columns[CaloGeometryLUT::kNCalos] = {&_emcal_tower_pedestal, &_ihcal_tower_pedestal, &_ohcal_tower_pedestal};
 
     // EMCal cluster information
-    std::vector<int>   _emcal_cluster_id;
-    std::vector<float> _emcal_cluster_e;
-    std::vector<float> _emcal_cluster_phi;
-    std::vector<float> _emcal_cluster_eta;
-    std::vector<float> _emcal_cluster_x;
-    std::vector<float> _emcal_cluster_y;
-    std::vector<float> _emcal_cluster_z;
-    std::vector<float> _emcal_cluster_R;
-    std::vector<float> _emcal_cluster_ecore;
-    std::vector<float> _emcal_cluster_chi2;
-    std::vector<float> _emcal_cluster_prob;
+    std::vector<int> &_emcal_cluster_id = m_columns.add<int>("_emcal_cluster_id", kClusterColumns, kMainTree);
+    std::vector<float> &_emcal_cluster_e = m_columns.add<float>("_emcal_cluster_e", kClusterColumns, kMainTree);
+    std::vector<float> &_emcal_cluster_phi = m_columns.add<float>("_emcal_cluster_phi", kClusterColumns, kMainTree);
+    std::vector<float> &_emcal_cluster_eta = m_columns.add<float>("_emcal_cluster_eta", kClusterColumns, kMainTree);
+    std::vector<float> &_emcal_cluster_x = m_columns.add<float>("_emcal_cluster_x", kClusterColumns, kMainTree);
+    std::vector<float> &_emcal_cluster_y = m_columns.add<float>("_emcal_cluster_y", kClusterColumns, kMainTree);
+    std::vector<float> &_emcal_cluster_z = m_columns.add<float>("_emcal_cluster_z", kClusterColumns, kMainTree);
+    std::vector<float> &_emcal_cluster_R = m_columns.add<float>("_emcal_cluster_R", kClusterColumns, kMainTree);
+    std::vector<float> &_emcal_cluster_ecore = m_columns.add<float>("_emcal_cluster_ecore", kClusterColumns, kMainTree);
+    std::vector<float> &_emcal_cluster_chi2 = m_columns.add<float>("_emcal_cluster_chi2", kClusterColumns, kMainTree);
+    std::vector<float> &_emcal_cluster_prob = m_columns.add<float>("_emcal_cluster_prob", kClusterColumns, kMainTree);
     // EMCal full cluster corrections
-    std::vector<float> _emcal_clusfull_e;
-    std::vector<float> _emcal_clusfull_eta;
-    std::vector<float> _emcal_clusfull_phi;
-    std::vector<float> _emcal_clusfull_x;
-    std::vector<float> _emcal_clusfull_y;
-    std::vector<float> _emcal_clusfull_z;
-    std::vector<float> _emcal_clusfull_R;
-    std::vector<float> _emcal_clusfull_pt;
+    std::vector<float> &_emcal_clusfull_e = m_columns.add<float>("_emcal_clusfull_e", kClusterColumns, kMainTree);
+    std::vector<float> &_emcal_clusfull_eta = m_columns.add<float>("_emcal_clusfull_eta", kClusterColumns, kMainTree);
+    std::vector<float> &_emcal_clusfull_phi = m_columns.add<float>("_emcal_clusfull_phi", kClusterColumns, kMainTree);
+    std::vector<float> &_emcal_clusfull_x = m_columns.add<float>("_emcal_clusfull_x", kClusterColumns, kMainTree);
+    std::vector<float> &_emcal_clusfull_y = m_columns.add<float>("_emcal_clusfull_y", kClusterColumns, kMainTree);
+    std::vector<float> &_emcal_clusfull_z = m_columns.add<float>("_emcal_clusfull_z", kClusterColumns, kMainTree);
+    std::vector<float> &_emcal_clusfull_R = m_columns.add<float>("_emcal_clusfull_R", kClusterColumns, kMainTree);
+    std::vector<float> &_emcal_clusfull_pt = m_columns.add<float>("_emcal_clusfull_pt", kClusterColumns, kMainTree);
     // EMCal core cluster corrections
-    std::vector<float> _emcal_cluscore_e;
-    std::vector<float> _emcal_cluscore_eta;
-    std::vector<float> _emcal_cluscore_phi;
-    std::vector<float> _emcal_cluscore_x;
-    std::vector<float> _emcal_cluscore_y;
-    std::vector<float> _emcal_cluscore_z;
-    std::vector<float> _emcal_cluscore_R;
-    std::vector<float> _emcal_cluscore_pt;
+    std::vector<float> &_emcal_cluscore_e = m_columns.add<float>("_emcal_cluscore_e", kClusterColumns, kMainTree);
+    std::vector<float> &_emcal_cluscore_eta = m_columns.add<float>("_emcal_cluscore_eta", kClusterColumns, kMainTree);
+    std::vector<float> &_emcal_cluscore_phi = m_columns.add<float>("_emcal_cluscore_phi", kClusterColumns, kMainTree);
+    std::vector<float> &_emcal_cluscore_x = m_columns.add<float>("_emcal_cluscore_x", kClusterColumns, kMainTree);
+    std::vector<float> &_emcal_cluscore_y = m_columns.add<float>("_emcal_cluscore_y", kClusterColumns, kMainTree);
+    std::vector<float> &_emcal_cluscore_z = m_columns.add<float>("_emcal_cluscore_z", kClusterColumns, kMainTree);
+    std::vector<float> &_emcal_cluscore_R = m_columns.add<float>("_emcal_cluscore_R", kClusterColumns, kMainTree);
+    std::vector<float> &_emcal_cluscore_pt = m_columns.add<float>("_emcal_cluscore_pt", kClusterColumns, kMainTree);
+
+    std::vector<float> &_mbd_z = m_columns.add<float>("_mbd_z", kEventColumns, kMainTree);
 
     RawTowerGeomContainer* towerGeom;
 
@@ -175,7 +256,19 @@ private:
 
     RawTowerContainer * EMCal_RawTowerContainer;
 
+    CaloGeometryLUT *m_calo_lut = nullptr;
+
     double m_emcal_e_low_cut = 0.1;
+
+    bool m_sparse_towers = false;
+    bool m_sparse_fit_info = false;
+    float m_sparse_e_min[CaloGeometryLUT::kNCalos] = {0.05, 0.05, 0.05};
+    bool m_geometry_written = false;
+    bool m_write_towers = true;
+
+    bool m_monitor_channels = false;
+    float m_channel_qa_e_min[CaloGeometryLUT::kNCalos] = {0.5, 0.5, 0.5};
+    TowerChannelMonitor m_channel_monitor;
 };
 
 #endif // EMiHCalo_H
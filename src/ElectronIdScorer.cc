@@ -0,0 +1,57 @@
+/*!
+ *  \file   ElectronIdScorer.cc
+ *  \brief  Evaluates a trained TMVA electron-ID classifier on the features of a matched track
+ */
+#include "ElectronIdScorer.h"
+
+#include <TMVA/Reader.h>
+#include <TSystem.h>
+
+#include <cmath>
+#include <iostream>
+
+//____________________________________________________________________________..
+ElectronIdScorer::ElectronIdScorer() = default;
+
+//____________________________________________________________________________..
+ElectronIdScorer::~ElectronIdScorer() = default;
+
+//____________________________________________________________________________..
+bool ElectronIdScorer::load(const std::string &weight_file, const std::string &method)
+{
+  m_reader.reset();
+  if (gSystem->AccessPathName(weight_file.c_str()))
+  {
+    std::cout << "ElectronIdScorer::load - cannot read " << weight_file << std::endl;
+    return false;
+  }
+
+  std::unique_ptr<TMVA::Reader> reader(new TMVA::Reader("!Color:Silent"));
+  // names, types and order as in the training
+  reader->AddVariable("var1", &m_var1);
+  reader->AddVariable("var2", &m_var2);
+  reader->AddVariable("var3", &m_var3);
+  reader->AddSpectator("spec1 := var1*2", &m_spec1);
+  reader->AddSpectator("spec2 := var1*3", &m_spec2);
+  m_method = method + " method";
+  if (!reader->BookMVA(m_method, weight_file))
+  {
+    std::cout << "ElectronIdScorer::load - cannot book " << method << " from " << weight_file << std::endl;
+    return false;
+  }
+  m_reader = std::move(reader);
+  return true;
+}
+
+//____________________________________________________________________________..
+float ElectronIdScorer::evaluate(float e3x3, float p, float ihcal_e3x3, float chi2)
+{
+  if (!m_reader) return NAN;
+  m_var1 = e3x3 / p;
+  m_var2 = ihcal_e3x3 / e3x3;
+  m_var3 = chi2;
+  if (!std::isfinite(m_var1) || !std::isfinite(m_var2) || !std::isfinite(m_var3)) return NAN;
+  m_spec1 = m_var1 * 2;
+  m_spec2 = m_var1 * 3;
+  return m_reader->EvaluateMVA(m_method);
+}
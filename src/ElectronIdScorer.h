@@ -0,0 +1,53 @@
+// Tell emacs that this is a C++ source
+//  -*- C++ -*-.
+/*!
+ *  \file   ElectronIdScorer.h
+ *  \brief  Evaluates a trained TMVA electron-ID classifier on the features of a matched track
+ */
+
+#ifndef ELECTRONIDSCORER_H
+#define ELECTRONIDSCORER_H
+
+#include <memory>
+#include <string>
+
+namespace TMVA
+{
+  class Reader;
+}
+
+/*!
+ * Books a TMVA weight file (dataset_<name>/weights/<prefix>_<method>.weights.xml)
+ * with the variables of offAna/TMVAClassification.C:
+ *   var1 = E3x3/p, var2 = E(IHCal 3x3)/E(EMCal 3x3), var3 = EMCal cluster chi2,
+ * plus the spectators spec1 := var1*2 and spec2 := var1*3 the reader has to
+ * declare because they were declared in the training. The TMVA headers are
+ * only seen by the implementation.
+ */
+class ElectronIdScorer
+{
+ public:
+  ElectronIdScorer();
+  ~ElectronIdScorer();
+
+  ElectronIdScorer(const ElectronIdScorer &) = delete;
+  ElectronIdScorer &operator=(const ElectronIdScorer &) = delete;
+
+  /// book method (e.g. "BDT") from weight_file; false if the file cannot be read
+  bool load(const std::string &weight_file, const std::string &method = "BDT");
+  bool loaded() const { return static_cast<bool>(m_reader); }
+
+  /// classifier response for one track; NaN if nothing is loaded or a feature is not finite
+  float evaluate(float e3x3, float p, float ihcal_e3x3, float chi2);
+
+ private:
+  std::unique_ptr<TMVA::Reader> m_reader;
+  std::string m_method;
+  float m_var1 = 0;
+  float m_var2 = 0;
+  float m_var3 = 0;
+  float m_spec1 = 0;
+  float m_spec2 = 0;
+};
+
+#endif // ELECTRONIDSCORER_H
@@ -0,0 +1,235 @@
+/*!
+ *  \file   EventDisplayWriter.cc
+ *  \brief  Streams the event-display JSON of all events into one newline-delimited, optionally compressed file with an offset index
+ */
+#include "EventDisplayWriter.h"
+
+#include <zlib.h>
+
+#if defined(__has_include)
+#if __has_include(<zstd.h>)
+#define EVENTDISPLAYWRITER_ZSTD
+#include <zstd.h>
+#endif
+#endif
+
+#include <iostream>
+#include <sstream>
+
+//____________________________________________________________________________..
+EventDisplayWriter::~EventDisplayWriter()
+{
+  close();
+}
+
+//____________________________________________________________________________..
+bool EventDisplayWriter::available(Compression compression)
+{
+#ifdef EVENTDISPLAYWRITER_ZSTD
+  return true;
+#else
+  return compression != kZstd;
+#endif
+}
+
+//____________________________________________________________________________..
+std::string EventDisplayWriter::extension(Compression compression)
+{
+  switch (compression)
+  {
+  case kGzip: return ".ndjson.gz";
+  case kZstd: return ".ndjson.zst";
+  default: return ".ndjson";
+  }
+}
+
+//____________________________________________________________________________..
+void EventDisplayWriter::setCompression(Compression compression)
+{
+  if (!available(compression))
+  {
+    std::cout << "EventDisplayWriter::setCompression - zstd is not available in this build, writing gzip" << std::endl;
+    compression = kGzip;
+  }
+  m_compression = compression;
+}
+
+//____________________________________________________________________________..
+bool EventDisplayWriter::open(const std::string &filename)
+{
+  close();
+  m_file.open(filename, std::ios::binary | std::ios::trunc);
+  m_index.open(filename + ".idx", std::ios::trunc);
+  if (!m_file || !m_index)
+  {
+    std::cout << "EventDisplayWriter::open - cannot create " << filename << " or its index" << std::endl;
+    m_file.close();
+    m_index.close();
+    return false;
+  }
+  m_offset = 0;
+  m_events = 0;
+  m_dropped = 0;
+  m_bytes_in = 0;
+  m_bytes_out = 0;
+  return true;
+}
+
+//____________________________________________________________________________..
+void EventDisplayWriter::write(int run, int event, const std::string &json)
+{
+  if (!m_file.is_open()) return;
+  std::ostringstream line;
+  line << run << ' ' << event << ' ' << m_block.size() << ' ' << json.size() + 1 << '\n';
+  m_pending_index += line.str();
+  m_block += json;
+  m_block += '\n';
+  m_events++;
+  m_block_events++;
+  if (m_block.size() >= m_block_size) flushBlock();
+}
+
+//____________________________________________________________________________..
+void EventDisplayWriter::flushBlock()
+{
+  if (m_block.empty()) return;
+  const std::string *out = &m_block;
+  if (m_compression != kNone)
+  {
+    if (!compress(m_compression, m_block, m_compressed))
+    {
+      // raw bytes would break the .gz / .zst stream, so the block is not written
+      std::istringstream lines(m_pending_index);
+      std::string first_run, first_event, last_run, last_event, rest;
+      lines >> first_run >> first_event;
+      last_run = first_run;
+      last_event = first_event;
+      while (std::getline(lines, rest) && lines >> last_run >> last_event) {}
+      std::cout << "EventDisplayWriter::flushBlock - compression failed, " << m_block_events << " events (run " << first_run << " event " << first_event
+                << " to run " << last_run << " event " << last_event << ") are dropped" << std::endl;
+      m_events -= m_block_events;
+      m_dropped += m_block_events;
+      m_block_events = 0;
+      m_block.clear();
+      m_pending_index.clear();
+      return;
+    }
+    out = &m_compressed;
+  }
+  m_file.write(out->data(), out->size());
+
+  // prefix the lines of this block with its position in the file
+  std::istringstream lines(m_pending_index);
+  std::string run, event, rest;
+  while (lines >> run >> event && std::getline(lines, rest))
+  {
+    m_index << run << ' ' << event << ' ' << m_offset << ' ' << out->size() << rest << '\n';
+  }
+
+  m_bytes_in += m_block.size();
+  m_bytes_out += out->size();
+  m_offset += out->size();
+  m_block_events = 0;
+  m_block.clear();
+  m_pending_index.clear();
+}
+
+//____________________________________________________________________________..
+void EventDisplayWriter::close()
+{
+  if (!m_file.is_open()) return;
+  flushBlock();
+  m_file.close();
+  m_index.close();
+}
+
+//____________________________________________________________________________..
+bool EventDisplayWriter::compress(Compression compression, const std::string &in, std::string &out)
+{
+  if (compression == kGzip)
+  {
+    z_stream stream{};
+    // 15 + 16: gzip header and trailer, so that every block is a gzip member
+    if (deflateInit2(&stream, Z_DEFAULT_COMPRESSION, Z_DEFLATED, 15 + 16, 8, Z_DEFAULT_STRATEGY) != Z_OK) return false;
+    out.resize(deflateBound(&stream, in.size()));
+    stream.next_in = reinterpret_cast<Bytef *>(const_cast<char *>(in.data()));
+    stream.avail_in = in.size();
+    stream.next_out = reinterpret_cast<Bytef *>(&out[0]);
+    stream.avail_out = out.size();
+    const int status = deflate(&stream, Z_FINISH);
+    out.resize(stream.total_out);
+    deflateEnd(&stream);
+    return status == Z_STREAM_END;
+  }
+#ifdef EVENTDISPLAYWRITER_ZSTD
+  if (compression == kZstd)
+  {
+    out.resize(ZSTD_compressBound(in.size()));
+    const std::size_t size = ZSTD_compress(&out[0], out.size(), in.data(), in.size(), 3);
+    if (ZSTD_isError(size)) return false;
+    out.resize(size);
+    return true;
+  }
+#endif
+  return false;
+}
+
+//____________________________________________________________________________..
+bool EventDisplayWriter::decompress(Compression compression, const std::string &in, std::string &out)
+{
+  if (compression == kNone)
+  {
+    out = in;
+    return true;
+  }
+  if (compression == kGzip)
+  {
+    z_stream stream{};
+    if (inflateInit2(&stream, 15 + 16) != Z_OK) return false;
+    stream.next_in = reinterpret_cast<Bytef *>(const_cast<char *>(in.data()));
+    stream.avail_in = in.size();
+    out.clear();
+    char buffer[1 << 16];
+    int status = Z_OK;
+    while (status == Z_OK)
+    {
+      stream.next_out = reinterpret_cast<Bytef *>(buffer);
+      stream.avail_out = sizeof(buffer);
+      status = inflate(&stream, Z_NO_FLUSH);
+      out.append(buffer, sizeof(buffer) - stream.avail_out);
+    }
+    inflateEnd(&stream);
+    return status == Z_STREAM_END;
+  }
+#ifdef EVENTDISPLAYWRITER_ZSTD
+  if (compression == kZstd)
+  {
+    const unsigned long long size = ZSTD_getFrameContentSize(in.data(), in.size());
+    if (size == ZSTD_CONTENTSIZE_ERROR || size == ZSTD_CONTENTSIZE_UNKNOWN) return false;
+    out.resize(size);
+    return !ZSTD_isError(ZSTD_decompress(&out[0], out.size(), in.data(), in.size()));
+  }
+#endif
+  return false;
+}
+
+//____________________________________________________________________________..
+bool EventDisplayWriter::extract(const std::string &filename, Compression compression, int run, int event, std::string &json)
+{
+  std::ifstream index(filename + ".idx");
+  int irun = 0, ievent = 0;
+  std::uint64_t block_offset = 0, block_bytes = 0, line_offset = 0, line_bytes = 0;
+  while (index >> irun >> ievent >> block_offset >> block_bytes >> line_offset >> line_bytes)
+  {
+    if (irun != run || ievent != event) continue;
+    std::ifstream file(filename, std::ios::binary);
+    std::string block(block_bytes, '\0');
+    if (!file.seekg(block_offset) || !file.read(&block[0], block_bytes)) return false;
+    std::string lines;
+    if (!decompress(compression, block, lines) || line_offset + line_bytes > lines.size()) return false;
+    // without the newline
+    json = lines.substr(line_offset, line_bytes - 1);
+    return true;
+  }
+  return false;
+}
@@ -0,0 +1,94 @@
+// Tell emacs that this is a C++ source
+//  -*- C++ -*-.
+/*!
+ *  \file   EventDisplayWriter.h
+ *  \brief  Streams the event-display JSON of all events into one newline-delimited, optionally compressed file with an offset index
+ */
+
+#ifndef EVENTDISPLAYWRITER_H
+#define EVENTDISPLAYWRITER_H
+
+#include <cstdint>
+#include <fstream>
+#include <string>
+
+/*!
+ * Every event is one line of JSON. Lines are collected in memory and written
+ * as blocks of about blockSize() bytes; with compression every block is an
+ * independent gzip member or zstd frame, so the file is still a regular
+ * .gz / .zst stream for zcat or zstdcat.
+ *
+ * Next to the file, <file>.idx gets one text line per event:
+ *   run event block_offset block_bytes line_offset line_bytes
+ * extract() seeks to the block of one event and inflates only that block.
+ * A block that fails to compress is not written and its events are counted
+ * in dropped().
+ */
+class EventDisplayWriter
+{
+ public:
+  enum Compression
+  {
+    kNone = 0,
+    kGzip = 1,
+    kZstd = 2
+  };
+
+  EventDisplayWriter() = default;
+  ~EventDisplayWriter();
+
+  EventDisplayWriter(const EventDisplayWriter &) = delete;
+  EventDisplayWriter &operator=(const EventDisplayWriter &) = delete;
+
+  /// false if this build cannot write compression
+  static bool available(Compression compression);
+  /// ".ndjson", ".ndjson.gz" or ".ndjson.zst"
+  static std::string extension(Compression compression);
+
+  /// falls back to gzip when compression is not available(), so that compression() is what open() writes
+  void setCompression(Compression compression);
+  Compression compression() const { return m_compression; }
+  void setBlockSize(std::size_t bytes) { m_block_size = bytes; }
+  std::size_t blockSize() const { return m_block_size; }
+
+  /// create filename and filename.idx; false if either cannot be opened
+  bool open(const std::string &filename);
+  bool isOpen() const { return m_file.is_open(); }
+
+  /// append one event; json must not contain a newline
+  void write(int run, int event, const std::string &json);
+
+  /// write the pending block and close both files
+  void close();
+
+  /// events written to the file
+  std::size_t events() const { return m_events; }
+  /// events lost because their block could not be compressed
+  std::size_t dropped() const { return m_dropped; }
+  std::uint64_t bytesIn() const { return m_bytes_in; }
+  std::uint64_t bytesOut() const { return m_bytes_out; }
+
+  /// read the JSON of (run, event) back from a file written with compression, using its index
+  static bool extract(const std::string &filename, Compression compression, int run, int event, std::string &json);
+
+ private:
+  void flushBlock();
+  static bool compress(Compression compression, const std::string &in, std::string &out);
+  static bool decompress(Compression compression, const std::string &in, std::string &out);
+
+  Compression m_compression = kNone;
+  std::size_t m_block_size = 1 << 20;
+  std::ofstream m_file;
+  std::ofstream m_index;
+  std::string m_block;
+  std::string m_compressed;
+  std::string m_pending_index;  // index lines of m_block, without the block position
+  std::uint64_t m_offset = 0;
+  std::size_t m_events = 0;
+  std::size_t m_block_events = 0;
+  std::size_t m_dropped = 0;
+  std::uint64_t m_bytes_in = 0;
+  std::uint64_t m_bytes_out = 0;
+};
+
+#endif // EVENTDISPLAYWRITER_H
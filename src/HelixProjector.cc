@@ -0,0 +1,126 @@
+/*!
+ *  \file   HelixProjector.cc
+ *  \brief  Analytic helix propagation of tracks to arbitrary radii in a uniform solenoid field
+ */
+#include "HelixProjector.h"
+
+#include <cmath>
+
+namespace
+{
+  // pT [GeV] = kCurvature * B [T] * R [cm]
+  const double kCurvature = 0.299792458e-2;
+
+  double wrapPi(double phi)
+  {
+    return std::remainder(phi, 2 * M_PI);
+  }
+}
+
+//____________________________________________________________________________..
+void HelixProjector::clear()
+{
+  m_x0.clear();
+  m_y0.clear();
+  m_z0.clear();
+  m_phi0.clear();
+  m_rho.clear();
+  m_xc.clear();
+  m_yc.clear();
+  m_dzds.clear();
+}
+
+//____________________________________________________________________________..
+void HelixProjector::add(double x, double y, double z, double px, double py, double pz, int charge)
+{
+  const double pt = std::sqrt(px * px + py * py);
+  const double phi0 = std::atan2(py, px);
+  // a positive charge in a field along +z turns clockwise
+  double rho = 0;
+  if (charge != 0 && m_field != 0)
+  {
+    rho = -pt / (kCurvature * m_field * charge);
+  }
+
+  m_x0.push_back(x);
+  m_y0.push_back(y);
+  m_z0.push_back(z);
+  m_phi0.push_back(phi0);
+  m_rho.push_back(rho);
+  m_xc.push_back(x - rho * std::sin(phi0));
+  m_yc.push_back(y + rho * std::cos(phi0));
+  m_dzds.push_back(pz / pt);
+}
+
+//____________________________________________________________________________..
+void HelixProjector::project(double radius, Points &out) const
+{
+  const std::size_t n = size();
+  out.x.resize(n);
+  out.y.resize(n);
+  out.z.resize(n);
+  out.phi.resize(n);
+  out.eta.resize(n);
+
+  const double r2 = radius * radius;
+  for (std::size_t i = 0; i < n; i++)
+  {
+    double xout = NAN;
+    double yout = NAN;
+    double s = NAN;  // transverse path length from the seed
+    const double rho = m_rho[i];
+    if (rho == 0)
+    {
+      // |seed + s u| = radius
+      const double ux = std::cos(m_phi0[i]);
+      const double uy = std::sin(m_phi0[i]);
+      const double b = m_x0[i] * ux + m_y0[i] * uy;
+      const double disc = b * b - (m_x0[i] * m_x0[i] + m_y0[i] * m_y0[i] - r2);
+      if (disc >= 0)
+      {
+        const double root = std::sqrt(disc);
+        s = std::fabs(-b + root) < std::fabs(-b - root) ? -b + root : -b - root;
+        xout = m_x0[i] + s * ux;
+        yout = m_y0[i] + s * uy;
+      }
+    }
+    else
+    {
+      // crossings of the track circle with the cylinder: a along the centre direction, +-h across it
+      const double xc = m_xc[i];
+      const double yc = m_yc[i];
+      const double d = std::sqrt(xc * xc + yc * yc);
+      const double a = (r2 - rho * rho + d * d) / (2 * d);
+      const double h2 = r2 - a * a;
+      if (h2 >= 0)
+      {
+        const double h = std::sqrt(h2);
+        const double ux = xc / d;
+        const double uy = yc / d;
+        double best = INFINITY;
+        for (int sign : {1, -1})
+        {
+          const double qx = a * ux - sign * h * uy;
+          const double qy = a * uy + sign * h * ux;
+          // the helix is centre + rho (sin phi, -cos phi) with phi the direction of motion, phi - phi0 = s / rho
+          const double phi = std::atan2((qx - xc) / rho, -(qy - yc) / rho);
+          const double path = rho * wrapPi(phi - m_phi0[i]);
+          if (std::fabs(path) < std::fabs(best))
+          {
+            best = path;
+            xout = qx;
+            yout = qy;
+          }
+        }
+        s = best;
+      }
+    }
+
+    const double zout = m_z0[i] + s * m_dzds[i];
+    out.x[i] = xout;
+    out.y[i] = yout;
+    out.z[i] = zout;
+    out.phi[i] = std::atan2(yout, xout);
+    out.eta[i] = std::asinh(zout / std::sqrt(xout * xout + yout * yout));
+  }
+}
@@ -0,0 +1,73 @@
+// Tell emacs that this is a C++ source
+//  -*- C++ -*-.
+/*!
+ *  \file   HelixProjector.h
+ *  \brief  Analytic helix propagation of tracks to arbitrary radii in a uniform solenoid field
+ */
+
+#ifndef HELIXPROJECTOR_H
+#define HELIXPROJECTOR_H
+
+#include <cstddef>
+#include <vector>
+
+/*!
+ * Each track is seeded with one state (position in cm, momentum in GeV,
+ * charge), normally the Acts state at the EMCal radius, and is turned into
+ * a helix in a uniform field along z: centre, signed radius, starting
+ * direction and dz/ds are stored in flat per-track arrays. project()
+ * intersects all helices with a cylinder of the given radius in one loop
+ * and takes, of the two crossings, the one with the shorter path from the
+ * seed, so projecting inwards propagates backwards. phi and eta are those
+ * of the projected position as seen from the origin, the convention of the
+ * track-cluster matching. Helices that do not reach the radius, and seeds
+ * containing NaN, give NaN.
+ *
+ * The field is a single number; it is only a good description inside the
+ * solenoid, i.e. between the EMCal and the iHCal. Beyond the coil the
+ * result drifts away from the Acts projection, which TrackToCalo can
+ * measure with validateHelixProjection().
+ */
+class HelixProjector
+{
+ public:
+  struct Points
+  {
+    std::vector<float> x;
+    std::vector<float> y;
+    std::vector<float> z;
+    std::vector<float> phi;
+    std::vector<float> eta;
+  };
+
+  HelixProjector() = default;
+
+  /// field along +z in tesla; applies to the tracks added afterwards
+  void setField(double tesla) { m_field = tesla; }
+  double field() const { return m_field; }
+
+  /// drop all tracks, keeping the allocated capacity
+  void clear();
+
+  /// add a track seeded at (x, y, z) with momentum (px, py, pz); a charge of 0 gives a straight line
+  void add(double x, double y, double z, double px, double py, double pz, int charge);
+
+  std::size_t size() const { return m_x0.size(); }
+
+  /// position of every track on the cylinder of the given radius, in the order the tracks were added
+  void project(double radius, Points &out) const;
+
+ private:
+  double m_field = 1.4;
+
+  std::vector<double> m_x0;
+  std::vector<double> m_y0;
+  std::vector<double> m_z0;
+  std::vector<double> m_phi0;  // direction of the transverse momentum at the seed
+  std::vector<double> m_rho;   // signed radius of curvature in cm, positive when turning counter-clockwise; 0 for a straight line
+  std::vector<double> m_xc;    // centre of the circle, or the seed for a straight line
+  std::vector<double> m_yc;
+  std::vector<double> m_dzds;  // pz / pT
+};
+
+#endif // HELIXPROJECTOR_H
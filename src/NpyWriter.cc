@@ -0,0 +1,165 @@
+/*!
+ *  \file   NpyWriter.cc
+ *  \brief  Appends fixed-shape records to a NumPy .npy file that can be memory-mapped without parsing
+ */
+#include "NpyWriter.h"
+
+#include <cstring>
+
+namespace
+{
+  // the largest record count, used to size the header once
+  const std::size_t kMaxRecords = ~std::size_t(0);
+
+  std::size_t itemSize(NpyWriter::DType dtype)
+  {
+    return dtype == NpyWriter::kFloat16 ? 2 : 4;
+  }
+}
+
+//____________________________________________________________________________..
+NpyWriter::~NpyWriter()
+{
+  close();
+}
+
+//____________________________________________________________________________..
+bool NpyWriter::open(const std::string &filename, DType dtype, const std::vector<std::size_t> &shape)
+{
+  close();
+  m_dtype = dtype;
+  m_shape = shape;
+  m_record_size = 1;
+  for (std::size_t n : shape) m_record_size *= n;
+  m_records = 0;
+  m_buffer.resize(m_record_size * itemSize(dtype));
+
+  m_file.open(filename, std::ios::binary | std::ios::trunc);
+  if (!m_file.is_open()) return false;
+
+  // room for any record count, so that close() never has to move the data
+  m_header_size = 0;
+  m_header_size = header(kMaxRecords).size();
+  m_file << header(0);
+  return m_file.good();
+}
+
+//____________________________________________________________________________..
+std::string NpyWriter::header(std::size_t records) const
+{
+  std::string dict = "{'descr': '";
+  dict += m_dtype == kFloat16 ? "<f2" : (m_dtype == kFloat32 ? "<f4" : "<i4");
+  dict += "', 'fortran_order': False, 'shape': (" + std::to_string(records) + ",";
+  for (std::size_t i = 0; i < m_shape.size(); i++)
+  {
+    dict += (i ? ", " : " ") + std::to_string(m_shape[i]);
+  }
+  dict += "), }";
+
+  // magic, version 1.0 and the header length take 10 bytes; the data starts 64 byte aligned
+  std::size_t total = m_header_size;
+  if (total == 0)
+  {
+    total = (10 + dict.size() + 1 + 63) / 64 * 64;
+  }
+  dict.append(total - 10 - dict.size() - 1, ' ');
+  dict += '\n';
+
+  std::string out("\x93NUMPY\x01\x00", 8);
+  out += static_cast<char>(dict.size() & 0xff);
+  out += static_cast<char>((dict.size() >> 8) & 0xff);
+  return out + dict;
+}
+
+//____________________________________________________________________________..
+void NpyWriter::append(const float *values)
+{
+  if (!m_file.is_open()) return;
+  char *out = m_buffer.data();
+  for (std::size_t i = 0; i < m_record_size; i++)
+  {
+    if (m_dtype == kFloat16)
+    {
+      std::uint16_t half = toHalf(values[i]);
+      std::memcpy(out + 2 * i, &half, 2);
+    }
+    else if (m_dtype == kFloat32)
+    {
+      std::memcpy(out + 4 * i, &values[i], 4);
+    }
+    else
+    {
+      std::int32_t value = static_cast<std::int32_t>(values[i]);
+      std::memcpy(out + 4 * i, &value, 4);
+    }
+  }
+  writeRecord();
+}
+
+//____________________________________________________________________________..
+void NpyWriter::append(const int *values)
+{
+  if (!m_file.is_open()) return;
+  if (m_dtype == kInt32)
+  {
+    std::memcpy(m_buffer.data(), values, m_buffer.size());
+    writeRecord();
+    return;
+  }
+  std::vector<float> converted(values, values + m_record_size);
+  append(converted.data());
+}
+
+//____________________________________________________________________________..
+void NpyWriter::writeRecord()
+{
+  m_file.write(m_buffer.data(), m_buffer.size());
+  m_records++;
+}
+
+//____________________________________________________________________________..
+void NpyWriter::close()
+{
+  if (!m_file.is_open()) return;
+  m_file.seekp(0);
+  m_file << header(m_records);
+  m_file.close();
+}
+
+//____________________________________________________________________________..
+std::uint16_t NpyWriter::toHalf(float value)
+{
+  std::uint32_t bits;
+  std::memcpy(&bits, &value, 4);
+  std::uint16_t sign = (bits >> 16) & 0x8000;
+  std::uint32_t exponent = (bits >> 23) & 0xff;
+  std::uint32_t mantissa = bits & 0x7fffff;
+
+  if (exponent == 0xff)
+  {
+    // inf stays inf, NaN stays a quiet NaN
+    return sign | 0x7c00 | (mantissa ? 0x200 : 0);
+  }
+  int e = static_cast<int>(exponent) - 127 + 15;
+  if (e >= 0x1f)
+  {
+    return sign | 0x7c00;
+  }
+  if (e <= 0)
+  {
+    // subnormal or zero; the implicit leading one becomes explicit
+    if (e < -10) return sign;
+    mantissa |= 0x800000;
+    int shift = 14 - e;
+    std::uint32_t half = mantissa >> shift;
+    std::uint32_t rest = mantissa & ((1U << shift) - 1);
+    std::uint32_t halfway = 1U << (shift - 1);
+    if (rest > halfway || (rest == halfway && (half & 1))) half++;
+    return sign | half;
+  }
+  std::uint32_t half = (e << 10) | (mantissa >> 13);
+  std::uint32_t rest = mantissa & 0x1fff;
+  // a carry out of the mantissa correctly bumps the exponent, up to inf
+  if (rest > 0x1000 || (rest == 0x1000 && (half & 1))) half++;
+  return sign | half;
+}
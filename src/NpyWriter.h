@@ -0,0 +1,76 @@
+// Tell emacs that this is a C++ source
+//  -*- C++ -*-.
+/*!
+ *  \file   NpyWriter.h
+ *  \brief  Appends fixed-shape records to a NumPy .npy file that can be memory-mapped without parsing
+ */
+
+#ifndef NPYWRITER_H
+#define NPYWRITER_H
+
+#include <cstdint>
+#include <fstream>
+#include <string>
+#include <vector>
+
+/*!
+ * The file is a version 1.0 .npy array of shape (N, shape...) in C order,
+ * little endian. The header is written with N = 0 when the file is opened
+ * and padded to a fixed size, so close() can rewrite it in place with the
+ * final record count; records are only ever appended behind it. The data
+ * starts at a 64 byte aligned offset, so
+ *
+ *   numpy.load(file, mmap_mode='r')
+ *
+ * maps it directly. float records can be stored as float16 or float32.
+ * A file that was not closed still has N = 0 in its header; the record
+ * count is then (file size - headerSize()) / record bytes.
+ */
+class NpyWriter
+{
+ public:
+  enum DType
+  {
+    kFloat16 = 0,
+    kFloat32 = 1,
+    kInt32 = 2
+  };
+
+  NpyWriter() = default;
+  ~NpyWriter();
+
+  NpyWriter(const NpyWriter &) = delete;
+  NpyWriter &operator=(const NpyWriter &) = delete;
+
+  /// create filename for records of the given shape; false if it cannot be opened
+  bool open(const std::string &filename, DType dtype, const std::vector<std::size_t> &shape);
+  bool isOpen() const { return m_file.is_open(); }
+
+  /// append one record of recordSize() values; float records of a kInt32 file are truncated
+  void append(const float *values);
+  void append(const int *values);
+
+  /// write the final record count into the header and close the file
+  void close();
+
+  std::size_t recordSize() const { return m_record_size; }
+  std::size_t records() const { return m_records; }
+  std::size_t headerSize() const { return m_header_size; }
+
+  /// IEEE 754 binary16 bits of value, rounded to nearest even
+  static std::uint16_t toHalf(float value);
+
+ private:
+  std::string header(std::size_t records) const;
+  void writeRecord();
+
+  std::ofstream m_file;
+  DType m_dtype = kFloat32;
+  std::vector<std::size_t> m_shape;
+  std::size_t m_record_size = 0;
+  std::size_t m_records = 0;
+  std::size_t m_header_size = 0;
+  std::vector<char> m_buffer;  // one record in the file encoding
+};
+
+#endif // NPYWRITER_H
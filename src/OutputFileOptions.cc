@@ -0,0 +1,43 @@
+/*!
+ *  \file   OutputFileOptions.cc
+ *  \brief  Compression, basket size and flush policy of a module's output file and trees
+ */
+#include "OutputFileOptions.h"
+
+#include <Compression.h>
+#include <TFile.h>
+#include <TTree.h>
+
+//____________________________________________________________________________..
+void OutputFileOptions::setCompression(int algorithm, int level)
+{
+  m_compression = ROOT::CompressionSettings(static_cast<ROOT::RCompressionSetting::EAlgorithm::EValues>(algorithm), level);
+}
+
+//____________________________________________________________________________..
+void OutputFileOptions::applyToFile(TFile *file) const
+{
+  if (!file) return;
+  if (m_compression >= 0)
+  {
+    file->SetCompressionSettings(m_compression);
+  }
+}
+
+//____________________________________________________________________________..
+void OutputFileOptions::applyToTree(TTree *tree) const
+{
+  if (!tree) return;
+  for (const auto &basket : m_basket_sizes)
+  {
+    tree->SetBasketSize(basket.first.c_str(), basket.second);
+  }
+  if (m_has_autoflush)
+  {
+    tree->SetAutoFlush(m_autoflush);
+  }
+  if (m_has_autosave)
+  {
+    tree->SetAutoSave(m_autosave);
+  }
+}
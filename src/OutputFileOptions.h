@@ -0,0 +1,51 @@
+// Tell emacs that this is a C++ source
+//  -*- C++ -*-.
+/*!
+ *  \file   OutputFileOptions.h
+ *  \brief  Compression, basket size and flush policy of a module's output file and trees
+ */
+
+#ifndef OUTPUTFILEOPTIONS_H
+#define OUTPUTFILEOPTIONS_H
+
+#include <string>
+#include <utility>
+#include <vector>
+
+class TFile;
+class TTree;
+
+/*!
+ * Collected by the module setters before Init and applied when the output
+ * is created: applyToFile() right after the TFile is opened, so that every
+ * branch inherits the compression, and applyToTree() after the branches are
+ * booked. Anything not set keeps the ROOT default.
+ */
+class OutputFileOptions
+{
+ public:
+  OutputFileOptions() = default;
+
+  /// algorithm is a ROOT::RCompressionSetting::EAlgorithm (1 ZLIB, 2 LZMA, 4 LZ4, 5 ZSTD), level 0-9
+  void setCompression(int algorithm, int level);
+
+  /// basket size in bytes of the branches matching pattern (TTree::SetBasketSize wildcards, e.g. "_cluster_*")
+  void setBasketSize(const std::string &pattern, int bytes) { m_basket_sizes.push_back({pattern, bytes}); }
+
+  /// TTree::SetAutoFlush/SetAutoSave convention: > 0 entries, < 0 bytes
+  void setAutoFlush(long long value) { m_autoflush = value; m_has_autoflush = true; }
+  void setAutoSave(long long value) { m_autosave = value; m_has_autosave = true; }
+
+  void applyToFile(TFile *file) const;
+  void applyToTree(TTree *tree) const;
+
+ private:
+  int m_compression = -1;
+  std::vector<std::pair<std::string, int>> m_basket_sizes;
+  long long m_autoflush = 0;
+  long long m_autosave = 0;
+  bool m_has_autoflush = false;
+  bool m_has_autosave = false;
+};
+
+#endif // OUTPUTFILEOPTIONS_H
@@ -0,0 +1,124 @@
+/*!
+ *  \file   RNTupleSink.cc
+ *  \brief  Writes the columns of a TreeColumnRegistry as an RNTuple instead of a TTree
+ */
+#include "RNTupleSink.h"
+
+#include <TFile.h>
+#include <RVersion.h>
+
+#include <iostream>
+#include <utility>
+#include <vector>
+
+// RNTuple is production grade from ROOT 6.34 on; 6.36 moved the classes out of ROOT::Experimental
+#if ROOT_VERSION_CODE >= ROOT_VERSION(6, 34, 0)
+#define RNTUPLESINK_ENABLED
+#include <ROOT/RField.hxx>
+#include <ROOT/RNTupleModel.hxx>
+#include <ROOT/RNTupleWriteOptions.hxx>
+#include <ROOT/RNTupleWriter.hxx>
+#if ROOT_VERSION_CODE >= ROOT_VERSION(6, 36, 0)
+namespace rntuple = ROOT;
+#else
+namespace rntuple = ROOT::Experimental;
+#endif
+#endif
+
+struct RNTupleSink::Impl
+{
+  std::string name;
+  TFile *file = nullptr;
+  // (field name, type name, buffer)
+  std::vector<std::pair<std::pair<std::string, std::string>, void *>> fields;
+#ifdef RNTUPLESINK_ENABLED
+  std::unique_ptr<rntuple::RNTupleWriter> writer;
+  std::unique_ptr<rntuple::REntry> entry;
+#endif
+};
+
+//____________________________________________________________________________..
+RNTupleSink::RNTupleSink(const std::string &name, TFile *file)
+  : m_impl(new Impl)
+{
+  m_impl->name = name;
+  m_impl->file = file;
+}
+
+//____________________________________________________________________________..
+RNTupleSink::~RNTupleSink()
+{
+  close();
+}
+
+//____________________________________________________________________________..
+bool RNTupleSink::available()
+{
+#ifdef RNTUPLESINK_ENABLED
+  return true;
+#else
+  return false;
+#endif
+}
+
+//____________________________________________________________________________..
+void RNTupleSink::addColumn(const TreeColumnRegistry::Column &column, void *address)
+{
+  std::string type;
+  switch (column.type)
+  {
+  case TreeColumnRegistry::kFloatVector: type = "std::vector<float>"; break;
+  case TreeColumnRegistry::kIntVector: type = "std::vector<int>"; break;
+  case TreeColumnRegistry::kFloatScalar: type = "float"; break;
+  case TreeColumnRegistry::kIntScalar: type = "int"; break;
+  case TreeColumnRegistry::kFloatArray: type = "std::array<float," + std::to_string(column.size) + ">"; break;
+  }
+  m_impl->fields.push_back({{column.name, type}, address});
+}
+
+//____________________________________________________________________________..
+bool RNTupleSink::open()
+{
+#ifdef RNTUPLESINK_ENABLED
+  auto model = rntuple::RNTupleModel::CreateBare();
+  for (const auto &field : m_impl->fields)
+  {
+    model->AddField(rntuple::RFieldBase::Create(field.first.first, field.first.second).Unwrap());
+  }
+  // same compression as the TTrees of the file
+  rntuple::RNTupleWriteOptions options;
+  options.SetCompression(m_impl->file->GetCompressionSettings());
+  m_impl->writer = rntuple::RNTupleWriter::Append(std::move(model), m_impl->name, *m_impl->file, options);
+  m_impl->entry = m_impl->writer->CreateEntry();
+  // the buffers never move, so they are bound once for the whole run
+  for (const auto &field : m_impl->fields)
+  {
+    m_impl->entry->BindRawPtr(field.first.first, field.second);
+  }
+  return true;
+#else
+  std::cout << "RNTupleSink::open - ROOT " << ROOT_RELEASE << " has no RNTuple writer, " << m_impl->name << " is not written" << std::endl;
+  return false;
+#endif
+}
+
+//____________________________________________________________________________..
+int RNTupleSink::fill()
+{
+#ifdef RNTUPLESINK_ENABLED
+  if (!m_impl->writer) return -1;
+  return m_impl->writer->Fill(*m_impl->entry);
+#else
+  return -1;
+#endif
+}
+
+//____________________________________________________________________________..
+void RNTupleSink::close()
+{
+#ifdef RNTUPLESINK_ENABLED
+  // destroying the writer commits the pages, the footer and the anchor to the file
+  m_impl->entry.reset();
+  m_impl->writer.reset();
+#endif
+}
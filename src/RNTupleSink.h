@@ -0,0 +1,54 @@
+// Tell emacs that this is a C++ source
+//  -*- C++ -*-.
+/*!
+ *  \file   RNTupleSink.h
+ *  \brief  Writes the columns of a TreeColumnRegistry as an RNTuple instead of a TTree
+ */
+
+#ifndef RNTUPLESINK_H
+#define RNTUPLESINK_H
+
+#include "TreeColumnRegistry.h"
+
+#include <memory>
+#include <string>
+
+class TFile;
+
+/*!
+ * Every registry column becomes one RNTuple field of the same type, bound
+ * to the buffer given to addColumn(); std::vector columns are stored as
+ * RNTuple collections with their own offset column, so reading one column
+ * back does not touch the pages of any other. The ROOT 7 headers are only
+ * seen by the implementation; with a ROOT older than 6.34 available() is
+ * false and open() refuses.
+ */
+class RNTupleSink
+{
+ public:
+  RNTupleSink(const std::string &name, TFile *file);
+  ~RNTupleSink();
+
+  RNTupleSink(const RNTupleSink &) = delete;
+  RNTupleSink &operator=(const RNTupleSink &) = delete;
+
+  static bool available();
+
+  /// add a field for column, read from address at every fill(); call before open()
+  void addColumn(const TreeColumnRegistry::Column &column, void *address);
+
+  /// create the RNTuple in the file; false if RNTuple output is not available
+  bool open();
+
+  /// write one entry from the bound buffers; negative if the sink is not open
+  int fill();
+
+  /// commit the RNTuple; must happen before the file is closed
+  void close();
+
+ private:
+  struct Impl;
+  std::unique_ptr<Impl> m_impl;
+};
+
+#endif // RNTUPLESINK_H
@@ -0,0 +1,109 @@
+/*!
+ *  \file   ResidualMonitor.cc
+ *  \brief  Track - calorimeter matching residual histograms accumulated without locks and merged at the end of the run
+ */
+#include "ResidualMonitor.h"
+
+#include <TDirectory.h>
+#include <TH2F.h>
+
+namespace
+{
+  const char *kDetectorNames[ResidualMonitor::kNDetectors] = {"emcal", "ihcaltopo"};
+  const char *kResidualNames[2] = {"dphi", "dz"};
+  const char *kResidualTitles[2] = {"#Delta#phi [rad]", "#Deltaz [cm]"};
+  const char *kVariableNames[3] = {"phi", "z", "qpt"};
+  const char *kVariableTitles[3] = {"#phi_{proj} [rad]", "z_{proj} [cm]", "q p_{T} [GeV]"};
+}
+
+//____________________________________________________________________________..
+void ResidualMonitor::book(float dphi_range, float dz_range, unsigned int nthreads)
+{
+  m_residual_axis[0] = {100, -dphi_range, dphi_range};
+  m_residual_axis[1] = {100, -dz_range, dz_range};
+  m_slot_size = 0;
+  for (int ires = 0; ires < kNResiduals; ires++)
+  {
+    for (int ivar = 0; ivar < kNVariables; ivar++)
+    {
+      m_histogram_size[ires][ivar] = (m_variable_axis[ivar].n + 2) * (m_residual_axis[ires].n + 2);
+      m_slot_size += m_histogram_size[ires][ivar];
+    }
+  }
+  m_slots.assign(nthreads > 0 ? nthreads : 1, std::vector<std::uint32_t>(kNDetectors * m_slot_size, 0));
+  m_entries.assign(m_slots.size(), std::vector<std::uint64_t>(kNDetectors, 0));
+}
+
+//____________________________________________________________________________..
+std::size_t ResidualMonitor::offset(int detector, int residual, int variable) const
+{
+  std::size_t pos = detector * m_slot_size;
+  for (int ires = 0; ires < kNResiduals; ires++)
+  {
+    for (int ivar = 0; ivar < kNVariables; ivar++)
+    {
+      if (ires == residual && ivar == variable) return pos;
+      pos += m_histogram_size[ires][ivar];
+    }
+  }
+  return pos;
+}
+
+//____________________________________________________________________________..
+void ResidualMonitor::fill(unsigned int thread, Detector detector, float dphi, float dz, float phi, float z, float qpt)
+{
+  std::vector<std::uint32_t> &slot = m_slots[thread];
+  const float residuals[kNResiduals] = {dphi, dz};
+  const float variables[kNVariables] = {phi, z, qpt};
+  std::size_t pos = detector * m_slot_size;
+  for (int ires = 0; ires < kNResiduals; ires++)
+  {
+    const int ybin = m_residual_axis[ires].bin(residuals[ires]);
+    for (int ivar = 0; ivar < kNVariables; ivar++)
+    {
+      // same layout as TH2::GetBin(xbin, ybin)
+      slot[pos + ybin * (m_variable_axis[ivar].n + 2) + m_variable_axis[ivar].bin(variables[ivar])]++;
+      pos += m_histogram_size[ires][ivar];
+    }
+  }
+  m_entries[thread][detector]++;
+}
+
+//____________________________________________________________________________..
+std::uint64_t ResidualMonitor::entries(Detector detector) const
+{
+  std::uint64_t n = 0;
+  for (const auto &slot : m_entries) n += slot[detector];
+  return n;
+}
+
+//____________________________________________________________________________..
+void ResidualMonitor::write(TDirectory *dir, const std::string &prefix) const
+{
+  if (!booked()) return;
+  dir->cd();
+  for (int idet = 0; idet < kNDetectors; idet++)
+  {
+    for (int ires = 0; ires < kNResiduals; ires++)
+    {
+      for (int ivar = 0; ivar < kNVariables; ivar++)
+      {
+        const Axis &x = m_variable_axis[ivar];
+        const Axis &y = m_residual_axis[ires];
+        const std::string name = prefix + "_" + kDetectorNames[idet] + "_" + kResidualNames[ires] + "_vs_" + kVariableNames[ivar];
+        const std::string title = std::string(";") + kVariableTitles[ivar] + ";" + kResidualTitles[ires];
+        TH2F *h = new TH2F(name.c_str(), title.c_str(), x.n, x.lo, x.hi, y.n, y.lo, y.hi);
+        const std::size_t pos = offset(idet, ires, ivar);
+        for (std::size_t bin = 0; bin < m_histogram_size[ires][ivar]; bin++)
+        {
+          double sum = 0;
+          for (const auto &slot : m_slots) sum += slot[pos + bin];
+          if (sum > 0) h->SetBinContent(bin, sum);
+        }
+        h->SetEntries(entries(static_cast<Detector>(idet)));
+        h->Write();
+        delete h;
+      }
+    }
+  }
+}
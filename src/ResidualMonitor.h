@@ -0,0 +1,81 @@
+// Tell emacs that this is a C++ source
+//  -*- C++ -*-.
+/*!
+ *  \file   ResidualMonitor.h
+ *  \brief  Track - calorimeter matching residual histograms accumulated without locks and merged at the end of the run
+ */
+
+#ifndef RESIDUALMONITOR_H
+#define RESIDUALMONITOR_H
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+class TDirectory;
+
+/*!
+ * dphi and dz of the track-cluster candidates versus the projected phi, z
+ * and charge-signed pT, for the EMCal clusters and for the topo clusters at
+ * the IHCal radius: 2 x 2 x 3 two-dimensional histograms.
+ *
+ * Every filling thread owns one slot of plain bin counters, so fill() takes
+ * no lock and does no atomic operation. write() adds the slots bin by bin
+ * into TH2F (under- and overflow included) and writes them; it must not run
+ * concurrently with fill().
+ */
+class ResidualMonitor
+{
+ public:
+  enum Detector
+  {
+    kEMCal = 0,
+    kIHCalTopo = 1,
+    kNDetectors = 2
+  };
+
+  ResidualMonitor() = default;
+
+  /// dphi in [-dphi_range, dphi_range], dz in [-dz_range, dz_range]; one slot per filling thread
+  void book(float dphi_range, float dz_range, unsigned int nthreads = 1);
+  bool booked() const { return !m_slots.empty(); }
+
+  void fill(unsigned int thread, Detector detector, float dphi, float dz, float phi, float z, float qpt);
+
+  /// merge the slots into TH2F named <prefix>_<detector>_<residual>_vs_<variable> and write them to dir
+  void write(TDirectory *dir, const std::string &prefix = "residual") const;
+
+  std::uint64_t entries(Detector detector) const;
+
+ private:
+  struct Axis
+  {
+    int n;
+    float lo;
+    float hi;
+    // ROOT convention: 0 underflow, n + 1 overflow, NaN goes to underflow
+    int bin(float v) const
+    {
+      if (!(v >= lo)) return 0;
+      if (v >= hi) return n + 1;
+      return 1 + static_cast<int>((v - lo) / (hi - lo) * n);
+    }
+  };
+  enum
+  {
+    kNResiduals = 2,
+    kNVariables = 3
+  };
+
+  std::size_t offset(int detector, int residual, int variable) const;
+
+  Axis m_residual_axis[kNResiduals] = {{100, -1, 1}, {100, -1, 1}};
+  Axis m_variable_axis[kNVariables] = {{64, -3.1415927f, 3.1415927f}, {60, -150, 150}, {80, -20, 20}};
+  std::size_t m_histogram_size[kNResiduals][kNVariables] = {};
+  std::size_t m_slot_size = 0;
+
+  std::vector<std::vector<std::uint32_t>> m_slots;
+  std::vector<std::vector<std::uint64_t>> m_entries;
+};
+
+#endif // RESIDUALMONITOR_H
@@ -0,0 +1,243 @@
+/*!
+ *  \file   SyntheticConversionEvents.cc
+ *  \brief  Fills the KFParticle, track, truth and decay nodes read by TrackToCalo::fillTree_KFP with random photon conversions
+ */
+#include "SyntheticConversionEvents.h"
+
+#include <calobase/RawClusterContainer.h>
+#include <calobase/RawClusterv1.h>
+#include <calobase/RawTowerDefs.h>
+#include <calobase/RawTowerGeomContainer_Cylinderv1.h>
+
+#include <decayfinder/DecayFinderContainer_v1.h>
+
+#include <fun4all/Fun4AllReturnCodes.h>
+
+#include <g4main/PHG4Particlev2.h>
+#include <g4main/PHG4TruthInfoContainer.h>
+#include <g4main/PHG4VtxPointv1.h>
+
+#include <kfparticle_sphenix/KFParticle_Container.h>
+
+#include <phool/PHCompositeNode.h>
+#include <phool/PHDataNode.h>
+#include <phool/PHIODataNode.h>
+#include <phool/PHNodeIterator.h>
+#include <phool/PHObject.h>
+#include <phool/getClass.h>
+
+#include <trackbase/ActsGeometry.h>
+#include <trackbase/TrkrClusterContainerv4.h>
+#include <trackbase_historic/SvtxPHG4ParticleMap_v1.h>
+#include <trackbase_historic/SvtxTrackMap_v2.h>
+#include <trackbase_historic/SvtxTrack_v4.h>
+
+#include <KFParticle.h>
+
+#include <cmath>
+#include <iostream>
+#include <utility>
+#include <vector>
+
+namespace
+{
+  const float kElectronMass = 0.000511;
+  const float kEMCalRadius = 93.5;
+
+  //! the node name under parent, created with a default T if it does not exist yet
+  template <class T>
+  T *getOrCreate(PHCompositeNode *parent, const std::string &name)
+  {
+    T *object = findNode::getClass<T>(parent, name);
+    if (!object)
+    {
+      object = new T;
+      parent->addNode(new PHIODataNode<PHObject>(object, name, "PHObject"));
+    }
+    return object;
+  }
+
+  RawTowerGeomContainer *getOrCreateGeometry(PHCompositeNode *parent, const std::string &name, RawTowerDefs::CalorimeterId calo, double radius)
+  {
+    RawTowerGeomContainer *geometry = findNode::getClass<RawTowerGeomContainer>(parent, name);
+    if (!geometry)
+    {
+      RawTowerGeomContainer_Cylinderv1 *cylinder = new RawTowerGeomContainer_Cylinderv1(calo);
+      cylinder->set_radius(radius);
+      parent->addNode(new PHIODataNode<PHObject>(cylinder, name, "PHObject"));
+      geometry = cylinder;
+    }
+    return geometry;
+  }
+
+  //! a KFParticle at (x, y, z) with momentum (px, py, pz) and a small diagonal covariance
+  KFParticle makeParticle(float x, float y, float z, float px, float py, float pz, int charge, float mass, int pdg)
+  {
+    const float param[6] = {x, y, z, px, py, pz};
+    // lower triangle; the diagonal elements are 0, 2, 5, 9, 14 and 20
+    float cov[21] = {0};
+    cov[0] = cov[2] = cov[5] = 0.01;
+    cov[9] = cov[14] = cov[20] = 1e-4;
+    KFParticle particle;
+    particle.Create(param, cov, charge, mass);
+    particle.SetPDG(pdg);
+    particle.NDF() = 1;
+    particle.Chi2() = 1;
+    return particle;
+  }
+}
+
+//____________________________________________________________________________..
+SyntheticConversionEvents::SyntheticConversionEvents(const std::string &name)
+  : SubsysReco(name)
+{
+}
+
+//____________________________________________________________________________..
+int SyntheticConversionEvents::InitRun(PHCompositeNode *topNode)
+{
+  PHNodeIterator iter(topNode);
+  PHCompositeNode *dstNode = dynamic_cast<PHCompositeNode *>(iter.findFirst("PHCompositeNode", "DST"));
+  PHCompositeNode *runNode = dynamic_cast<PHCompositeNode *>(iter.findFirst("PHCompositeNode", "RUN"));
+  if (!dstNode || !runNode)
+  {
+    std::cout << "SyntheticConversionEvents::InitRun - DST or RUN node is missing, quitting" << std::endl;
+    return Fun4AllReturnCodes::ABORTRUN;
+  }
+
+  m_kfp_container = getOrCreate<KFParticle_Container>(dstNode, m_kfp_container_name);
+  m_kfp_trackmap = getOrCreate<SvtxTrackMap_v2>(dstNode, m_kfp_trackmap_name);
+  m_truthinfo = getOrCreate<PHG4TruthInfoContainer>(dstNode, "G4TruthInfo");
+  m_reco_truth_map = getOrCreate<SvtxPHG4ParticleMap_v1>(dstNode, "SvtxPHG4ParticleMap");
+  m_decays = getOrCreate<DecayFinderContainer_v1>(dstNode, m_df_module_name + "_DecayMap");
+  m_emcal_clusters = getOrCreate<RawClusterContainer>(dstNode, m_emcal_cluster_name);
+  m_trkr_clusters = getOrCreate<TrkrClusterContainerv4>(dstNode, "TRKR_CLUSTER");
+
+  if (!findNode::getClass<ActsGeometry>(topNode, "ActsGeometry"))
+  {
+    runNode->addNode(new PHDataNode<ActsGeometry>(new ActsGeometry, "ActsGeometry"));
+  }
+  getOrCreateGeometry(runNode, "TOWERGEOM_CEMC", RawTowerDefs::CalorimeterId::CEMC, kEMCalRadius);
+  getOrCreateGeometry(runNode, "TOWERGEOM_HCALIN", RawTowerDefs::CalorimeterId::HCALIN, 117);
+  getOrCreateGeometry(runNode, "TOWERGEOM_HCALOUT", RawTowerDefs::CalorimeterId::HCALOUT, 177.4);
+  return Fun4AllReturnCodes::EVENT_OK;
+}
+
+//____________________________________________________________________________..
+int SyntheticConversionEvents::process_event(PHCompositeNode * /*topNode*/)
+{
+  m_kfp_container->Reset();
+  m_kfp_trackmap->Reset();
+  m_truthinfo->Reset();
+  m_reco_truth_map->Reset();
+  m_decays->Reset();
+  m_emcal_clusters->Reset();
+  m_trkr_clusters->Reset();
+
+  // all photons come from the origin
+  m_truthinfo->AddVertex(1, new PHG4VtxPointv1(0, 0, 0, 0, 1));
+  for (unsigned int iconv = 0; iconv < m_conversions; iconv++)
+  {
+    addConversion(iconv);
+  }
+  return Fun4AllReturnCodes::EVENT_OK;
+}
+
+//____________________________________________________________________________..
+void SyntheticConversionEvents::addConversion(unsigned int iconv)
+{
+  std::uniform_real_distribution<float> pt_dist(0.5, 5);
+  std::uniform_real_distribution<float> eta_dist(-1, 1);
+  std::uniform_real_distribution<float> phi_dist(-M_PI, M_PI);
+  std::uniform_real_distribution<float> radius_dist(5, 60);
+  std::uniform_real_distribution<float> fraction_dist(0.2, 0.8);
+
+  const float pt = pt_dist(m_rng);
+  const float eta = eta_dist(m_rng);
+  const float phi = phi_dist(m_rng);
+  const float radius = radius_dist(m_rng);
+  const float fraction = fraction_dist(m_rng);
+
+  // photon direction; the pair is emitted collinear at the conversion point
+  const float ux = std::cos(phi);
+  const float uy = std::sin(phi);
+  const float uz = std::sinh(eta);
+  const float cx = radius * ux;
+  const float cy = radius * uy;
+  const float cz = radius * uz;
+
+  // truth: primaries have positive, secondaries negative track and vertex ids
+  const int gamma_id = iconv + 1;
+  const int daughter_id[2] = {-static_cast<int>(2 * iconv + 1), -static_cast<int>(2 * iconv + 2)};
+  const int conversion_vtx = -static_cast<int>(iconv + 1);
+  const int pid[2] = {-11, 11};
+  const int charge[2] = {1, -1};
+  const float share[2] = {fraction, 1 - fraction};
+
+  m_truthinfo->AddVertex(conversion_vtx, new PHG4VtxPointv1(cx, cy, cz, 0, conversion_vtx));
+  PHG4Particlev2 *gamma = new PHG4Particlev2("gamma", 22, pt * ux, pt * uy, pt * uz);
+  gamma->set_track_id(gamma_id);
+  gamma->set_vtx_id(1);
+  gamma->set_parent_id(0);
+  gamma->set_primary_id(gamma_id);
+  gamma->set_barcode(gamma_id);
+  gamma->set_e(pt * std::cosh(eta));
+  m_truthinfo->AddParticle(gamma_id, gamma);
+
+  std::vector<std::pair<std::pair<int, int>, int>> decay;
+  decay.push_back({{0, gamma_id}, 22});
+
+  // KFParticle entries and their tracks, as (gamma, e+, e-)
+  const unsigned int first_key = 3 * iconv;
+  KFParticle kfp_gamma = makeParticle(cx, cy, cz, pt * ux, pt * uy, pt * uz, 0, 0, 22);
+  m_kfp_container->insert(&kfp_gamma);
+  SvtxTrack_v4 track;
+  track.set_id(first_key);
+  track.set_x(cx);
+  track.set_y(cy);
+  track.set_z(cz);
+  track.set_px(pt * ux);
+  track.set_py(pt * uy);
+  track.set_pz(pt * uz);
+  track.set_charge(0);
+  m_kfp_trackmap->insertWithKey(&track, first_key);
+
+  for (int j = 0; j < 2; j++)
+  {
+    const float dpt = share[j] * pt;
+    const int barcode = 1000000 + 2 * iconv + j;
+
+    PHG4Particlev2 *daughter = new PHG4Particlev2(j == 0 ? "e+" : "e-", pid[j], dpt * ux, dpt * uy, dpt * uz);
+    daughter->set_track_id(daughter_id[j]);
+    daughter->set_vtx_id(conversion_vtx);
+    daughter->set_parent_id(gamma_id);
+    daughter->set_primary_id(gamma_id);
+    daughter->set_barcode(barcode);
+    daughter->set_e(std::sqrt(dpt * dpt * (1 + uz * uz) + kElectronMass * kElectronMass));
+    m_truthinfo->AddParticle(daughter_id[j], daughter);
+    decay.push_back({{0, barcode}, pid[j]});
+
+    KFParticle kfp_daughter = makeParticle(cx, cy, cz, dpt * ux, dpt * uy, dpt * uz, charge[j], kElectronMass, pid[j]);
+    m_kfp_container->insert(&kfp_daughter);
+
+    const unsigned int key = first_key + 1 + j;
+    track.set_id(key);
+    track.set_px(dpt * ux);
+    track.set_py(dpt * uy);
+    track.set_pz(dpt * uz);
+    track.set_charge(charge[j]);
+    track.set_chisq(10);
+    track.set_ndf(20);
+    m_kfp_trackmap->insertWithKey(&track, key);
+    m_reco_truth_map->insert(key, {{1.0, {daughter_id[j]}}});
+
+    // an EMCal cluster where the straight daughter hits the calorimeter
+    RawClusterv1 *cluster = new RawClusterv1();
+    cluster->set_energy(dpt * std::cosh(eta));
+    cluster->set_r(kEMCalRadius);
+    cluster->set_phi(phi);
+    cluster->set_z(kEMCalRadius * uz);
+    m_emcal_clusters->AddCluster(cluster);
+  }
+  m_decays->insert(decay);
+}
@@ -0,0 +1,76 @@
+// Tell emacs that this is a C++ source
+//  -*- C++ -*-.
+/*!
+ *  \file   SyntheticConversionEvents.h
+ *  \brief  Fills the KFParticle, track, truth and decay nodes read by TrackToCalo::fillTree_KFP with random photon conversions
+ */
+
+#ifndef SYNTHETICCONVERSIONEVENTS_H
+#define SYNTHETICCONVERSIONEVENTS_H
+
+#include <fun4all/SubsysReco.h>
+
+#include <random>
+#include <string>
+
+class DecayFinderContainer_v1;
+class KFParticle_Container;
+class PHCompositeNode;
+class PHG4TruthInfoContainer;
+class RawClusterContainer;
+class SvtxPHG4ParticleMap_v1;
+class SvtxTrackMap;
+class TrkrClusterContainer;
+
+/*!
+ * Event generator for tests of TrackToCalo without a DST, e.g. with a
+ * Fun4AllDummyInputManager. Every event holds conversions() photons that
+ * convert into an e+ e- pair at a random radius, stored the way the photon
+ * conversion reconstruction leaves them:
+ *  - (gamma, e+, e-) triplets in the KFParticle container and the same
+ *    number of tracks, in the same order, in the KFParticle track map,
+ *  - the photon and its daughters with their vertices in G4TruthInfo,
+ *  - the reco to truth table in SvtxPHG4ParticleMap,
+ *  - one decay per photon in the <decay finder name>_DecayMap.
+ * Empty tracker clusters, an Acts geometry without surfaces, EMCal
+ * clusters near the daughters and calorimeter geometries that only carry
+ * their radius complete what TrackToCalo needs. The nodes are created once
+ * and refilled every event, like the nodes of an input file.
+ */
+class SyntheticConversionEvents : public SubsysReco
+{
+ public:
+  SyntheticConversionEvents(const std::string &name = "SyntheticConversionEvents");
+  ~SyntheticConversionEvents() override = default;
+
+  int InitRun(PHCompositeNode *topNode) override;
+  int process_event(PHCompositeNode *topNode) override;
+
+  void setConversions(unsigned int n) {m_conversions = n;}
+  void setSeed(unsigned int seed) {m_rng.seed(seed);}
+  void setDFNodeName(const std::string &name) {m_df_module_name = name;}
+  void setKFPContName(const std::string &name) {m_kfp_container_name = name;}
+  void setKFPtrackMapName(const std::string &name) {m_kfp_trackmap_name = name;}
+  void setRawClusContEMName(const std::string &name) {m_emcal_cluster_name = name;}
+
+ private:
+  void addConversion(unsigned int iconv);
+
+  unsigned int m_conversions = 5;
+  std::string m_df_module_name;
+  std::string m_kfp_container_name = "KFParticle_Container";
+  std::string m_kfp_trackmap_name = "SvtxTrackMap";
+  std::string m_emcal_cluster_name = "TOPOCLUSTER_EMCAL";
+
+  std::mt19937 m_rng{12345};
+
+  KFParticle_Container *m_kfp_container = nullptr;
+  SvtxTrackMap *m_kfp_trackmap = nullptr;
+  PHG4TruthInfoContainer *m_truthinfo = nullptr;
+  SvtxPHG4ParticleMap_v1 *m_reco_truth_map = nullptr;
+  DecayFinderContainer_v1 *m_decays = nullptr;
+  RawClusterContainer *m_emcal_clusters = nullptr;
+  TrkrClusterContainer *m_trkr_clusters = nullptr;
+};
+
+#endif // SYNTHETICCONVERSIONEVENTS_H
@@ -0,0 +1,183 @@
+/*!
+ *  \file   TowerChannelMonitor.cc
+ *  \brief  Running per-channel tower statistics and hot/dead channel flags, without tower trees
+ */
+#include "TowerChannelMonitor.h"
+
+#include <TDirectory.h>
+#include <TTree.h>
+
+#include <algorithm>
+#include <cmath>
+
+//____________________________________________________________________________..
+void TowerChannelMonitor::book(const std::vector<std::size_t> &nchannels)
+{
+  m_offset.assign(1, 0);
+  for (std::size_t n : nchannels)
+  {
+    m_offset.push_back(m_offset.back() + n);
+  }
+  const std::size_t size = m_offset.back();
+  m_events = 0;
+
+  for (auto *stage : {&m_good, &m_energy, &m_time, &m_pedestal})
+  {
+    stage->assign(size, 0);
+  }
+  m_threshold.assign(size, 0);
+  for (auto *sum : {&m_n, &m_above, &m_mean_e, &m_m2_e, &m_mean_event, &m_m2_event, &m_mean_time, &m_m2_time,
+                    &m_cov_time, &m_mean_pedestal, &m_m2_pedestal, &m_cov_pedestal})
+  {
+    sum->assign(size, 0);
+  }
+}
+
+//____________________________________________________________________________..
+void TowerChannelMonitor::setOccupancyThreshold(int calo, float e_min)
+{
+  std::fill(m_threshold.begin() + m_offset[calo], m_threshold.begin() + m_offset[calo + 1], e_min);
+}
+
+//____________________________________________________________________________..
+void TowerChannelMonitor::update()
+{
+  const std::size_t size = m_good.size();
+  const double event = m_events;
+  // plain pointers and no branches, so that the compiler can vectorise the loop
+  const float *good = m_good.data();
+  const float *energy = m_energy.data();
+  const float *time = m_time.data();
+  const float *pedestal = m_pedestal.data();
+  const float *threshold = m_threshold.data();
+  double *n = m_n.data();
+  double *above = m_above.data();
+  double *mean_e = m_mean_e.data();
+  double *m2_e = m_m2_e.data();
+  double *mean_event = m_mean_event.data();
+  double *m2_event = m_m2_event.data();
+  double *mean_time = m_mean_time.data();
+  double *m2_time = m_m2_time.data();
+  double *cov_time = m_cov_time.data();
+  double *mean_pedestal = m_mean_pedestal.data();
+  double *m2_pedestal = m_m2_pedestal.data();
+  double *cov_pedestal = m_cov_pedestal.data();
+
+  for (std::size_t i = 0; i < size; i++)
+  {
+    // weighted Welford update with weight 0 or 1; a weight of 0 leaves every sum unchanged
+    const double w = good[i];
+    const double count = n[i] + w;
+    const double inv = w / std::max(count, 1.0);
+    n[i] = count;
+    above[i] += w * (energy[i] > threshold[i]);
+
+    const double d_event = event - mean_event[i];
+    mean_event[i] += d_event * inv;
+    m2_event[i] += w * d_event * (event - mean_event[i]);
+
+    const double d_e = energy[i] - mean_e[i];
+    mean_e[i] += d_e * inv;
+    m2_e[i] += w * d_e * (energy[i] - mean_e[i]);
+
+    const double d_time = time[i] - mean_time[i];
+    mean_time[i] += d_time * inv;
+    m2_time[i] += w * d_time * (time[i] - mean_time[i]);
+    cov_time[i] += w * d_event * (time[i] - mean_time[i]);
+
+    const double d_pedestal = pedestal[i] - mean_pedestal[i];
+    mean_pedestal[i] += d_pedestal * inv;
+    m2_pedestal[i] += w * d_pedestal * (pedestal[i] - mean_pedestal[i]);
+    cov_pedestal[i] += w * d_event * (pedestal[i] - mean_pedestal[i]);
+  }
+  std::fill(m_good.begin(), m_good.end(), 0);
+  m_events++;
+}
+
+//____________________________________________________________________________..
+std::size_t TowerChannelMonitor::write(TDirectory *dir, const std::string &prefix) const
+{
+  int calo = 0, channel = 0, flags = 0;
+  float entries = 0, mean_e = 0, rms_e = 0, occupancy = 0, bad_fraction = 0;
+  float mean_time = 0, rms_time = 0, time_drift = 0, mean_pedestal = 0, rms_pedestal = 0, pedestal_drift = 0;
+
+  dir->cd();
+  TTree *summary = new TTree((prefix + "_summary").c_str(), "running tower statistics per channel");
+  summary->Branch("calo", &calo);
+  summary->Branch("channel", &channel);
+  summary->Branch("flags", &flags);
+  summary->Branch("entries", &entries);
+  summary->Branch("mean_e", &mean_e);
+  summary->Branch("rms_e", &rms_e);
+  summary->Branch("occupancy", &occupancy);
+  summary->Branch("bad_fraction", &bad_fraction);
+  summary->Branch("mean_time", &mean_time);
+  summary->Branch("rms_time", &rms_time);
+  summary->Branch("time_drift", &time_drift);
+  summary->Branch("mean_pedestal", &mean_pedestal);
+  summary->Branch("rms_pedestal", &rms_pedestal);
+  summary->Branch("pedestal_drift", &pedestal_drift);
+  TTree *flagged = new TTree((prefix + "_flagged").c_str(), "flagged channels");
+  flagged->Branch("calo", &calo);
+  flagged->Branch("channel", &channel);
+  flagged->Branch("flags", &flags);
+
+  const double events = std::max<double>(m_events, 1);
+  std::size_t nflagged = 0;
+  std::vector<double> occupancies;
+  for (calo = 0; calo + 1 < (int) m_offset.size(); calo++)
+  {
+    const std::size_t begin = m_offset[calo];
+    const std::size_t end = m_offset[calo + 1];
+
+    // reference occupancy of the calorimeter, over the channels that were ever good
+    occupancies.clear();
+    for (std::size_t i = begin; i < end; i++)
+    {
+      if (m_n[i] > 0) occupancies.push_back(m_above[i] / events);
+    }
+    double median = 0;
+    if (!occupancies.empty())
+    {
+      std::nth_element(occupancies.begin(), occupancies.begin() + occupancies.size() / 2, occupancies.end());
+      median = occupancies[occupancies.size() / 2];
+    }
+
+    for (std::size_t i = begin; i < end; i++)
+    {
+      channel = i - begin;
+      entries = m_n[i];
+      occupancy = m_above[i] / events;
+      bad_fraction = 1 - m_n[i] / events;
+      mean_e = m_mean_e[i];
+      rms_e = m_n[i] > 1 ? std::sqrt(m_m2_e[i] / (m_n[i] - 1)) : 0;
+      mean_time = m_mean_time[i];
+      rms_time = m_n[i] > 1 ? std::sqrt(m_m2_time[i] / (m_n[i] - 1)) : 0;
+      mean_pedestal = m_mean_pedestal[i];
+      rms_pedestal = m_n[i] > 1 ? std::sqrt(m_m2_pedestal[i] / (m_n[i] - 1)) : 0;
+      // least-squares slope against the event number, times the length of the run
+      time_drift = m_m2_event[i] > 0 ? m_cov_time[i] / m_m2_event[i] * m_events : 0;
+      pedestal_drift = m_m2_event[i] > 0 ? m_cov_pedestal[i] / m_m2_event[i] * m_events : 0;
+
+      flags = 0;
+      if (median > 0 && occupancy > m_hot_factor * median) flags |= kHot;
+      if (m_n[i] > 0 && (occupancy < m_dead_factor * median || (m_n[i] > 1 && m_m2_e[i] <= 0))) flags |= kDead;
+      if (bad_fraction > m_bad_fraction) flags |= kBadStatus;
+      if (m_pedestal_drift > 0 && std::fabs(pedestal_drift) > m_pedestal_drift) flags |= kPedestalDrift;
+      if (m_time_drift > 0 && std::fabs(time_drift) > m_time_drift) flags |= kTimeDrift;
+
+      summary->Fill();
+      if (flags)
+      {
+        flagged->Fill();
+        nflagged++;
+      }
+    }
+  }
+  summary->Write();
+  flagged->Write();
+  // written once here; deleting detaches them so that a later TFile::Write does not add a second cycle
+  delete summary;
+  delete flagged;
+  return nflagged;
+}
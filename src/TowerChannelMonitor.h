@@ -0,0 +1,111 @@
+// Tell emacs that this is a C++ source
+//  -*- C++ -*-.
+/*!
+ *  \file   TowerChannelMonitor.h
+ *  \brief  Running per-channel tower statistics and hot/dead channel flags, without tower trees
+ */
+
+#ifndef TOWERCHANNELMONITOR_H
+#define TOWERCHANNELMONITOR_H
+
+#include <cstddef>
+#include <string>
+#include <vector>
+
+class TDirectory;
+
+/*!
+ * The channels of all calorimeters are laid out in one flat range. Per
+ * event the towers are staged with set(), then update() folds them into
+ * the running statistics in a single branch-free pass over flat arrays:
+ * Welford mean and variance of energy, time and pedestal over the good
+ * towers, the occupancy above a per-calorimeter energy threshold, the
+ * fraction of bad-status towers, and the covariance of time and pedestal
+ * with the event number, from which their drift over the run follows.
+ *
+ * write() classifies the channels against the median occupancy of their
+ * calorimeter and writes a summary tree with one entry per channel and a
+ * tree with only the flagged ones.
+ */
+class TowerChannelMonitor
+{
+ public:
+  enum Flag
+  {
+    kHot = 1 << 0,            // occupancy above hot factor x calorimeter median
+    kDead = 1 << 1,           // occupancy below dead factor x median, or no energy spread at all
+    kBadStatus = 1 << 2,      // not get_isGood() in more than the bad fraction of the events
+    kPedestalDrift = 1 << 3,  // pedestal moved by more than the allowed drift over the run
+    kTimeDrift = 1 << 4
+  };
+
+  TowerChannelMonitor() = default;
+
+  /// one calorimeter per entry of nchannels; clears the statistics
+  void book(const std::vector<std::size_t> &nchannels);
+  bool booked() const { return !m_offset.empty(); }
+  /// booked channels of calo, 0 if it is not booked
+  std::size_t channels(int calo) const { return calo + 1 < (int) m_offset.size() ? m_offset[calo + 1] - m_offset[calo] : 0; }
+
+  /// towers above e_min count towards the occupancy of calo
+  void setOccupancyThreshold(int calo, float e_min);
+  void setHotFactor(float factor) { m_hot_factor = factor; }
+  void setDeadFactor(float factor) { m_dead_factor = factor; }
+  void setBadFraction(float fraction) { m_bad_fraction = fraction; }
+  /// largest allowed change over the run, 0 disables the flag
+  void setPedestalDrift(float drift) { m_pedestal_drift = drift; }
+  void setTimeDrift(float drift) { m_time_drift = drift; }
+
+  /// stage one tower of the current event; channels that are not set count as bad, channels that are not booked are ignored
+  void set(int calo, std::size_t channel, bool good, float energy, float time, float pedestal)
+  {
+    if (channel >= channels(calo)) return;
+    const std::size_t i = m_offset[calo] + channel;
+    // bad towers get zero weight; their values are zeroed so that a NaN cannot leak into the sums
+    m_good[i] = good;
+    m_energy[i] = good ? energy : 0;
+    m_time[i] = good ? time : 0;
+    m_pedestal[i] = good ? pedestal : 0;
+  }
+
+  /// fold the staged event into the statistics and clear the stage
+  void update();
+
+  std::size_t events() const { return m_events; }
+
+  /// classify the channels and write <prefix>_summary and <prefix>_flagged to dir; returns the number of flagged channels
+  std::size_t write(TDirectory *dir, const std::string &prefix = "channel_qa") const;
+
+ private:
+  std::vector<std::size_t> m_offset;  // first flat channel of every calorimeter, plus the total
+  std::size_t m_events = 0;
+
+  float m_hot_factor = 10;
+  float m_dead_factor = 0.01;
+  float m_bad_fraction = 0.5;
+  float m_pedestal_drift = 0;
+  float m_time_drift = 0;
+
+  // stage of the current event
+  std::vector<float> m_good;
+  std::vector<float> m_energy;
+  std::vector<float> m_time;
+  std::vector<float> m_pedestal;
+  std::vector<float> m_threshold;
+
+  // running statistics, weighted by the good flag
+  std::vector<double> m_n;
+  std::vector<double> m_above;
+  std::vector<double> m_mean_e;
+  std::vector<double> m_m2_e;
+  std::vector<double> m_mean_event;
+  std::vector<double> m_m2_event;
+  std::vector<double> m_mean_time;
+  std::vector<double> m_m2_time;
+  std::vector<double> m_cov_time;  // with the event number
+  std::vector<double> m_mean_pedestal;
+  std::vector<double> m_m2_pedestal;
+  std::vector<double> m_cov_pedestal;
+};
+
+#endif // TOWERCHANNELMONITOR_H
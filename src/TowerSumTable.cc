@@ -0,0 +1,48 @@
+/*!
+ *  \file   TowerSumTable.cc
+ *  \brief  Summed-area table of a calorimeter tower energy map for O(1) NxN window sums
+ */
+#include "TowerSumTable.h"
+
+#include <algorithm>
+
+//____________________________________________________________________________..
+void TowerSumTable::build(const float *energy, int neta, int nphi)
+{
+  m_neta = neta;
+  m_nphi = nphi;
+  const int stride = nphi + 1;
+  m_table.assign((neta + 1) * stride, 0);
+  for (int ieta = 0; ieta < neta; ieta++)
+  {
+    double row = 0;
+    for (int iphi = 0; iphi < nphi; iphi++)
+    {
+      row += energy[ieta * nphi + iphi];
+      m_table[(ieta + 1) * stride + iphi + 1] = m_table[ieta * stride + iphi + 1] + row;
+    }
+  }
+}
+
+//____________________________________________________________________________..
+double TowerSumTable::rect(int eta0, int eta1, int phi0, int phi1) const
+{
+  const int stride = m_nphi + 1;
+  return m_table[eta1 * stride + phi1] - m_table[eta0 * stride + phi1] - m_table[eta1 * stride + phi0] + m_table[eta0 * stride + phi0];
+}
+
+//____________________________________________________________________________..
+float TowerSumTable::sum(int ieta, int iphi, int n) const
+{
+  if (m_nphi == 0) return 0;
+  const int half = n / 2;
+  const int eta0 = std::max(0, ieta - half);
+  const int eta1 = std::min(m_neta, ieta + half + 1);
+  if (eta0 >= eta1) return 0;
+
+  if (n >= m_nphi) return rect(eta0, eta1, 0, m_nphi);
+  const int phi0 = ((iphi - half) % m_nphi + m_nphi) % m_nphi;
+  const int phi1 = phi0 + n;
+  if (phi1 <= m_nphi) return rect(eta0, eta1, phi0, phi1);
+  return rect(eta0, eta1, phi0, m_nphi) + rect(eta0, eta1, 0, phi1 - m_nphi);
+}
@@ -0,0 +1,48 @@
+// Tell emacs that this is a C++ source
+//  -*- C++ -*-.
+/*!
+ *  \file   TowerSumTable.h
+ *  \brief  Summed-area table of a calorimeter tower energy map for O(1) NxN window sums
+ */
+
+#ifndef TOWERSUMTABLE_H
+#define TOWERSUMTABLE_H
+
+#include <vector>
+
+/*!
+ * Integral image of an eta x phi tower energy map, built once per event.
+ * Entry (e, p) holds the energy of all towers with eta bin < e and phi bin
+ * < p, accumulated in double so that differences of large partial sums keep
+ * the precision of single towers. sum() adds the towers of an n x n window
+ * around a tower with four lookups per rectangle: the window is cut at the
+ * eta edges of the detector and wraps around in phi, where it is split into
+ * two rectangles.
+ */
+class TowerSumTable
+{
+ public:
+  TowerSumTable() = default;
+
+  /// build from energy[ieta * nphi + iphi]
+  void build(const float *energy, int neta, int nphi);
+
+  /// energy of the n x n towers centred on (ieta, iphi); 0 if the window misses the detector
+  float sum(int ieta, int iphi, int n) const;
+
+  /// energy of the whole map
+  double total() const { return m_table.empty() ? 0 : m_table.back(); }
+
+  int etaBins() const { return m_neta; }
+  int phiBins() const { return m_nphi; }
+
+ private:
+  // towers with eta0 <= eta bin < eta1 and phi0 <= phi bin < phi1
+  double rect(int eta0, int eta1, int phi0, int phi1) const;
+
+  int m_neta = 0;
+  int m_nphi = 0;
+  std::vector<double> m_table;  // (m_neta + 1) x (m_nphi + 1)
+};
+
+#endif // TOWERSUMTABLE_H
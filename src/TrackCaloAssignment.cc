@@ -0,0 +1,220 @@
+/*!
+ *  \file   TrackCaloAssignment.cc
+ *  \brief  One-to-one assignment of tracks to calorimeter clusters from the candidate pairs of the matching window
+ */
+#include "TrackCaloAssignment.h"
+
+#include <algorithm>
+#include <cmath>
+#include <limits>
+#include <map>
+
+namespace
+{
+  // cost of a pair that is not a candidate; larger than any sum of real residuals
+  const double kNoEdge = 1e9;
+}
+
+//____________________________________________________________________________..
+void TrackCaloAssignment::clear()
+{
+  m_track.clear();
+  m_cluster.clear();
+  m_residual.clear();
+  m_ntracks = 0;
+  m_nclusters = 0;
+  m_assigned.clear();
+  m_runner_up.clear();
+}
+
+//____________________________________________________________________________..
+unsigned int TrackCaloAssignment::add(unsigned int track, unsigned int cluster, float residual)
+{
+  m_track.push_back(track);
+  m_cluster.push_back(cluster);
+  m_residual.push_back(residual);
+  m_ntracks = std::max(m_ntracks, track + 1);
+  m_nclusters = std::max(m_nclusters, cluster + 1);
+  return m_residual.size() - 1;
+}
+
+//____________________________________________________________________________..
+unsigned int TrackCaloAssignment::find(unsigned int node)
+{
+  while (m_parent[node] != node)
+  {
+    m_parent[node] = m_parent[m_parent[node]];
+    node = m_parent[node];
+  }
+  return node;
+}
+
+//____________________________________________________________________________..
+void TrackCaloAssignment::solve(Method method, unsigned int max_component)
+{
+  const std::size_t nedges = m_residual.size();
+  m_assigned.assign(m_ntracks, -1);
+  m_cluster_taken.assign(m_nclusters, 0);
+  m_runner_up.assign(m_ntracks, NAN);
+  m_exact.assign(nedges, 0);
+  m_exact_components = 0;
+  m_greedy_components = 0;
+
+  if (method == kHungarian)
+  {
+    // connected components; clusters are nodes m_ntracks + cluster
+    m_parent.resize(m_ntracks + m_nclusters);
+    for (unsigned int i = 0; i < m_parent.size(); i++) m_parent[i] = i;
+    for (std::size_t e = 0; e < nedges; e++)
+    {
+      unsigned int a = find(m_track[e]);
+      unsigned int b = find(m_ntracks + m_cluster[e]);
+      if (a != b) m_parent[a] = b;
+    }
+    std::map<unsigned int, std::vector<unsigned int>> components;
+    for (std::size_t e = 0; e < nedges; e++)
+    {
+      components[find(m_track[e])].push_back(e);
+    }
+    for (const auto &component : components)
+    {
+      std::vector<unsigned int> tracks, clusters;
+      for (unsigned int e : component.second)
+      {
+        tracks.push_back(m_track[e]);
+        clusters.push_back(m_cluster[e]);
+      }
+      std::sort(tracks.begin(), tracks.end());
+      std::sort(clusters.begin(), clusters.end());
+      tracks.erase(std::unique(tracks.begin(), tracks.end()), tracks.end());
+      clusters.erase(std::unique(clusters.begin(), clusters.end()), clusters.end());
+      if (tracks.size() > max_component || clusters.size() > max_component)
+      {
+        m_greedy_components++;
+        continue;
+      }
+      hungarian(component.second);
+      for (unsigned int e : component.second) m_exact[e] = 1;
+      m_exact_components++;
+    }
+  }
+
+  // greedy by residual over the edges not solved exactly; ties keep the insertion order
+  m_order.clear();
+  for (std::size_t e = 0; e < nedges; e++)
+  {
+    if (!m_exact[e]) m_order.push_back(e);
+  }
+  std::stable_sort(m_order.begin(), m_order.end(), [this](unsigned int a, unsigned int b) { return m_residual[a] < m_residual[b]; });
+  if (method == kGreedy && !m_order.empty()) m_greedy_components = 1;
+  for (unsigned int e : m_order)
+  {
+    if (m_assigned[m_track[e]] >= 0 || m_cluster_taken[m_cluster[e]]) continue;
+    m_assigned[m_track[e]] = e;
+    m_cluster_taken[m_cluster[e]] = 1;
+  }
+
+  // runner-up: best residual of the candidates other than the assigned one
+  for (std::size_t e = 0; e < nedges; e++)
+  {
+    const unsigned int track = m_track[e];
+    if (static_cast<int>(e) == m_assigned[track]) continue;
+    if (std::isnan(m_runner_up[track]) || m_residual[e] < m_runner_up[track]) m_runner_up[track] = m_residual[e];
+  }
+}
+
+//____________________________________________________________________________..
+void TrackCaloAssignment::hungarian(const std::vector<unsigned int> &component_edges)
+{
+  // local dense ids
+  std::map<unsigned int, int> track_id, cluster_id;
+  for (unsigned int e : component_edges)
+  {
+    track_id.emplace(m_track[e], 0);
+    cluster_id.emplace(m_cluster[e], 0);
+  }
+  std::vector<unsigned int> tracks, clusters;
+  for (auto &t : track_id) { t.second = tracks.size(); tracks.push_back(t.first); }
+  for (auto &c : cluster_id) { c.second = clusters.size(); clusters.push_back(c.first); }
+
+  // rows are the smaller side
+  const bool transposed = tracks.size() > clusters.size();
+  const int n = transposed ? clusters.size() : tracks.size();
+  const int m = transposed ? tracks.size() : clusters.size();
+  std::vector<double> cost((n + 1) * (m + 1), kNoEdge);
+  std::vector<int> edge_of((n + 1) * (m + 1), -1);
+  for (unsigned int e : component_edges)
+  {
+    int row = 1 + (transposed ? cluster_id[m_cluster[e]] : track_id[m_track[e]]);
+    int col = 1 + (transposed ? track_id[m_track[e]] : cluster_id[m_cluster[e]]);
+    if (edge_of[row * (m + 1) + col] < 0 || m_residual[e] < cost[row * (m + 1) + col])
+    {
+      cost[row * (m + 1) + col] = m_residual[e];
+      edge_of[row * (m + 1) + col] = e;
+    }
+  }
+
+  // O(n^2 m) shortest augmenting path with potentials; p[col] is the row of column col
+  const double inf = std::numeric_limits<double>::infinity();
+  std::vector<double> u(n + 1, 0), v(m + 1, 0), minv(m + 1);
+  std::vector<int> p(m + 1, 0), way(m + 1, 0);
+  std::vector<char> used(m + 1);
+  for (int i = 1; i <= n; i++)
+  {
+    p[0] = i;
+    int j0 = 0;
+    std::fill(minv.begin(), minv.end(), inf);
+    std::fill(used.begin(), used.end(), 0);
+    do
+    {
+      used[j0] = 1;
+      const int i0 = p[j0];
+      double delta = inf;
+      int j1 = 0;
+      for (int j = 1; j <= m; j++)
+      {
+        if (used[j]) continue;
+        const double cur = cost[i0 * (m + 1) + j] - u[i0] - v[j];
+        if (cur < minv[j])
+        {
+          minv[j] = cur;
+          way[j] = j0;
+        }
+        if (minv[j] < delta)
+        {
+          delta = minv[j];
+          j1 = j;
+        }
+      }
+      for (int j = 0; j <= m; j++)
+      {
+        if (used[j])
+        {
+          u[p[j]] += delta;
+          v[j] -= delta;
+        }
+        else
+        {
+          minv[j] -= delta;
+        }
+      }
+      j0 = j1;
+    } while (p[j0] != 0);
+    do
+    {
+      const int j1 = way[j0];
+      p[j0] = p[j1];
+      j0 = j1;
+    } while (j0);
+  }
+
+  for (int j = 1; j <= m; j++)
+  {
+    if (p[j] == 0) continue;
+    const int e = edge_of[p[j] * (m + 1) + j];
+    // rows forced onto a non-candidate column stay unassigned
+    if (e < 0) continue;
+    m_assigned[m_track[e]] = e;
+    m_cluster_taken[m_cluster[e]] = 1;
+  }
+}
@@ -0,0 +1,83 @@
+// Tell emacs that this is a C++ source
+//  -*- C++ -*-.
+/*!
+ *  \file   TrackCaloAssignment.h
+ *  \brief  One-to-one assignment of tracks to calorimeter clusters from the candidate pairs of the matching window
+ */
+
+#ifndef TRACKCALOASSIGNMENT_H
+#define TRACKCALOASSIGNMENT_H
+
+#include <cstddef>
+#include <vector>
+
+/*!
+ * The candidate (track, cluster) pairs that pass the matching window form a
+ * sparse bipartite graph with the match residual as edge weight. solve()
+ * gives every track at most one cluster and every cluster at most one track.
+ *
+ * kGreedy sorts the edges by residual once and accepts an edge when both
+ * ends are still free, O(E log E). kHungarian splits the graph into its
+ * connected components and solves the components with at most
+ * max_component tracks and clusters exactly (most matched pairs, then the
+ * smallest summed residual); larger components fall back to greedy.
+ *
+ * Tracks and clusters are dense ids chosen by the caller; results refer to
+ * the edges by the order in which they were added.
+ */
+class TrackCaloAssignment
+{
+ public:
+  enum Method
+  {
+    kGreedy = 0,
+    kHungarian = 1
+  };
+
+  TrackCaloAssignment() = default;
+
+  /// drop all candidates, keeping the allocated capacity
+  void clear();
+
+  /// add a candidate pair; returns its edge number
+  unsigned int add(unsigned int track, unsigned int cluster, float residual);
+
+  void solve(Method method, unsigned int max_component = 16);
+
+  std::size_t edges() const { return m_residual.size(); }
+  std::size_t tracks() const { return m_assigned.size(); }
+
+  /// edge assigned to track, -1 if the track got no cluster
+  int assigned(unsigned int track) const { return track < m_assigned.size() ? m_assigned[track] : -1; }
+  unsigned int cluster(unsigned int edge) const { return m_cluster[edge]; }
+  float residual(unsigned int edge) const { return m_residual[edge]; }
+  /// smallest residual of the other candidates of track, NaN if it had only one
+  float runnerUp(unsigned int track) const { return m_runner_up[track]; }
+
+  /// number of components solved exactly / with the greedy fallback by the last solve()
+  unsigned int exactComponents() const { return m_exact_components; }
+  unsigned int greedyComponents() const { return m_greedy_components; }
+
+ private:
+  unsigned int find(unsigned int node);
+  void hungarian(const std::vector<unsigned int> &component_edges);
+
+  std::vector<unsigned int> m_track;
+  std::vector<unsigned int> m_cluster;
+  std::vector<float> m_residual;
+  unsigned int m_ntracks = 0;
+  unsigned int m_nclusters = 0;
+
+  std::vector<int> m_assigned;
+  std::vector<int> m_cluster_taken;
+  std::vector<float> m_runner_up;
+
+  // scratch
+  std::vector<unsigned int> m_parent;
+  std::vector<unsigned int> m_order;
+  std::vector<char> m_exact;
+  unsigned int m_exact_components = 0;
+  unsigned int m_greedy_components = 0;
+};
+
+#endif // TRACKCALOASSIGNMENT_H
@@ -0,0 +1,56 @@
+/*!
+ *  \file   TrackCaloMatchIndex.cc
+ *  \brief  Track - EMCal cluster matches of an event, stored as keys into the original containers
+ */
+#include "TrackCaloMatchIndex.h"
+
+#include <trackbase_historic/SvtxTrackMap.h>
+
+//____________________________________________________________________________..
+void TrackCaloMatchIndex::identify(std::ostream &os) const
+{
+  os << "TrackCaloMatchIndex: " << size() << " track-cluster matches" << std::endl;
+  for (std::size_t i = 0; i < size(); i++)
+  {
+    os << "  track " << m_track_key[i] << " cluster " << m_cluster_key[i] << " dphi " << m_dphi[i]
+       << " dz " << m_dz[i] << " E/p " << m_eop[i] << std::endl;
+  }
+}
+
+//____________________________________________________________________________..
+void TrackCaloMatchIndex::Reset()
+{
+  m_track_key.clear();
+  m_cluster_key.clear();
+  m_dphi.clear();
+  m_dz.clear();
+  m_eop.clear();
+}
+
+//____________________________________________________________________________..
+void TrackCaloMatchIndex::add(unsigned int track_key, unsigned int cluster_key, float dphi, float dz, float eop)
+{
+  m_track_key.push_back(track_key);
+  m_cluster_key.push_back(cluster_key);
+  m_dphi.push_back(dphi);
+  m_dz.push_back(dz);
+  m_eop.push_back(eop);
+}
+
+//____________________________________________________________________________..
+SvtxTrack *TrackCaloMatchIndex::track(std::size_t i, SvtxTrackMap *map) const
+{
+  return map ? map->get(m_track_key[i]) : nullptr;
+}
+
+//____________________________________________________________________________..
+std::vector<unsigned int> TrackCaloMatchIndex::trackKeys() const
+{
+  std::vector<unsigned int> keys;
+  for (unsigned int key : m_track_key)
+  {
+    // records of one track are adjacent
+    if (keys.empty() || keys.back() != key) keys.push_back(key);
+  }
+  return keys;
+}
@@ -0,0 +1,64 @@
+// Tell emacs that this is a C++ source
+//  -*- C++ -*-.
+/*!
+ *  \file   TrackCaloMatchIndex.h
+ *  \brief  Track - EMCal cluster matches of an event, stored as keys into the original containers
+ */
+
+#ifndef TRACKCALOMATCHINDEX_H
+#define TRACKCALOMATCHINDEX_H
+
+#include <phool/PHObject.h>
+
+#include <cstddef>
+#include <iostream>
+#include <vector>
+
+class SvtxTrack;
+class SvtxTrackMap;
+
+/*!
+ * One record per matched (track, EMCal cluster) pair in flat arrays:
+ * SvtxTrackMap key, RawCluster id, dphi and dz at the matching radius and
+ * E/p. The tracks stay in the original SvtxTrackMap; track() resolves a
+ * record against it, so consumers read the matched tracks without any
+ * copy. A track matched to several clusters has several records, next to
+ * each other.
+ */
+class TrackCaloMatchIndex : public PHObject
+{
+ public:
+  TrackCaloMatchIndex() = default;
+  ~TrackCaloMatchIndex() override = default;
+
+  void identify(std::ostream &os = std::cout) const override;
+  void Reset() override;
+  int isValid() const override { return 1; }
+  PHObject *CloneMe() const override { return new TrackCaloMatchIndex(*this); }
+
+  void add(unsigned int track_key, unsigned int cluster_key, float dphi, float dz, float eop);
+
+  std::size_t size() const { return m_track_key.size(); }
+  unsigned int track_key(std::size_t i) const { return m_track_key[i]; }
+  unsigned int cluster_key(std::size_t i) const { return m_cluster_key[i]; }
+  float dphi(std::size_t i) const { return m_dphi[i]; }
+  float dz(std::size_t i) const { return m_dz[i]; }
+  float eop(std::size_t i) const { return m_eop[i]; }
+
+  /// the track of record i in map, or nullptr if map does not hold it
+  SvtxTrack *track(std::size_t i, SvtxTrackMap *map) const;
+
+  /// keys of the matched tracks, each once, in record order
+  std::vector<unsigned int> trackKeys() const;
+
+ private:
+  std::vector<unsigned int> m_track_key;
+  std::vector<unsigned int> m_cluster_key;
+  std::vector<float> m_dphi;
+  std::vector<float> m_dz;
+  std::vector<float> m_eop;
+
+  ClassDefOverride(TrackCaloMatchIndex, 1);
+};
+
+#endif // TRACKCALOMATCHINDEX_H
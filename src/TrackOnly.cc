@@ -5,6 +5,8 @@
  */
 #include "TrackOnly.h"
 
+#include "TrackSummary.h"
+
 #include <calobase/RawClusterContainer.h>
 #include <calobase/RawTowerGeomContainer.h>
 #include <calobase/RawCluster.h>
@@ -197,6 +199,13 @@ int TrackOnly::process_event(PHCompositeNode *topNode)
   }
 */
 
+  // seed walk, vertices and DCA shared with the other modules, if TrackSummaryMaker ran for this event
+  m_track_summary = findNode::getClass<TrackSummary>(topNode, m_track_summary_name);
+  if (m_track_summary && !m_track_summary->current(trackMap))
+  {
+    m_track_summary = nullptr;
+  }
+
   ResetTreeVectors();
 
   fillTree();
@@ -215,14 +224,22 @@ void TrackOnly::fillTree()
 
   CLHEP::Hep3Vector vertex(0., 0., 0.);
 
+  std::size_t index = 0;
   for (auto &iter : *trackMap)
   {
     track = iter.second;
+    const std::size_t itrack = index++;
 
     if(!track) continue;
 
     if(track->get_pt() < m_track_pt_low_cut) continue;
 
+    if (m_track_summary)
+    {
+      fillTrack(track, *m_track_summary, itrack);
+      continue;
+    }
+
     seed = track->get_silicon_seed();
 
     int n_mvtx_clusters = 0;
@@ -358,6 +375,44 @@ void TrackOnly::fillTree()
   _tree->Fill();
 }
 
+//____________________________________________________________________________..
+void TrackOnly::fillTrack(SvtxTrack *thisTrack, const TrackSummary &summary, std::size_t index)
+{
+  // same columns as the seed loop of fillTree
+  for (unsigned int k = summary.cluster_begin[index]; k < summary.cluster_begin[index + 1]; k++)
+  {
+    Acts::Vector3 global = acts_Geometry->getGlobalPosition(summary.cluster_key[k], summary.cluster[k]);
+    _trClus_track_id.push_back(thisTrack->get_id());
+    _trClus_type.push_back(TrkrDefs::getTrkrId(summary.cluster_key[k]));
+    _trClus_x.push_back(global[0]);
+    _trClus_y.push_back(global[1]);
+    _trClus_z.push_back(global[2]);
+  }
+  _track_nc_mvtx.push_back(summary.nclusters[TrackSummary::kMvtx][index]);
+  _track_nc_intt.push_back(summary.nclusters[TrackSummary::kIntt][index]);
+
+  _track_vx.push_back(summary.vertex_x[index]);
+  _track_vy.push_back(summary.vertex_y[index]);
+  _track_vz.push_back(summary.vertex_z[index]);
+
+  _track_id.push_back(thisTrack->get_id());
+  _track_quality.push_back(thisTrack->get_quality());
+  _track_dcaxy.push_back(summary.dcaxy[index]);
+  _track_dcaz.push_back(summary.dcaz[index]);
+  _track_nc_tpc.push_back(summary.nclusters[TrackSummary::kTpc][index]);
+  _track_bc.push_back(-1);
+  _track_ptq.push_back(thisTrack->get_charge()*thisTrack->get_pt());
+  _track_px.push_back(thisTrack->get_px());
+  _track_py.push_back(thisTrack->get_py());
+  _track_pz.push_back(thisTrack->get_pz());
+  _track_phi.push_back(thisTrack->get_phi());
+  _track_eta.push_back(thisTrack->get_eta());
+  _track_pcax.push_back(thisTrack->get_x());
+  _track_pcay.push_back(thisTrack->get_y());
+  _track_pcaz.push_back(thisTrack->get_z());
+  _track_crossing.push_back(thisTrack->get_crossing());
+}
+
 //____________________________________________________________________________..
 int TrackOnly::End(PHCompositeNode *topNode)
 {
@@ -28,6 +28,7 @@ class TH2;
 class TFile;
 class TTree;
 class ActsGeometry;
+class TrackSummary;
 
 class TrackOnly : public SubsysReco
 {
@@ -59,6 +60,8 @@ class TrackOnly : public SubsysReco
   void createBranches();
 
   void setTrackPtLowCut(float pt) {m_track_pt_low_cut = pt;}
+  /// node written by TrackSummaryMaker; when it is current the seeds, vertices and DCA are taken from it
+  void setTrackSummaryName(const std::string &name) {m_track_summary_name = name;}
 
  private:
    int cnt = 0;
@@ -105,6 +108,11 @@ class TrackOnly : public SubsysReco
    std::vector<float> _trClus_y;
    std::vector<float> _trClus_z;
 
+   /// fill the columns of thisTrack from the summary row index, instead of walking its seeds
+   void fillTrack(SvtxTrack *thisTrack, const TrackSummary &summary, std::size_t index);
+   std::string m_track_summary_name = "TrackSummary";
+   TrackSummary *m_track_summary = nullptr;
+
    SvtxVertexMap *vertexMap = nullptr;
    SvtxTrackMap *trackMap = nullptr;
    ActsGeometry *acts_Geometry = nullptr;
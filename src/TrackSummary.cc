@@ -0,0 +1,42 @@
+/*!
+ *  \file   TrackSummary.cc
+ *  \brief  Per-event table of the tracks of an SvtxTrackMap in flat arrays, shared by the analysis modules
+ */
+#include "TrackSummary.h"
+
+#include <trackbase_historic/SvtxTrackMap.h>
+
+//____________________________________________________________________________..
+void TrackSummary::clear()
+{
+  source = nullptr;
+  track.clear();
+  id.clear();
+  charge.clear();
+  pt.clear();
+  quality.clear();
+  vertex_id.clear();
+  vertex_x.clear();
+  vertex_y.clear();
+  vertex_z.clear();
+  dcaxy.clear();
+  dcaz.clear();
+  for (int detector = 0; detector < kNDetectors; detector++)
+  {
+    nkeys[detector].clear();
+    nclusters[detector].clear();
+  }
+  for (int projection = 0; projection < kNProjections; projection++)
+  {
+    state[projection].clear();
+  }
+  cluster_begin.assign(1, 0);
+  cluster_key.clear();
+  cluster.clear();
+}
+
+//____________________________________________________________________________..
+bool TrackSummary::current(const SvtxTrackMap *map) const
+{
+  return map && map == source && map->size() == size();
+}
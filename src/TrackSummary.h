@@ -0,0 +1,89 @@
+// Tell emacs that this is a C++ source
+//  -*- C++ -*-.
+/*!
+ *  \file   TrackSummary.h
+ *  \brief  Per-event table of the tracks of an SvtxTrackMap in flat arrays, shared by the analysis modules
+ */
+
+#ifndef TRACKSUMMARY_H
+#define TRACKSUMMARY_H
+
+#include <trackbase/TrkrDefs.h>
+
+#include <cstddef>
+#include <vector>
+
+class SvtxTrack;
+class SvtxTrackMap;
+class SvtxTrackState;
+class TrkrCluster;
+
+/*!
+ * Entry i describes the i-th track of the source map in iteration order,
+ * so a module walking the same map can use its loop counter as index.
+ * Filled by TrackSummaryMaker and kept on the node tree as a transient
+ * PHDataNode. The maker empties the table in ResetEvent(), so a module
+ * running before the maker finds no current() table instead of the
+ * pointers of the previous event.
+ *
+ * Cluster counts come in two flavours because the modules always had two
+ * definitions: nkeys counts the cluster keys of both seeds, nclusters only
+ * those found in TRKR_CLUSTER. The found clusters themselves, silicon seed
+ * first, are cluster[cluster_begin[i] .. cluster_begin[i + 1]).
+ */
+class TrackSummary
+{
+ public:
+  enum Detector
+  {
+    kMvtx,
+    kIntt,
+    kTpc,
+    kTpot,
+    kNDetectors
+  };
+
+  enum Projection
+  {
+    kOrigin,
+    kEMCal,
+    kIHCal,
+    kOHCal,
+    kNProjections
+  };
+
+  TrackSummary() = default;
+
+  /// drop all tracks, keeping the allocated capacity
+  void clear();
+
+  std::size_t size() const { return track.size(); }
+
+  /// true if the table was built from map in this event
+  bool current(const SvtxTrackMap *map) const;
+
+  const SvtxTrackMap *source = nullptr;
+  /// radius of the states in state[], kOrigin is 0
+  double radius[kNProjections] = {0, 0, 0, 0};
+
+  std::vector<SvtxTrack *> track;
+  std::vector<unsigned int> id;
+  std::vector<int> charge;
+  std::vector<float> pt;
+  std::vector<float> quality;
+  std::vector<unsigned int> vertex_id;
+  std::vector<float> vertex_x;  // NaN if the vertex is not in the SvtxVertexMap
+  std::vector<float> vertex_y;
+  std::vector<float> vertex_z;
+  std::vector<float> dcaxy;  // with respect to the origin
+  std::vector<float> dcaz;
+  std::vector<unsigned short> nkeys[kNDetectors];
+  std::vector<unsigned short> nclusters[kNDetectors];
+  std::vector<SvtxTrackState *> state[kNProjections];
+
+  std::vector<unsigned int> cluster_begin;
+  std::vector<TrkrDefs::cluskey> cluster_key;
+  std::vector<TrkrCluster *> cluster;
+};
+
+#endif // TRACKSUMMARY_H
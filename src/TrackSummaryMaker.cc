@@ -0,0 +1,211 @@
+/*!
+ *  \file   TrackSummaryMaker.cc
+ *  \brief  Builds the per-event TrackSummary node read by TrackOnly, TrackToCalo and TrkrCaloMandS
+ */
+#include "TrackSummaryMaker.h"
+
+#include "TrackSummary.h"
+
+#include <calobase/RawTowerGeomContainer.h>
+
+#include <fun4all/Fun4AllReturnCodes.h>
+
+#include <globalvertex/SvtxVertex.h>
+#include <globalvertex/SvtxVertexMap.h>
+
+#include <phool/PHCompositeNode.h>
+#include <phool/PHDataNode.h>
+#include <phool/PHNodeIterator.h>
+#include <phool/getClass.h>
+
+#include <trackbase/TrkrCluster.h>
+#include <trackbase/TrkrClusterContainer.h>
+#include <trackbase/TrkrDefs.h>
+#include <trackbase_historic/SvtxTrack.h>
+#include <trackbase_historic/SvtxTrackMap.h>
+#include <trackbase_historic/SvtxTrackState.h>
+#include <trackbase_historic/TrackAnalysisUtils.h>
+#include <trackbase_historic/TrackSeed.h>
+
+#include <cmath>
+#include <iostream>
+
+//____________________________________________________________________________..
+TrackSummaryMaker::TrackSummaryMaker(const std::string &name)
+  : SubsysReco(name)
+{
+}
+
+//____________________________________________________________________________..
+int TrackSummaryMaker::InitRun(PHCompositeNode *topNode)
+{
+  m_summary = findNode::getClass<TrackSummary>(topNode, m_summary_name);
+  if (!m_summary)
+  {
+    PHNodeIterator iter(topNode);
+    PHCompositeNode *dstNode = dynamic_cast<PHCompositeNode *>(iter.findFirst("PHCompositeNode", "DST"));
+    if (!dstNode)
+    {
+      std::cout << "TrackSummaryMaker::InitRun - DST node is missing, quitting" << std::endl;
+      return Fun4AllReturnCodes::ABORTRUN;
+    }
+    m_summary = new TrackSummary;
+    dstNode->addNode(new PHDataNode<TrackSummary>(m_summary, m_summary_name));
+  }
+  m_summary->clear();
+
+  m_trackmap = nullptr;
+  m_vertexmap = nullptr;
+  m_clusters = nullptr;
+  m_emcal_geometry = findNode::getClass<RawTowerGeomContainer>(topNode, "TOWERGEOM_CEMC");
+  m_ihcal_geometry = findNode::getClass<RawTowerGeomContainer>(topNode, "TOWERGEOM_HCALIN");
+  m_ohcal_geometry = findNode::getClass<RawTowerGeomContainer>(topNode, "TOWERGEOM_HCALOUT");
+  return Fun4AllReturnCodes::EVENT_OK;
+}
+
+//____________________________________________________________________________..
+double TrackSummaryMaker::radius(RawTowerGeomContainer *geometry, float user) const
+{
+  if (user > 0) return user;
+  return geometry ? geometry->get_radius() : NAN;
+}
+
+//____________________________________________________________________________..
+int TrackSummaryMaker::process_event(PHCompositeNode *topNode)
+{
+  m_summary->clear();
+
+  if (!m_trackmap)
+  {
+    m_trackmap = findNode::getClass<SvtxTrackMap>(topNode, m_trackmap_name);
+    if (!m_trackmap)
+    {
+      std::cout << "TrackSummaryMaker::process_event: " << m_trackmap_name << " not found!!!" << std::endl;
+      return Fun4AllReturnCodes::EVENT_OK;
+    }
+  }
+  if (!m_vertexmap)
+  {
+    m_vertexmap = findNode::getClass<SvtxVertexMap>(topNode, "SvtxVertexMap");
+  }
+  if (!m_clusters)
+  {
+    m_clusters = findNode::getClass<TrkrClusterContainer>(topNode, "TRKR_CLUSTER");
+    if (!m_clusters)
+    {
+      std::cout << "TrackSummaryMaker::process_event: TRKR_CLUSTER not found!!!" << std::endl;
+      return Fun4AllReturnCodes::EVENT_OK;
+    }
+  }
+
+  TrackSummary &summary = *m_summary;
+  summary.radius[TrackSummary::kOrigin] = 0;
+  summary.radius[TrackSummary::kEMCal] = radius(m_emcal_geometry, m_emcal_radius_user);
+  summary.radius[TrackSummary::kIHCal] = radius(m_ihcal_geometry, m_ihcal_radius_user);
+  summary.radius[TrackSummary::kOHCal] = radius(m_ohcal_geometry, m_ohcal_radius_user);
+
+  Acts::Vector3 zero = Acts::Vector3::Zero();
+  for (const auto &iter : *m_trackmap)
+  {
+    SvtxTrack *track = iter.second;
+    summary.track.push_back(track);
+    if (!track)
+    {
+      // keeps the entries aligned with the map; a null track is skipped by every module
+      summary.id.push_back(iter.first);
+      summary.charge.push_back(0);
+      summary.pt.push_back(NAN);
+      summary.quality.push_back(NAN);
+      summary.vertex_id.push_back(0);
+      summary.vertex_x.push_back(NAN);
+      summary.vertex_y.push_back(NAN);
+      summary.vertex_z.push_back(NAN);
+      summary.dcaxy.push_back(NAN);
+      summary.dcaz.push_back(NAN);
+      for (int detector = 0; detector < TrackSummary::kNDetectors; detector++)
+      {
+        summary.nkeys[detector].push_back(0);
+        summary.nclusters[detector].push_back(0);
+      }
+      for (int projection = 0; projection < TrackSummary::kNProjections; projection++)
+      {
+        summary.state[projection].push_back(nullptr);
+      }
+      summary.cluster_begin.push_back(summary.cluster.size());
+      continue;
+    }
+
+    summary.id.push_back(track->get_id());
+    summary.charge.push_back(track->get_charge());
+    summary.pt.push_back(track->get_pt());
+    summary.quality.push_back(track->get_quality());
+
+    unsigned short nkeys[TrackSummary::kNDetectors] = {0, 0, 0, 0};
+    unsigned short nclusters[TrackSummary::kNDetectors] = {0, 0, 0, 0};
+    for (TrackSeed *seed : {track->get_silicon_seed(), track->get_tpc_seed()})
+    {
+      if (!seed) continue;
+      for (auto key_iter = seed->begin_cluster_keys(); key_iter != seed->end_cluster_keys(); ++key_iter)
+      {
+        const auto &cluster_key = *key_iter;
+        int detector = TrackSummary::kNDetectors;
+        switch (TrkrDefs::getTrkrId(cluster_key))
+        {
+        case TrkrDefs::TrkrId::mvtxId: detector = TrackSummary::kMvtx; break;
+        case TrkrDefs::TrkrId::inttId: detector = TrackSummary::kIntt; break;
+        case TrkrDefs::TrkrId::tpcId: detector = TrackSummary::kTpc; break;
+        case TrkrDefs::TrkrId::micromegasId: detector = TrackSummary::kTpot; break;
+        default: break;
+        }
+        if (detector < TrackSummary::kNDetectors) nkeys[detector]++;
+
+        TrkrCluster *cluster = m_clusters->findCluster(cluster_key);
+        if (!cluster) continue;
+        if (detector < TrackSummary::kNDetectors) nclusters[detector]++;
+        summary.cluster_key.push_back(cluster_key);
+        summary.cluster.push_back(cluster);
+      }
+    }
+    for (int detector = 0; detector < TrackSummary::kNDetectors; detector++)
+    {
+      summary.nkeys[detector].push_back(nkeys[detector]);
+      summary.nclusters[detector].push_back(nclusters[detector]);
+    }
+    summary.cluster_begin.push_back(summary.cluster.size());
+
+    float vx = NAN, vy = NAN, vz = NAN;
+    summary.vertex_id.push_back(track->get_vertex_id());
+    if (m_vertexmap)
+    {
+      auto vertexit = m_vertexmap->find(track->get_vertex_id());
+      if (vertexit != m_vertexmap->end())
+      {
+        vx = vertexit->second->get_x();
+        vy = vertexit->second->get_y();
+        vz = vertexit->second->get_z();
+      }
+    }
+    summary.vertex_x.push_back(vx);
+    summary.vertex_y.push_back(vy);
+    summary.vertex_z.push_back(vz);
+
+    auto dcapair = TrackAnalysisUtils::get_dca(track, zero);
+    summary.dcaxy.push_back(dcapair.first.first);
+    summary.dcaz.push_back(dcapair.second.first);
+
+    for (int projection = 0; projection < TrackSummary::kNProjections; projection++)
+    {
+      summary.state[projection].push_back(std::isnan(summary.radius[projection]) ? nullptr : track->get_state(summary.radius[projection]));
+    }
+  }
+  summary.source = m_trackmap;
+
+  return Fun4AllReturnCodes::EVENT_OK;
+}
+
+//____________________________________________________________________________..
+int TrackSummaryMaker::ResetEvent(PHCompositeNode * /*topNode*/)
+{
+  if (m_summary) m_summary->clear();
+  return Fun4AllReturnCodes::EVENT_OK;
+}
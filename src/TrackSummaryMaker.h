@@ -0,0 +1,66 @@
+// Tell emacs that this is a C++ source
+//  -*- C++ -*-.
+/*!
+ *  \file   TrackSummaryMaker.h
+ *  \brief  Builds the per-event TrackSummary node read by TrackOnly, TrackToCalo and TrkrCaloMandS
+ */
+
+#ifndef TRACKSUMMARYMAKER_H
+#define TRACKSUMMARYMAKER_H
+
+#include <fun4all/SubsysReco.h>
+
+#include <string>
+
+class PHCompositeNode;
+class RawTowerGeomContainer;
+class SvtxTrackMap;
+class SvtxVertexMap;
+class TrackSummary;
+class TrkrClusterContainer;
+
+/*!
+ * Walks the seeds of every track once per event and stores cluster
+ * counts, cuts inputs, vertex, DCA and the projected states in a
+ * TrackSummary node (default name "TrackSummary" under DST). Register it
+ * before the analysis modules; they fall back to their own loops when the
+ * node is missing. The state radii follow the calorimeter geometry unless
+ * set by hand, like in TrackToCalo; a module using other radii looks the
+ * states up itself.
+ */
+class TrackSummaryMaker : public SubsysReco
+{
+ public:
+  TrackSummaryMaker(const std::string &name = "TrackSummaryMaker");
+  ~TrackSummaryMaker() override = default;
+
+  int InitRun(PHCompositeNode *topNode) override;
+  int process_event(PHCompositeNode *topNode) override;
+  int ResetEvent(PHCompositeNode *topNode) override;
+
+  void setTrackMapName(const std::string &name) {m_trackmap_name = name;}
+  void setSummaryName(const std::string &name) {m_summary_name = name;}
+  void setEMcalRadius(float r) {m_emcal_radius_user = r;}
+  void setIHcalRadius(float r) {m_ihcal_radius_user = r;}
+  void setOHcalRadius(float r) {m_ohcal_radius_user = r;}
+
+ private:
+  double radius(RawTowerGeomContainer *geometry, float user) const;
+
+  std::string m_trackmap_name = "SvtxTrackMap";
+  std::string m_summary_name = "TrackSummary";
+  // radii of the projected states; 0 takes the radius of the calorimeter geometry
+  float m_emcal_radius_user = 0;
+  float m_ihcal_radius_user = 0;
+  float m_ohcal_radius_user = 0;
+
+  TrackSummary *m_summary = nullptr;
+  SvtxTrackMap *m_trackmap = nullptr;
+  SvtxVertexMap *m_vertexmap = nullptr;
+  TrkrClusterContainer *m_clusters = nullptr;
+  RawTowerGeomContainer *m_emcal_geometry = nullptr;
+  RawTowerGeomContainer *m_ihcal_geometry = nullptr;
+  RawTowerGeomContainer *m_ohcal_geometry = nullptr;
+};
+
+#endif // TRACKSUMMARYMAKER_H
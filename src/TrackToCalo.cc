@@ -5,6 +5,8 @@
  */
 #include "TrackToCalo.h"
 
+#include "TrackSummary.h"
+
 #include <calobase/RawClusterContainer.h>
 #include <calobase/RawTowerGeomContainer.h>
 #include <calobase/RawCluster.h>
@@ -54,6 +56,8 @@
 
 #include <CLHEP/Vector/ThreeVector.h>
 #include <math.h>
+#include <algorithm>
+#include <cmath>
 #include <vector>
 
 #include <TFile.h>
@@ -91,6 +95,7 @@ int TrackToCalo::Init(PHCompositeNode *topNode)
 
     delete _outfile;
     _outfile = new TFile(_outfilename.c_str(), "RECREATE");
+    m_file_options.applyToFile(_outfile);
 
     if (m_doTrkrCaloMatching)
     {
@@ -102,6 +107,19 @@ int TrackToCalo::Init(PHCompositeNode *topNode)
         createBranches_KFP();
     }
 
+    for (int collection = 0; collection < kNColumnCollections; collection++)
+    {
+        m_columns.reserve(collection, m_column_reserve[collection]);
+    }
+    m_cluster_positions.reserve(m_column_reserve[kTpcClusterColumns]);
+
+    m_track_pool.reset();
+    if (m_track_threads > 1)
+    {
+        m_track_pool.reset(new WorkerPool(m_track_threads));
+        std::cout << "TrackToCalo::Init - track loop runs on " << m_track_pool->size() << " threads" << std::endl;
+    }
+
     return Fun4AllReturnCodes::EVENT_OK;
 }
 
@@ -109,301 +127,76 @@ int TrackToCalo::Init(PHCompositeNode *topNode)
 void TrackToCalo::createBranches()
 {
     delete _tree;
-    _tree = new TTree("tree", "A tree with track/calo info");
-    _tree->Branch("_runNumber", &_runNumber);
-    _tree->Branch("_eventNumber", &_eventNumber);
-    _tree->Branch("_vertex_id", &_vertex_id);
-    _tree->Branch("_vertex_crossing", &_vertex_crossing);
-    _tree->Branch("_vertex_ntracks", &_vertex_ntracks);
-    _tree->Branch("_vertex_x", &_vertex_x);
-    _tree->Branch("_vertex_y", &_vertex_y);
-    _tree->Branch("_vertex_z", &_vertex_z);
-    _tree->Branch("_cluster_x", &_cluster_x);
-    _tree->Branch("_cluster_y", &_cluster_y);
-    _tree->Branch("_cluster_z", &_cluster_z);
-    _tree->Branch("_track_id", &_track_id);
-    _tree->Branch("_track_bc", &_track_bc);
-    _tree->Branch("_track_phi", &_track_phi);
-    _tree->Branch("_track_eta", &_track_eta);
-    _tree->Branch("_track_pcax", &_track_pcax);
-    _tree->Branch("_track_pcay", &_track_pcay);
-    _tree->Branch("_track_pcaz", &_track_pcaz);
-    _tree->Branch("_track_crossing", &_track_crossing);
-    _tree->Branch("_track_vx", &_track_vx);
-    _tree->Branch("_track_vy", &_track_vy);
-    _tree->Branch("_track_vz", &_track_vz);
-    _tree->Branch("_track_quality", &_track_quality);
-    _tree->Branch("_track_dcaxy", &_track_dcaxy);
-    _tree->Branch("_track_dcaz", &_track_dcaz);
-    _tree->Branch("_track_nc_mvtx", &_track_nc_mvtx);
-    _tree->Branch("_track_nc_intt", &_track_nc_intt);
-    _tree->Branch("_track_nc_tpc", &_track_nc_tpc);
-    _tree->Branch("_track_ptq", &_track_ptq);
-    _tree->Branch("_track_px", &_track_px);
-    _tree->Branch("_track_py", &_track_py);
-    _tree->Branch("_track_pz", &_track_pz);
-    _tree->Branch("_track_phi_origin", &_track_phi_origin);
-    _tree->Branch("_track_eta_origin", &_track_eta_origin);
-    _tree->Branch("_track_px_origin", &_track_px_origin);
-    _tree->Branch("_track_py_origin", &_track_py_origin);
-    _tree->Branch("_track_pz_origin", &_track_pz_origin);
-    _tree->Branch("_track_x_origin", &_track_x_origin);
-    _tree->Branch("_track_y_origin", &_track_y_origin);
-    _tree->Branch("_track_z_origin", &_track_z_origin);
-    _tree->Branch("_track_phi_emc", &_track_phi_emc);
-    _tree->Branch("_track_eta_emc", &_track_eta_emc);
-    _tree->Branch("_track_px_emc", &_track_px_emc);
-    _tree->Branch("_track_py_emc", &_track_py_emc);
-    _tree->Branch("_track_pz_emc", &_track_pz_emc);
-    _tree->Branch("_track_x_emc", &_track_x_emc);
-    _tree->Branch("_track_y_emc", &_track_y_emc);
-    _tree->Branch("_track_z_emc", &_track_z_emc);
-    _tree->Branch("_track_phi_ihc", &_track_phi_ihc);
-    _tree->Branch("_track_eta_ihc", &_track_eta_ihc);
-    _tree->Branch("_track_px_ihc", &_track_px_ihc);
-    _tree->Branch("_track_py_ihc", &_track_py_ihc);
-    _tree->Branch("_track_pz_ihc", &_track_pz_ihc);
-    _tree->Branch("_track_x_ihc", &_track_x_ihc);
-    _tree->Branch("_track_y_ihc", &_track_y_ihc);
-    _tree->Branch("_track_z_ihc", &_track_z_ihc);
-    _tree->Branch("_track_phi_ohc", &_track_phi_ohc);
-    _tree->Branch("_track_eta_ohc", &_track_eta_ohc);
-    _tree->Branch("_track_px_ohc", &_track_px_ohc);
-    _tree->Branch("_track_py_ohc", &_track_py_ohc);
-    _tree->Branch("_track_pz_ohc", &_track_pz_ohc);
-    _tree->Branch("_track_x_ohc", &_track_x_ohc);
-    _tree->Branch("_track_y_ohc", &_track_y_ohc);
-    _tree->Branch("_track_z_ohc", &_track_z_ohc);
-    _tree->Branch("_trClus_track_id", &_trClus_track_id);
-    _tree->Branch("_trClus_type", &_trClus_type);
-    _tree->Branch("_trClus_x", &_trClus_x);
-    _tree->Branch("_trClus_y", &_trClus_y);
-    _tree->Branch("_trClus_z", &_trClus_z);
-    _tree->Branch("_emcal_id", &_emcal_id);
-    _tree->Branch("_emcal_phi", &_emcal_phi);
-    _tree->Branch("_emcal_eta", &_emcal_eta);
-    _tree->Branch("_emcal_x", &_emcal_x);
-    _tree->Branch("_emcal_y", &_emcal_y);
-    _tree->Branch("_emcal_z", &_emcal_z);
-    _tree->Branch("_emcal_e", &_emcal_e);
-    _tree->Branch("_emcal_ecore", &_emcal_ecore);
-    _tree->Branch("_emcal_chi2", &_emcal_chi2);
-    _tree->Branch("_emcal_prob", &_emcal_prob);
-    _tree->Branch("_emcal_tower_cluster_id", &_emcal_tower_cluster_id);
-    _tree->Branch("_emcal_tower_e", &_emcal_tower_e);
-    _tree->Branch("_emcal_tower_phi", &_emcal_tower_phi);
-    _tree->Branch("_emcal_tower_eta", &_emcal_tower_eta);
-    _tree->Branch("_emcal_tower_status", &_emcal_tower_status);
-    _tree->Branch("_hcal_id", &_hcal_id);
-    _tree->Branch("_hcal_phi", &_hcal_phi);
-    _tree->Branch("_hcal_eta", &_hcal_eta);
-    _tree->Branch("_hcal_x", &_hcal_x);
-    _tree->Branch("_hcal_y", &_hcal_y);
-    _tree->Branch("_hcal_z", &_hcal_z);
-    _tree->Branch("_hcal_e", &_hcal_e);
-    _tree->Branch("_hcal_tower_cluster_id", &_hcal_tower_cluster_id);
-    _tree->Branch("_hcal_tower_e", &_hcal_tower_e);
-    _tree->Branch("_hcal_tower_phi", &_hcal_tower_phi);
-    _tree->Branch("_hcal_tower_eta", &_hcal_tower_eta);
-    _tree->Branch("_hcal_tower_status", &_hcal_tower_status);
-    _tree->Branch("_hcal_tower_io", &_hcal_tower_io);
-    _tree->Branch("_mbd_x", &_mbd_x);
-    _tree->Branch("_mbd_y", &_mbd_y);
-    _tree->Branch("_mbd_z", &_mbd_z);
-    _tree->Branch("_triggers", &_triggers);
-    _tree->Branch("_ntracks", &_ntracks);
+    _tree = nullptr;
+    for (TTree *tree : m_level_trees) delete tree;
+    m_level_trees.clear();
+    m_level_indices.clear();
+    m_level_events.clear();
+    m_main_outputs.clear();
+
+    if (!m_normalized_output)
+    {
+        m_main_outputs.push_back(openOutput("tree", "A tree with track/calo info", kMainTree, ~0U, _tree));
+        return;
+    }
+
+    // one tree per granularity, one entry per event in every tree; the event keys are in all of them
+    const struct
+    {
+        const char *name;
+        const char *title;
+        unsigned int collections;
+        int objects;  // collection indexed per object in <name>_index, -1 for none
+    } levels[] = {
+        {"event", "Event level info", (1U << kEventColumns) | (1U << kVertexColumns), -1},
+        {"track", "Tracks, keyed by _track_id", 1U << kTrackColumns, kTrackColumns},
+        {"track_cluster", "Clusters of the tracks, keyed by _trClus_track_id", 1U << kTrackClusterColumns, kTrackClusterColumns},
+        {"cluster", "All TPC clusters", 1U << kTpcClusterColumns, kTpcClusterColumns},
+        {"emcal", "EMCal clusters, keyed by _emcal_id", 1U << kEMCalColumns, kEMCalColumns},
+        {"emcal_tower", "Towers of the EMCal clusters, keyed by _emcal_tower_cluster_id", 1U << kEMCalTowerColumns, kEMCalTowerColumns},
+        {"hcal", "HCal clusters, keyed by _hcal_id", 1U << kHCalColumns, kHCalColumns},
+        {"hcal_tower", "Towers of the HCal clusters, keyed by _hcal_tower_cluster_id", 1U << kHCalTowerColumns, kHCalTowerColumns}};
+    for (const auto &level : levels)
+    {
+        TTree *tree = nullptr;
+        m_main_outputs.push_back(openOutput(level.name, level.title, kMainTree, level.collections, tree));
+        if (!tree) continue;
+        m_level_trees.push_back(tree);
+        if (level.objects >= 0) m_level_indices.push_back({level.name, level.objects, {}});
+    }
 }
 
 void TrackToCalo::createBranches_KFP()
 {
     delete _tree_KFP;
-    _tree_KFP = new TTree("tree_KFP", "A tree with track/calo info after KFParticle");
-    _tree_KFP->Branch("_runNumber", &_runNumber);
-    _tree_KFP->Branch("_eventNumber", &_eventNumber);
-    _tree_KFP->Branch("_numCan", &_numCan);
-    _tree_KFP->Branch("_gamma_mass", &_gamma_mass);
-    _tree_KFP->Branch("_gamma_massErr", &_gamma_massErr);
-    _tree_KFP->Branch("_gamma_x", &_gamma_x);
-    _tree_KFP->Branch("_gamma_y", &_gamma_y);
-    _tree_KFP->Branch("_gamma_z", &_gamma_z);
-    _tree_KFP->Branch("_gamma_px", &_gamma_px);
-    _tree_KFP->Branch("_gamma_py", &_gamma_py);
-    _tree_KFP->Branch("_gamma_pz", &_gamma_pz);
-    _tree_KFP->Branch("_gamma_pE", &_gamma_pE);
-    _tree_KFP->Branch("_gamma_pT", &_gamma_pT);
-    _tree_KFP->Branch("_gamma_pTErr", &_gamma_pTErr);
-    _tree_KFP->Branch("_gamma_p", &_gamma_p);
-    _tree_KFP->Branch("_gamma_pErr", &_gamma_pErr);
-    _tree_KFP->Branch("_gamma_pseudorapidity", &_gamma_pseudorapidity);
-    _tree_KFP->Branch("_gamma_rapidity", &_gamma_rapidity);
-    _tree_KFP->Branch("_gamma_theta", &_gamma_theta);
-    _tree_KFP->Branch("_gamma_phi", &_gamma_phi);
-    _tree_KFP->Branch("_gamma_chi2", &_gamma_chi2);
-    _tree_KFP->Branch("_gamma_nDoF", &_gamma_nDoF);
-    _tree_KFP->Branch("_gamma_vertex_volume", &_gamma_vertex_volume);
-    _tree_KFP->Branch("_gamma_SV_chi2_per_nDoF", &_gamma_SV_chi2_per_nDoF);
-
-    _tree_KFP->Branch("_ep_mass", &_ep_mass);
-    _tree_KFP->Branch("_ep_x", &_ep_x);
-    _tree_KFP->Branch("_ep_x_raw", &_ep_x_raw);
-    _tree_KFP->Branch("_ep_y", &_ep_y);
-    _tree_KFP->Branch("_ep_y_raw", &_ep_y_raw);
-    _tree_KFP->Branch("_ep_z", &_ep_z);
-    _tree_KFP->Branch("_ep_z_raw", &_ep_z_raw);
-    _tree_KFP->Branch("_ep_px", &_ep_px);
-    _tree_KFP->Branch("_ep_px_raw", &_ep_px_raw);
-    _tree_KFP->Branch("_ep_py", &_ep_py);
-    _tree_KFP->Branch("_ep_py_raw", &_ep_py_raw);
-    _tree_KFP->Branch("_ep_pz", &_ep_pz);
-    _tree_KFP->Branch("_ep_pz_raw", &_ep_pz_raw);
-    _tree_KFP->Branch("_ep_pE", &_ep_pE);
-    _tree_KFP->Branch("_ep_pE_unmoved", &_ep_pE_unmoved);
-    _tree_KFP->Branch("_ep_pT", &_ep_pT);
-    _tree_KFP->Branch("_ep_pTErr", &_ep_pTErr);
-    _tree_KFP->Branch("_ep_pT_raw", &_ep_pT_raw);
-    _tree_KFP->Branch("_ep_pT_unmoved", &_ep_pT_unmoved);
-    _tree_KFP->Branch("_ep_p", &_ep_p);
-    _tree_KFP->Branch("_ep_pErr", &_ep_pErr);
-    _tree_KFP->Branch("_ep_p_raw", &_ep_p_raw);
-    _tree_KFP->Branch("_ep_p_unmoved", &_ep_p_unmoved);
-    _tree_KFP->Branch("_ep_pseudorapidity", &_ep_pseudorapidity);
-    _tree_KFP->Branch("_ep_pseudorapidity_raw", &_ep_pseudorapidity_raw);
-    _tree_KFP->Branch("_ep_rapidity", &_ep_rapidity);
-    _tree_KFP->Branch("_ep_theta", &_ep_theta);
-    _tree_KFP->Branch("_ep_phi", &_ep_phi);
-    _tree_KFP->Branch("_ep_phi_raw", &_ep_phi_raw);
-    _tree_KFP->Branch("_ep_chi2", &_ep_chi2);
-    _tree_KFP->Branch("_ep_chi2_raw", &_ep_chi2_raw);
-    _tree_KFP->Branch("_ep_nDoF", &_ep_nDoF);
-    _tree_KFP->Branch("_ep_nDoF_raw", &_ep_nDoF_raw);
-    _tree_KFP->Branch("_ep_crossing", &_ep_crossing);
-    _tree_KFP->Branch("_ep_clus_ican", &_ep_clus_ican);
-    //_tree_KFP->Branch("_ep_clus_type", &_ep_clus_type);
-    _tree_KFP->Branch("_ep_clus_x", &_ep_clus_x);
-    _tree_KFP->Branch("_ep_clus_y", &_ep_clus_y);
-    _tree_KFP->Branch("_ep_clus_z", &_ep_clus_z);
-    _tree_KFP->Branch("_ep_phi_emc", &_ep_phi_emc);
-    _tree_KFP->Branch("_ep_eta_emc", &_ep_eta_emc);
-    _tree_KFP->Branch("_ep_px_emc", &_ep_px_emc);
-    _tree_KFP->Branch("_ep_py_emc", &_ep_py_emc);
-    _tree_KFP->Branch("_ep_pz_emc", &_ep_pz_emc);
-    _tree_KFP->Branch("_ep_x_emc", &_ep_x_emc);
-    _tree_KFP->Branch("_ep_y_emc", &_ep_y_emc);
-    _tree_KFP->Branch("_ep_z_emc", &_ep_z_emc);
-    _tree_KFP->Branch("_ep_has_truthmatching", &_ep_has_truthmatching);
-    _tree_KFP->Branch("_ep_true_id", &_ep_true_id);
-    _tree_KFP->Branch("_ep_true_px", &_ep_true_px);
-    _tree_KFP->Branch("_ep_true_py", &_ep_true_py);
-    _tree_KFP->Branch("_ep_true_pz", &_ep_true_pz);
-    _tree_KFP->Branch("_ep_true_vertex_x", &_ep_true_vertex_x);
-    _tree_KFP->Branch("_ep_true_vertex_y", &_ep_true_vertex_y);
-    _tree_KFP->Branch("_ep_true_vertex_z", &_ep_true_vertex_z);
-    _tree_KFP->Branch("_ep_true_vertex_x_method2", &_ep_true_vertex_x_method2);
-    _tree_KFP->Branch("_ep_true_vertex_y_method2", &_ep_true_vertex_y_method2);
-    _tree_KFP->Branch("_ep_true_vertex_z_method2", &_ep_true_vertex_z_method2);
-
-    _tree_KFP->Branch("_em_mass", &_em_mass);
-    _tree_KFP->Branch("_em_x", &_em_x);
-    _tree_KFP->Branch("_em_x_raw", &_em_x_raw);
-    _tree_KFP->Branch("_em_y", &_em_y);
-    _tree_KFP->Branch("_em_y_raw", &_em_y_raw);
-    _tree_KFP->Branch("_em_z", &_em_z);
-    _tree_KFP->Branch("_em_z_raw", &_em_z_raw);
-    _tree_KFP->Branch("_em_px", &_em_px);
-    _tree_KFP->Branch("_em_px_raw", &_em_px_raw);
-    _tree_KFP->Branch("_em_py", &_em_py);
-    _tree_KFP->Branch("_em_py_raw", &_em_py_raw);
-    _tree_KFP->Branch("_em_pz", &_em_pz);
-    _tree_KFP->Branch("_em_pz_raw", &_em_pz_raw);
-    _tree_KFP->Branch("_em_pE", &_em_pE);
-    _tree_KFP->Branch("_em_pE_unmoved", &_em_pE_unmoved);
-    _tree_KFP->Branch("_em_pT", &_em_pT);
-    _tree_KFP->Branch("_em_pTErr", &_em_pTErr);
-    _tree_KFP->Branch("_em_pT_raw", &_em_pT_raw);
-    _tree_KFP->Branch("_em_pT_unmoved", &_em_pT_unmoved);
-    _tree_KFP->Branch("_em_p", &_em_p);
-    _tree_KFP->Branch("_em_pErr", &_em_pErr);
-    _tree_KFP->Branch("_em_p_raw", &_em_p_raw);
-    _tree_KFP->Branch("_em_p_unmoved", &_em_p_unmoved);
-    _tree_KFP->Branch("_em_pseudorapidity", &_em_pseudorapidity);
-    _tree_KFP->Branch("_em_pseudorapidity_raw", &_em_pseudorapidity_raw);
-    _tree_KFP->Branch("_em_rapidity", &_em_rapidity);
-    _tree_KFP->Branch("_em_theta", &_em_theta);
-    _tree_KFP->Branch("_em_phi", &_em_phi);
-    _tree_KFP->Branch("_em_phi_raw", &_em_phi_raw);
-    _tree_KFP->Branch("_em_chi2", &_em_chi2);
-    _tree_KFP->Branch("_em_chi2_raw", &_em_chi2_raw);
-    _tree_KFP->Branch("_em_nDoF", &_em_nDoF);
-    _tree_KFP->Branch("_em_nDoF_raw", &_em_nDoF_raw);
-    _tree_KFP->Branch("_em_crossing", &_em_crossing);
-    _tree_KFP->Branch("_em_clus_ican", &_em_clus_ican);
-    //_tree_KFP->Branch("_em_clus_type", &_em_clus_type);
-    _tree_KFP->Branch("_em_clus_x", &_em_clus_x);
-    _tree_KFP->Branch("_em_clus_y", &_em_clus_y);
-    _tree_KFP->Branch("_em_clus_z", &_em_clus_z);
-    _tree_KFP->Branch("_em_phi_emc", &_em_phi_emc);
-    _tree_KFP->Branch("_em_eta_emc", &_em_eta_emc);
-    _tree_KFP->Branch("_em_px_emc", &_em_px_emc);
-    _tree_KFP->Branch("_em_py_emc", &_em_py_emc);
-    _tree_KFP->Branch("_em_pz_emc", &_em_pz_emc);
-    _tree_KFP->Branch("_em_x_emc", &_em_x_emc);
-    _tree_KFP->Branch("_em_y_emc", &_em_y_emc);
-    _tree_KFP->Branch("_em_z_emc", &_em_z_emc);
-    _tree_KFP->Branch("_em_has_truthmatching", &_em_has_truthmatching);
-    _tree_KFP->Branch("_em_true_id", &_em_true_id);
-    _tree_KFP->Branch("_em_true_px", &_em_true_px);
-    _tree_KFP->Branch("_em_true_py", &_em_true_py);
-    _tree_KFP->Branch("_em_true_pz", &_em_true_pz);
-    _tree_KFP->Branch("_em_true_vertex_x", &_em_true_vertex_x);
-    _tree_KFP->Branch("_em_true_vertex_y", &_em_true_vertex_y);
-    _tree_KFP->Branch("_em_true_vertex_z", &_em_true_vertex_z);
-    _tree_KFP->Branch("_em_true_vertex_x_method2", &_em_true_vertex_x_method2);
-    _tree_KFP->Branch("_em_true_vertex_y_method2", &_em_true_vertex_y_method2);
-    _tree_KFP->Branch("_em_true_vertex_z_method2", &_em_true_vertex_z_method2);
-
-    _tree_KFP->Branch("_emcal_phi", &_emcal_phi);
-    _tree_KFP->Branch("_emcal_eta", &_emcal_eta);
-    _tree_KFP->Branch("_emcal_x", &_emcal_x);
-    _tree_KFP->Branch("_emcal_y", &_emcal_y);
-    _tree_KFP->Branch("_emcal_z", &_emcal_z);
-    _tree_KFP->Branch("_emcal_e", &_emcal_e);
-
-    _tree_KFP->Branch("_epem_DCA_2d", &_epem_DCA_2d);
-    _tree_KFP->Branch("_epem_DCA_3d", &_epem_DCA_3d);
-
-    _tree_KFP->Branch("_true_numCan", &_true_numCan);
-
-    _tree_KFP->Branch("_true_gamma_phi", &_true_gamma_phi);
-    _tree_KFP->Branch("_true_gamma_eta", &_true_gamma_eta);
-    _tree_KFP->Branch("_true_gamma_px", &_true_gamma_px);
-    _tree_KFP->Branch("_true_gamma_py", &_true_gamma_py);
-    _tree_KFP->Branch("_true_gamma_pz", &_true_gamma_pz);
-    _tree_KFP->Branch("_true_gamma_pE", &_true_gamma_pE);
-    _tree_KFP->Branch("_true_gamma_x", &_true_gamma_x);
-    _tree_KFP->Branch("_true_gamma_y", &_true_gamma_y);
-    _tree_KFP->Branch("_true_gamma_z", &_true_gamma_z);
-    _tree_KFP->Branch("_true_gamma_mother_id", &_true_gamma_mother_id);
-    _tree_KFP->Branch("_true_gamma_embedding_id", &_true_gamma_embedding_id);
-
-    _tree_KFP->Branch("_true_ep_phi", &_true_ep_phi);
-    _tree_KFP->Branch("_true_ep_eta", &_true_ep_eta);
-    _tree_KFP->Branch("_true_ep_px", &_true_ep_px);
-    _tree_KFP->Branch("_true_ep_py", &_true_ep_py);
-    _tree_KFP->Branch("_true_ep_pz", &_true_ep_pz);
-    _tree_KFP->Branch("_true_ep_pE", &_true_ep_pE);
-    _tree_KFP->Branch("_true_ep_x", &_true_ep_x);
-    _tree_KFP->Branch("_true_ep_y", &_true_ep_y);
-    _tree_KFP->Branch("_true_ep_z", &_true_ep_z);
-
-    _tree_KFP->Branch("_true_em_phi", &_true_em_phi);
-    _tree_KFP->Branch("_true_em_eta", &_true_em_eta);
-    _tree_KFP->Branch("_true_em_px", &_true_em_px);
-    _tree_KFP->Branch("_true_em_py", &_true_em_py);
-    _tree_KFP->Branch("_true_em_pz", &_true_em_pz);
-    _tree_KFP->Branch("_true_em_pE", &_true_em_pE);
-    _tree_KFP->Branch("_true_em_x", &_true_em_x);
-    _tree_KFP->Branch("_true_em_y", &_true_em_y);
-    _tree_KFP->Branch("_true_em_z", &_true_em_z);
+    m_kfp_output = openOutput("tree_KFP", "A tree with track/calo info after KFParticle", kKFPTree, ~0U, _tree_KFP);
+}
+
+//____________________________________________________________________________..
+int TrackToCalo::openOutput(const std::string &name, const std::string &title, unsigned int treeBit, unsigned int collections, TTree *&tree)
+{
+    tree = nullptr;
+    if (m_output_format == AsyncTreeWriter::kRNTuple)
+    {
+        int output = m_writer.addNTuple(name, _outfile, treeBit, collections);
+        if (output >= 0) return output;
+        std::cout << "TrackToCalo::openOutput - RNTuple output is not available, writing " << name << " as a TTree" << std::endl;
+    }
+    tree = new TTree(name.c_str(), title.c_str());
+    int output = m_writer.addTree(tree, treeBit, collections);
+    m_file_options.applyToTree(tree);
+    return output;
+}
+
+//____________________________________________________________________________..
+int TrackToCalo::InitRun(PHCompositeNode *topNode)
+{
+  m_calo_lut = CaloGeometryLUT::get(topNode, m_RawTowerGeomCont_name);
+  if (!m_calo_lut)
+  {
+    std::cout << "TrackToCalo::InitRun - calorimeter tower geometry not found, the calo only tree is not filled" << std::endl;
+  }
+  return Fun4AllReturnCodes::EVENT_OK;
 }
 
 //____________________________________________________________________________..
@@ -738,6 +531,17 @@ m_truthInfo->identify();
         m_svtx_evalstack->next_event(topNode);
     }
 
+    // seed walk, vertices and states shared with the other modules, if TrackSummaryMaker ran for this event
+    m_track_summary = findNode::getClass<TrackSummary>(topNode, m_track_summary_name);
+    if (m_track_summary && !m_track_summary->current(trackMap))
+    {
+      m_track_summary = nullptr;
+    }
+
+    // cluster positions are shared by the track, seed and KFP fills of this event
+    m_cluster_positions.setGeometry(acts_Geometry);
+    m_cluster_positions.clear();
+
     if (m_doTrkrCaloMatching)
     {
         ResetTreeVectors();
@@ -757,7 +561,16 @@ void TrackToCalo::fillTree()
 {
     if (m_doTrackOnly) {fillTree_TrackOnly();}
     if (m_doCaloOnly) {fillTree_CaloOnly();}
-    if (m_doTrackOnly || m_doCaloOnly) {_tree->Fill();}
+    if (m_doTrackOnly || m_doCaloOnly)
+    {
+        // the commit hands the columns over, so count the objects first
+        if (!m_level_indices.empty())
+        {
+            m_level_events.push_back({_runNumber, _eventNumber});
+            for (auto &level : m_level_indices) {level.counts.push_back(m_columns.size(level.collection, kMainTree));}
+        }
+        for (int output : m_main_outputs) {m_writer.commit(output);}
+    }
 }
 
 //____________________________________________________________________________..
@@ -855,7 +668,7 @@ void TrackToCalo::fillTree_TrackOnly()
       {
         const auto cluskey = iter->first;
         const auto cluster = iter->second;  // auto cluster = clusters->findCluster(key);
-        auto glob = acts_Geometry->getGlobalPosition(cluskey, cluster);
+        const Acts::Vector3 &glob = m_cluster_positions.get(cluskey, cluster);
         auto sclusgx = glob.x();
         auto sclusgy = glob.y();
         auto sclusgz = glob.z();
@@ -865,272 +678,317 @@ void TrackToCalo::fillTree_TrackOnly()
       }
     }
 
-    for (auto &iter : *trackMap)
-    {
-        track = iter.second;
+    if (m_doCaloOnly) resetCaloRadius();
 
-        if(!track) continue;
+    if (m_track_pool)
+    {
+      m_track_list.clear();
+      for (auto &iter : *trackMap)
+      {
+        m_track_list.push_back(iter.second);
+      }
+      if (m_track_rows.size() < m_track_list.size()) m_track_rows.resize(m_track_list.size());
 
-        if(track->get_pt() < m_track_pt_low_cut)
+      // the workers only read the cluster position cache; each track has its own row, so the merge below is in map order
+      m_track_pool->parallelFor(m_track_list.size(), 4, [this](unsigned int, std::size_t begin, std::size_t end)
+      {
+        for (std::size_t i = begin; i < end; i++)
         {
-          continue;
+          fillTrackRow(m_track_list[i], i, m_track_rows[i], false);
         }
-        // std::cout<<"pt = "<<track->get_pt()<<std::endl;
+      });
+      for (std::size_t i = 0; i < m_track_list.size(); i++)
+      {
+        appendTrackRow(m_track_rows[i]);
+      }
+    }
+    else
+    {
+      if (m_track_rows.empty()) m_track_rows.resize(1);
+      std::size_t index = 0;
+      for (auto &iter : *trackMap)
+      {
+        fillTrackRow(iter.second, index++, m_track_rows[0], true);
+        appendTrackRow(m_track_rows[0]);
+      }
+    }
 
-        if(track->get_quality() > m_track_quality)
-        {
-          continue;
-        }
+    if (m_doCaloOnly && (!m_helix_columns.empty() || m_validate_helix))
+    {
+      fillHelixProjections();
+    }
+}
 
-        seed = track->get_silicon_seed();
+//____________________________________________________________________________..
+void TrackToCalo::addHelixRadius(float radius)
+{
+  for (const auto &columns : m_helix_columns)
+  {
+    if (std::lround(columns.radius) == std::lround(radius))
+    {
+      std::cout << "TrackToCalo::addHelixRadius - radius " << radius << " cm is already written as " << columns.radius << " cm" << std::endl;
+      return;
+    }
+  }
+  const std::string suffix = "_r" + std::to_string(std::lround(radius));
+  m_helix_columns.push_back({radius,
+                             &m_columns.add<float>("_track_x" + suffix, kTrackColumns, kMainTree),
+                             &m_columns.add<float>("_track_y" + suffix, kTrackColumns, kMainTree),
+                             &m_columns.add<float>("_track_z" + suffix, kTrackColumns, kMainTree),
+                             &m_columns.add<float>("_track_phi" + suffix, kTrackColumns, kMainTree),
+                             &m_columns.add<float>("_track_eta" + suffix, kTrackColumns, kMainTree)});
+}
 
-        int n_mvtx_clusters = 0;
-        int n_intt_clusters = 0;
-        int n_tpc_clusters = 0;
-        short int bunch_crossing_number = -1;
+//____________________________________________________________________________..
+void TrackToCalo::fillHelixProjections()
+{
+    // every track with projections has an entry in the _emc columns, which may hold NaN
+    m_helix.clear();
+    for (std::size_t i = 0; i < _track_x_emc.size(); i++)
+    {
+      m_helix.add(_track_x_emc[i], _track_y_emc[i], _track_z_emc[i], _track_px_emc[i], _track_py_emc[i], _track_pz_emc[i],
+                  (_track_ptq[i] > 0) - (_track_ptq[i] < 0));
+    }
 
-        if(!seed)
-        {
-          _track_nc_mvtx.push_back(0);
-          _track_nc_intt.push_back(0);
-        }
-        else
-        {
-          for(auto key_iter = seed->begin_cluster_keys(); key_iter != seed->end_cluster_keys(); ++key_iter)
-          {
-            const auto& cluster_key = *key_iter;
-            trkrCluster = trkrContainer->findCluster(cluster_key);
-            if(!trkrCluster)
-            {
-              continue;
-            }
-            //unsigned int cluster_detector = TrkrDefs::getTrkrId(cluster_key);
-            if(TrkrDefs::getTrkrId(cluster_key) == TrkrDefs::TrkrId::mvtxId)
-            {
-              n_mvtx_clusters++;
-            }
-            //std::cout << "TrkrDefs::getTrkrId(cluster_key): " << cluster_detector << std::endl;
-            if(TrkrDefs::getTrkrId(cluster_key) == TrkrDefs::TrkrId::inttId)
-            {
-              n_intt_clusters++;
-              //TrkrClusterCrossingAssocv1::ConstRange bc_range = trkrContainerCrossing->getCrossings(cluster_key);
-              //for(TrkrClusterCrossingAssocv1::ConstIterator bcIter = bc_range.first; bcIter != bc_range.second; ++bcIter)
-              //{
-              //  if(bunch_crossing_number < 0) bunch_crossing_number = bcIter->second;
-              //  if(bunch_crossing_number != bcIter->second)
-              //  {
-              //    bunch_crossing_number = -1;
-              //    break;
-              //  }
-              //}
-            }
-            Acts::Vector3 global(0., 0., 0.);
-            global = acts_Geometry->getGlobalPosition(cluster_key, trkrCluster);
-            _trClus_track_id.push_back(track->get_id());
-            _trClus_type.push_back(TrkrDefs::getTrkrId(cluster_key));
-            _trClus_x.push_back(global[0]);
-            _trClus_y.push_back(global[1]);
-            _trClus_z.push_back(global[2]);
-          }
-          _track_nc_mvtx.push_back(n_mvtx_clusters);
-          _track_nc_intt.push_back(n_intt_clusters);
-        }
+    for (auto &columns : m_helix_columns)
+    {
+      m_helix.project(columns.radius, m_helix_points);
+      columns.x->insert(columns.x->end(), m_helix_points.x.begin(), m_helix_points.x.end());
+      columns.y->insert(columns.y->end(), m_helix_points.y.begin(), m_helix_points.y.end());
+      columns.z->insert(columns.z->end(), m_helix_points.z.begin(), m_helix_points.z.end());
+      columns.phi->insert(columns.phi->end(), m_helix_points.phi.begin(), m_helix_points.phi.end());
+      columns.eta->insert(columns.eta->end(), m_helix_points.eta.begin(), m_helix_points.eta.end());
+    }
 
-        tpc_seed = track->get_tpc_seed();
+    if (!m_validate_helix) return;
 
-        if(tpc_seed)
-        {
-          for(auto key_iter = tpc_seed->begin_cluster_keys(); key_iter != tpc_seed->end_cluster_keys(); ++key_iter)
-          {
-            const auto& cluster_key = *key_iter;
-            trkrCluster = trkrContainer->findCluster(cluster_key);
-            if(!trkrCluster)
-            {
-              continue;
-            }
-            if(TrkrDefs::getTrkrId(cluster_key) == TrkrDefs::TrkrId::tpcId)
-            {
-              n_tpc_clusters++;
-            }
-            Acts::Vector3 global(0., 0., 0.);
-            global = acts_Geometry->getGlobalPosition(cluster_key, trkrCluster);
-            _trClus_track_id.push_back(track->get_id());
-            _trClus_type.push_back(TrkrDefs::getTrkrId(cluster_key));
-            _trClus_x.push_back(global[0]);
-            _trClus_y.push_back(global[1]);
-            _trClus_z.push_back(global[2]);
-          }
-        }
+    const double radii[2] = {caloRadiusIHCal, caloRadiusOHCal};
+    const std::vector<float> *acts[2][3] = {{&_track_x_ihc, &_track_y_ihc, &_track_z_ihc}, {&_track_x_ohc, &_track_y_ohc, &_track_z_ohc}};
+    for (int k = 0; k < 2; k++)
+    {
+      m_helix.project(radii[k], m_helix_points);
+      for (std::size_t i = 0; i < m_helix.size(); i++)
+      {
+        const float dx = m_helix_points.x[i] - (*acts[k][0])[i];
+        const float dy = m_helix_points.y[i] - (*acts[k][1])[i];
+        const float dz = m_helix_points.z[i] - (*acts[k][2])[i];
+        const double distance = std::sqrt(dx * dx + dy * dy + dz * dz);
+        // no Acts state, or a helix which does not reach the radius
+        if (std::isnan(distance)) continue;
+        m_helix_checked[k]++;
+        m_helix_sum_distance[k] += distance;
+        m_helix_max_distance[k] = std::max(m_helix_max_distance[k], distance);
+        if (distance > m_helix_tolerance) m_helix_outside[k]++;
+      }
+    }
+}
 
-        if(n_tpc_clusters < m_ntpc_low_cut) 
-        {
-          continue;
-        }
+//____________________________________________________________________________..
+void TrackToCalo::fillTrackRow(SvtxTrack *thisTrack, std::size_t index, TrackRow &row, bool cache_positions)
+{
+    row.accepted = false;
+    row.passed_ntpc = false;
+    row.projected = false;
+    row.clusters.clear();
 
-        unsigned int m_vertexid = track->get_vertex_id();
-        bool track_have_vertex = false;
-        if (vertexMap)
-        {
-          auto vertexit = vertexMap->find(m_vertexid);
-          if (vertexit != vertexMap->end())
-          {
-            auto svtxvertex = vertexit->second;
-            m_vx = svtxvertex->get_x();
-            m_vy = svtxvertex->get_y();
-            m_vz = svtxvertex->get_z();
-            track_have_vertex = true;
-          }
-        }
+    if(!thisTrack) return;
 
-        if (track_have_vertex)
-        {
-          _track_vx.push_back(m_vx);
-          _track_vy.push_back(m_vy);
-          _track_vz.push_back(m_vz);
-        }
-        else
-        {
-          _track_vx.push_back(NAN);
-          _track_vy.push_back(NAN);
-          _track_vz.push_back(NAN);
-        }
+    if(thisTrack->get_pt() < m_track_pt_low_cut)
+    {
+      return;
+    }
 
-        _track_id.push_back(track->get_id());
-        _track_quality.push_back(track->get_quality());
-        //auto dcapair = TrackAnalysisUtils::get_dca(track, acts_vertex);
-        Acts::Vector3 zero = Acts::Vector3::Zero();
-        auto dcapair = TrackAnalysisUtils::get_dca(track, zero);
-        _track_dcaxy.push_back(dcapair.first.first);
-        _track_dcaz.push_back(dcapair.second.first);
-        _track_nc_tpc.push_back(n_tpc_clusters);
-        _track_bc.push_back(bunch_crossing_number);
-        _track_ptq.push_back(track->get_charge()*track->get_pt());
-        _track_px.push_back(track->get_px());
-        _track_py.push_back(track->get_py());
-        _track_pz.push_back(track->get_pz());
-        _track_phi.push_back(track->get_phi());
-        _track_eta.push_back(track->get_eta());
-        _track_pcax.push_back(track->get_x());
-        _track_pcay.push_back(track->get_y());
-        _track_pcaz.push_back(track->get_z());
-        _track_crossing.push_back(track->get_crossing());
-        // std::cout<<"ntpc = "<<n_tpc_clusters<<" px = "<<track->get_px()<<" py = "<<track->get_py()<<" pz = "<<track->get_pz()<<" phi = "<<track->get_phi()<<" eta = "<<track->get_eta()<<std::endl;
-
-        if (!m_doCaloOnly) continue;
-
-        resetCaloRadius();
-
-        // project to R=0
-        thisState = track->get_state(0);
+    if(thisTrack->get_quality() > m_track_quality)
+    {
+      return;
+    }
+    row.accepted = true;
 
-        if(!thisState)
-        {
-          _track_phi_origin.push_back(NAN);
-          _track_eta_origin.push_back(NAN);
-          _track_px_origin.push_back(NAN);
-          _track_py_origin.push_back(NAN);
-          _track_pz_origin.push_back(NAN);
-          _track_x_origin.push_back(NAN);
-          _track_y_origin.push_back(NAN);
-          _track_z_origin.push_back(NAN);
-        }
-        else
-        {
-          _track_phi_origin.push_back(thisState->get_phi());
-          _track_eta_origin.push_back(thisState->get_eta());
-          _track_px_origin.push_back(thisState->get_px());
-          _track_py_origin.push_back(thisState->get_py());
-          _track_pz_origin.push_back(thisState->get_pz());
-          _track_x_origin.push_back(thisState->get_x());
-          _track_y_origin.push_back(thisState->get_y());
-          _track_z_origin.push_back(thisState->get_z());
-        }
+    int n_mvtx_clusters = 0;
+    int n_intt_clusters = 0;
+    int n_tpc_clusters = 0;
+    short int bunch_crossing_number = -1;
 
-        // project to R_EMCAL
-        thisState = track->get_state(caloRadiusEMCal);
+    const TrackSummary *summary = m_track_summary;
+    if (summary)
+    {
+      // the seeds were already walked by TrackSummaryMaker
+      for (unsigned int k = summary->cluster_begin[index]; k < summary->cluster_begin[index + 1]; k++)
+      {
+        const Acts::Vector3 global = cache_positions ? m_cluster_positions.get(summary->cluster_key[k], summary->cluster[k]) : m_cluster_positions.position(summary->cluster_key[k], summary->cluster[k]);
+        row.clusters.push_back({TrkrDefs::getTrkrId(summary->cluster_key[k]), (float) global[0], (float) global[1], (float) global[2]});
+      }
+      n_mvtx_clusters = summary->nclusters[TrackSummary::kMvtx][index];
+      n_intt_clusters = summary->nclusters[TrackSummary::kIntt][index];
+      n_tpc_clusters = summary->nclusters[TrackSummary::kTpc][index];
+    }
 
-        if(!thisState)
-        {
-          _track_phi_emc.push_back(NAN);
-          _track_eta_emc.push_back(NAN);
-          _track_px_emc.push_back(NAN);
-          _track_py_emc.push_back(NAN);
-          _track_pz_emc.push_back(NAN);
-          _track_x_emc.push_back(NAN);
-          _track_y_emc.push_back(NAN);
-          _track_z_emc.push_back(NAN);
-        }
-        else
+    // the silicon seed clusters, then the TPC seed clusters
+    TrackSeed *seeds[2] = {thisTrack->get_silicon_seed(), thisTrack->get_tpc_seed()};
+    for (int iseed = 0; iseed < 2 && !summary; iseed++)
+    {
+      TrackSeed *thisSeed = seeds[iseed];
+      if(!thisSeed) continue;
+      for(auto key_iter = thisSeed->begin_cluster_keys(); key_iter != thisSeed->end_cluster_keys(); ++key_iter)
+      {
+        const auto& cluster_key = *key_iter;
+        TrkrCluster *thisCluster = trkrContainer->findCluster(cluster_key);
+        if(!thisCluster)
         {
-          _track_phi_emc.push_back(thisState->get_phi());
-          _track_eta_emc.push_back(thisState->get_eta());
-          _track_px_emc.push_back(thisState->get_px());
-          _track_py_emc.push_back(thisState->get_py());
-          _track_pz_emc.push_back(thisState->get_pz());
-          _track_x_emc.push_back(thisState->get_x());
-          _track_y_emc.push_back(thisState->get_y());
-          _track_z_emc.push_back(thisState->get_z());
-            // std::cout<<"proj x = "<<thisState->get_x()<<" , y = "<<thisState->get_y()<<" , z = "<<thisState->get_z()<<std::endl;
+          continue;
         }
-
-        // project to R_IHCAL
-        thisState = track->get_state(caloRadiusIHCal);
-
-        if(!thisState)
+        // the cluster counts only consider the seed the detector belongs to
+        const auto detector = TrkrDefs::getTrkrId(cluster_key);
+        if(iseed == 0)
         {
-          _track_phi_ihc.push_back(NAN);
-          _track_eta_ihc.push_back(NAN);
-          _track_px_ihc.push_back(NAN);
-          _track_py_ihc.push_back(NAN);
-          _track_pz_ihc.push_back(NAN);
-          _track_x_ihc.push_back(NAN);
-          _track_y_ihc.push_back(NAN);
-          _track_z_ihc.push_back(NAN);
+          if(detector == TrkrDefs::TrkrId::mvtxId) n_mvtx_clusters++;
+          if(detector == TrkrDefs::TrkrId::inttId) n_intt_clusters++;
         }
-        else
+        else if(detector == TrkrDefs::TrkrId::tpcId)
         {
-          _track_phi_ihc.push_back(thisState->get_phi());
-          _track_eta_ihc.push_back(thisState->get_eta());
-          _track_px_ihc.push_back(thisState->get_px());
-          _track_py_ihc.push_back(thisState->get_py());
-          _track_pz_ihc.push_back(thisState->get_pz());
-          _track_x_ihc.push_back(thisState->get_x());
-          _track_y_ihc.push_back(thisState->get_y());
-          _track_z_ihc.push_back(thisState->get_z());
+          n_tpc_clusters++;
         }
+        const Acts::Vector3 global = cache_positions ? m_cluster_positions.get(cluster_key, thisCluster) : m_cluster_positions.position(cluster_key, thisCluster);
+        row.clusters.push_back({detector, (float) global[0], (float) global[1], (float) global[2]});
+      }
+    }
+    row.id = thisTrack->get_id();
+    row.nc_mvtx = n_mvtx_clusters;
+    row.nc_intt = n_intt_clusters;
+    row.nc_tpc = n_tpc_clusters;
 
-        // project to R_OHCAL
-        thisState = track->get_state(caloRadiusOHCal);
+    if(n_tpc_clusters < m_ntpc_low_cut)
+    {
+      return;
+    }
+    row.passed_ntpc = true;
 
-        if(!thisState)
-        {
-          _track_phi_ohc.push_back(NAN);
-          _track_eta_ohc.push_back(NAN);
-          _track_px_ohc.push_back(NAN);
-          _track_py_ohc.push_back(NAN);
-          _track_pz_ohc.push_back(NAN);
-          _track_x_ohc.push_back(NAN);
-          _track_y_ohc.push_back(NAN);
-          _track_z_ohc.push_back(NAN);
-        }
-        else
-        {
-          _track_phi_ohc.push_back(thisState->get_phi());
-          _track_eta_ohc.push_back(thisState->get_eta());
-          _track_px_ohc.push_back(thisState->get_px());
-          _track_py_ohc.push_back(thisState->get_py());
-          _track_pz_ohc.push_back(thisState->get_pz());
-          _track_x_ohc.push_back(thisState->get_x());
-          _track_y_ohc.push_back(thisState->get_y());
-          _track_z_ohc.push_back(thisState->get_z());
-        }
+    row.vx = NAN;
+    row.vy = NAN;
+    row.vz = NAN;
+    if (summary)
+    {
+      row.vx = summary->vertex_x[index];
+      row.vy = summary->vertex_y[index];
+      row.vz = summary->vertex_z[index];
+    }
+    else if (vertexMap)
+    {
+      auto vertexit = vertexMap->find(thisTrack->get_vertex_id());
+      if (vertexit != vertexMap->end())
+      {
+        row.vx = vertexit->second->get_x();
+        row.vy = vertexit->second->get_y();
+        row.vz = vertexit->second->get_z();
+      }
+    }
+
+    if (summary)
+    {
+      row.dcaxy = summary->dcaxy[index];
+      row.dcaz = summary->dcaz[index];
+    }
+    else
+    {
+      //auto dcapair = TrackAnalysisUtils::get_dca(track, acts_vertex);
+      Acts::Vector3 zero = Acts::Vector3::Zero();
+      auto dcapair = TrackAnalysisUtils::get_dca(thisTrack, zero);
+      row.dcaxy = dcapair.first.first;
+      row.dcaz = dcapair.second.first;
+    }
+    row.quality = thisTrack->get_quality();
+    row.bc = bunch_crossing_number;
+    row.ptq = thisTrack->get_charge()*thisTrack->get_pt();
+    row.px = thisTrack->get_px();
+    row.py = thisTrack->get_py();
+    row.pz = thisTrack->get_pz();
+    row.phi = thisTrack->get_phi();
+    row.eta = thisTrack->get_eta();
+    row.pcax = thisTrack->get_x();
+    row.pcay = thisTrack->get_y();
+    row.pcaz = thisTrack->get_z();
+    row.crossing = thisTrack->get_crossing();
+
+    if (!m_doCaloOnly) return;
+    row.projected = true;
+
+    // project to R=0, R_EMCAL, R_IHCAL and R_OHCAL
+    const double radii[4] = {0, caloRadiusEMCal, caloRadiusIHCal, caloRadiusOHCal};
+    for (int i = 0; i < 4; i++)
+    {
+      // the summary holds the same states when it was made with the same radii
+      SvtxTrackState *state = (summary && summary->radius[i] == radii[i]) ? summary->state[i][index] : thisTrack->get_state(radii[i]);
+      if(!state)
+      {
+        row.states[i] = {NAN, NAN, NAN, NAN, NAN, NAN, NAN, NAN};
+      }
+      else
+      {
+        row.states[i] = {state->get_phi(), state->get_eta(), state->get_px(), state->get_py(), state->get_pz(), state->get_x(), state->get_y(), state->get_z()};
+      }
+    }
+}
+
+//____________________________________________________________________________..
+void TrackToCalo::appendTrackRow(const TrackRow &row)
+{
+    if (!row.accepted) return;
+
+    _track_nc_mvtx.push_back(row.nc_mvtx);
+    _track_nc_intt.push_back(row.nc_intt);
+    for (const auto &cluster : row.clusters)
+    {
+      _trClus_track_id.push_back(row.id);
+      _trClus_type.push_back(cluster.type);
+      _trClus_x.push_back(cluster.x);
+      _trClus_y.push_back(cluster.y);
+      _trClus_z.push_back(cluster.z);
+    }
+
+    if (!row.passed_ntpc) return;
+
+    _track_vx.push_back(row.vx);
+    _track_vy.push_back(row.vy);
+    _track_vz.push_back(row.vz);
+    _track_id.push_back(row.id);
+    _track_quality.push_back(row.quality);
+    _track_dcaxy.push_back(row.dcaxy);
+    _track_dcaz.push_back(row.dcaz);
+    _track_nc_tpc.push_back(row.nc_tpc);
+    _track_bc.push_back(row.bc);
+    _track_ptq.push_back(row.ptq);
+    _track_px.push_back(row.px);
+    _track_py.push_back(row.py);
+    _track_pz.push_back(row.pz);
+    _track_phi.push_back(row.phi);
+    _track_eta.push_back(row.eta);
+    _track_pcax.push_back(row.pcax);
+    _track_pcay.push_back(row.pcay);
+    _track_pcaz.push_back(row.pcaz);
+    _track_crossing.push_back(row.crossing);
+
+    if (!row.projected) return;
+
+    std::vector<float> *columns[4][8] = {
+        {&_track_phi_origin, &_track_eta_origin, &_track_px_origin, &_track_py_origin, &_track_pz_origin, &_track_x_origin, &_track_y_origin, &_track_z_origin},
+        {&_track_phi_emc, &_track_eta_emc, &_track_px_emc, &_track_py_emc, &_track_pz_emc, &_track_x_emc, &_track_y_emc, &_track_z_emc},
+        {&_track_phi_ihc, &_track_eta_ihc, &_track_px_ihc, &_track_py_ihc, &_track_pz_ihc, &_track_x_ihc, &_track_y_ihc, &_track_z_ihc},
+        {&_track_phi_ohc, &_track_eta_ohc, &_track_px_ohc, &_track_py_ohc, &_track_pz_ohc, &_track_x_ohc, &_track_y_ohc, &_track_z_ohc}};
+    for (int i = 0; i < 4; i++)
+    {
+      const ProjectedState &state = row.states[i];
+      const float values[8] = {state.phi, state.eta, state.px, state.py, state.pz, state.x, state.y, state.z};
+      for (int j = 0; j < 8; j++)
+      {
+        columns[i][j]->push_back(values[j]);
+      }
     }
 }
 
 //____________________________________________________________________________..
 void TrackToCalo::fillTree_CaloOnly()
 {
-  if (!clustersEM || !clustersHAD || !EMCAL_Container || !IHCAL_Container || !OHCAL_Container || !EMCalGeo || !IHCalGeo || !OHCalGeo)
+  if (!clustersEM || !clustersHAD || !EMCAL_Container || !IHCAL_Container || !OHCAL_Container || !m_calo_lut)
   {
     std::cout << PHWHERE << "missing node trees, can't continue with track calo matching (Calo Only Part)"
               << std::endl;
@@ -1214,13 +1072,16 @@ void TrackToCalo::fillTree_CaloOnly()
 
     for (toweriter = towers.first; toweriter != towers.second; ++toweriter)
     {
+      // towers outside the geometry or the container are skipped, keeping the tower columns aligned
+      int channel = m_calo_lut->channelOfTowerId(CaloGeometryLUT::kCEMC, toweriter->first);
+      if (channel < 0) continue;
+      towerInfo = EMCAL_Container->get_tower_at_channel(channel);
+      if (!towerInfo) continue;
+
       _emcal_tower_cluster_id.push_back(clusIter_EMC->first);
-      RawTowerGeom *tower_geom = EMCalGeo->get_tower_geometry(toweriter->first);
-      _emcal_tower_phi.push_back(tower_geom->get_phi());
-      _emcal_tower_eta.push_back(tower_geom->get_eta());
+      _emcal_tower_phi.push_back(m_calo_lut->phi(CaloGeometryLUT::kCEMC, channel));
+      _emcal_tower_eta.push_back(m_calo_lut->eta(CaloGeometryLUT::kCEMC, channel));
       _emcal_tower_e.push_back(toweriter->second);
-      unsigned int key = TowerInfoDefs::encode_emcal(tower_geom->get_bineta(), tower_geom->get_binphi());
-      towerInfo = EMCAL_Container->get_tower_at_key(key);
       _emcal_tower_status.push_back(towerInfo->get_status());
 
     }
@@ -1248,28 +1109,28 @@ void TrackToCalo::fillTree_CaloOnly()
 
     for (toweriter = towers.first; toweriter != towers.second; ++toweriter)
     {
-      _hcal_tower_cluster_id.push_back(clusIter_HAD->first);
-      RawTowerGeom *tower_geom = nullptr;
-      TowerInfo *towerInfo = nullptr;
+      CaloGeometryLUT::Calo calo = CaloGeometryLUT::kHCALIN;
+      TowerInfoContainer *container = IHCAL_Container;
       int tower_io = -1;
 
       if(RawTowerDefs::decode_caloid(toweriter->first) == RawTowerDefs::CalorimeterId::HCALOUT)
       {
-        tower_geom = OHCalGeo->get_tower_geometry(toweriter->first);
-        unsigned int key = TowerInfoDefs::encode_hcal(tower_geom->get_bineta(), tower_geom->get_binphi());
-        towerInfo = OHCAL_Container->get_tower_at_key(key);
+        calo = CaloGeometryLUT::kHCALOUT;
+        container = OHCAL_Container;
         tower_io = 2;
       }
       else if(RawTowerDefs::decode_caloid(toweriter->first) == RawTowerDefs::CalorimeterId::HCALIN)
       {
-        tower_geom = IHCalGeo->get_tower_geometry(toweriter->first);
-        unsigned int key = TowerInfoDefs::encode_hcal(tower_geom->get_bineta(), tower_geom->get_binphi());
-        towerInfo = IHCAL_Container->get_tower_at_key(key);
         tower_io = 1;
       }
+      int channel = m_calo_lut->channelOfTowerId(calo, toweriter->first);
+      if (channel < 0) continue;
+      TowerInfo *towerInfo = container->get_tower_at_channel(channel);
+      if (!towerInfo) continue;
 
-      _hcal_tower_phi.push_back(tower_geom->get_phi());
-      _hcal_tower_eta.push_back(tower_geom->get_eta());
+      _hcal_tower_cluster_id.push_back(clusIter_HAD->first);
+      _hcal_tower_phi.push_back(m_calo_lut->phi(calo, channel));
+      _hcal_tower_eta.push_back(m_calo_lut->eta(calo, channel));
       _hcal_tower_e.push_back(toweriter->second);
       _hcal_tower_status.push_back(towerInfo->get_status());
       _hcal_tower_io.push_back(tower_io);
@@ -1363,10 +1224,8 @@ void TrackToCalo::fillTree_KFP()
     return;
   }
 
-  size_t length_kfps = KFP_Container->size();
-  if (static_cast<int>(length_kfps) % 3 != 0)
+  if (!buildKFPCandidates())
   {
-    std::cout<<"Why KFParticle is not 3*n? Skip!"<<std::endl;
     return;
   }
 
@@ -1383,13 +1242,12 @@ void TrackToCalo::fillTree_KFP()
   //  std::cout<<"svtxtrack id = "<<kfp->get_id()<<" px = "<<kfp->get_px()<<" py = "<<kfp->get_py()<<" pz = "<<kfp->get_pz()<<std::endl;
   //}
 
-  _numCan = static_cast<int>(length_kfps) / 3;
+  _numCan = static_cast<int>(m_kfp_candidates.size());
 
   for (int i = 0; i < _numCan; i++)
   {
-    auto it_kfp_cont = KFP_Container->begin();
-    std::advance(it_kfp_cont, 3 * i);
-    kfp_mother = it_kfp_cont->second;
+    const KFPCandidate &candidate = m_kfp_candidates[i];
+    kfp_mother = candidate.mother;
 
     float mass, massErr;
     kfp_mother->GetMass(mass, massErr);
@@ -1418,12 +1276,10 @@ void TrackToCalo::fillTree_KFP()
     //float em_z_emc = NAN;
 
     // one for e+, one for e-
-    for (int j = 1; j <= 2; j++)
+    for (int j = 0; j < 2; j++)
     {
 
-      it_kfp_cont = KFP_Container->begin();
-      std::advance(it_kfp_cont, 3 * i + j);
-      kfp_daughter = it_kfp_cont->second;
+      kfp_daughter = candidate.daughters[j];
       float p_daughter_unmoved = kfp_daughter->GetP();
       float e_daughter_unmoved = kfp_daughter->GetE();
       float pt_daughter_unmoved = kfp_daughter->GetPt();
@@ -1433,9 +1289,7 @@ void TrackToCalo::fillTree_KFP()
 //std::cout<<"KFP: after SetProductionVertex kfp_daughter->GetMass() = "<<kfp_daughter->GetMass()<<std::endl;
 //std::cout<<"KFP: after SetProductionVertex sqrt(E2-p2) = "<<sqrt(pow(kfp_daughter->GetE(),2) - pow(kfp_daughter->GetPx(),2) - pow(kfp_daughter->GetPy(),2) - pow(kfp_daughter->GetPz(),2))<<std::endl;
 
-      auto it_kfp_trackmap = KFP_trackMap->begin();
-      std::advance(it_kfp_trackmap, 3 * i + j);
-      track = it_kfp_trackmap->second;
+      track = candidate.daughter_tracks[j];
 
       bool isParticleValid = false;
       int true_id = 0;
@@ -1549,8 +1403,7 @@ void TrackToCalo::fillTree_KFP()
             {
               continue;
             }
-            Acts::Vector3 global(0., 0., 0.);
-            global = acts_Geometry->getGlobalPosition(cluster_key, trkrCluster);
+            const Acts::Vector3 &global = m_cluster_positions.get(cluster_key, trkrCluster);
             _em_clus_ican.push_back(i);
             //_em_clus_type.push_back(TrkrDefs::getTrkrId(cluster_key));
             _em_clus_x.push_back(global[0]);
@@ -1648,8 +1501,7 @@ void TrackToCalo::fillTree_KFP()
             {
               continue;
             }
-            Acts::Vector3 global(0., 0., 0.);
-            global = acts_Geometry->getGlobalPosition(cluster_key, trkrCluster);
+            const Acts::Vector3 &global = m_cluster_positions.get(cluster_key, trkrCluster);
             _ep_clus_ican.push_back(i);
             //_ep_clus_type.push_back(TrkrDefs::getTrkrId(cluster_key));
             _ep_clus_x.push_back(global[0]);
@@ -1706,21 +1558,23 @@ void TrackToCalo::fillTree_KFP()
     cluster = clusIter_EMC->second;
     if(cluster->get_energy() < m_emcal_e_low_cut) continue;
 
-    _emcal_e.push_back(cluster->get_energy());
-    _emcal_phi.push_back(RawClusterUtility::GetAzimuthAngle(*cluster, vertex));
-    _emcal_eta.push_back(RawClusterUtility::GetPseudorapidity(*cluster, vertex));
-    _emcal_x.push_back(cluster->get_x());
-    _emcal_y.push_back(cluster->get_y());
-    _emcal_z.push_back(cluster->get_z());
+    _kfp_emcal_e.push_back(cluster->get_energy());
+    _kfp_emcal_phi.push_back(RawClusterUtility::GetAzimuthAngle(*cluster, vertex));
+    _kfp_emcal_eta.push_back(RawClusterUtility::GetPseudorapidity(*cluster, vertex));
+    _kfp_emcal_x.push_back(cluster->get_x());
+    _kfp_emcal_y.push_back(cluster->get_y());
+    _kfp_emcal_z.push_back(cluster->get_z());
   }
 
 std::cout<<"begin truth matching"<<std::endl;
   if (m_doTruthMatching)
   {
+    // the truth index is only built if a daughter has to be looked up in the G4 container
+    m_truth_index.clear();
     _true_numCan = m_decayMap->size();
     for (auto &iter : *m_decayMap)
     {
-      Decay decay = iter.second;
+      const Decay &decay = iter.second;
 
       if (decay.size() % 3 != 0)
       {
@@ -1728,10 +1582,10 @@ std::cout<<"begin truth matching"<<std::endl;
         return;
       }
 
-      TLorentzVector *motherTrueLV = new TLorentzVector();
-      TLorentzVector *daughterTrueLV = new TLorentzVector();
-      TVector3 *mother3Vector = new TVector3();
-      TVector3 *daughter3Vector = new TVector3();
+      TLorentzVector motherTrueLV;
+      TLorentzVector daughterTrueLV;
+      TVector3 mother3Vector;
+      TVector3 daughter3Vector;
       int grandmotherID = -9999;
 
       HepMC::GenEvent *theEvent = nullptr;
@@ -1745,20 +1599,20 @@ std::cout<<"begin truth matching"<<std::endl;
         HepMC::GenParticle *motherHepMC = theEvent->barcode_to_particle(decay[0].first.second);
         assert(motherHepMC);
 
-        motherTrueLV->SetPxPyPzE(motherHepMC->momentum().px(), motherHepMC->momentum().py(), motherHepMC->momentum().pz(), motherHepMC->momentum().e());
+        motherTrueLV.SetPxPyPzE(motherHepMC->momentum().px(), motherHepMC->momentum().py(), motherHepMC->momentum().pz(), motherHepMC->momentum().e());
 
         // Now get the production vertex position
         HepMC::GenVertex *thisVtx = motherHepMC->production_vertex();
 
         if (thisVtx != nullptr) {
-          mother3Vector->SetXYZ(thisVtx->point3d().x(), thisVtx->point3d().y(), thisVtx->point3d().z());
+          mother3Vector.SetXYZ(thisVtx->point3d().x(), thisVtx->point3d().y(), thisVtx->point3d().z());
           for (auto grandmother = thisVtx->particles_in_const_begin(); grandmother != thisVtx->particles_in_const_end(); grandmother++) {
             grandmotherID = (*grandmother)->pdg_id();
             //std::cout<<"HepMC grandmotherID = "<<grandmotherID<<std::endl;
           }
         }
         else {
-          mother3Vector->SetXYZ(-999,-999,-999);
+          mother3Vector.SetXYZ(-999,-999,-999);
           //std::cout<<"No grandmotherID in HepMC, because no production vertex."<<std::endl;
         }
       }
@@ -1769,66 +1623,48 @@ std::cout<<"begin truth matching"<<std::endl;
         if (theEvent && decay[i].first.second > -1)
         {
           HepMC::GenParticle *daughterHepMC = theEvent->barcode_to_particle(decay[i].first.second);
-          daughterTrueLV->SetPxPyPzE(daughterHepMC->momentum().px(), daughterHepMC->momentum().py(), daughterHepMC->momentum().pz(), daughterHepMC->momentum().e());
+          daughterTrueLV.SetPxPyPzE(daughterHepMC->momentum().px(), daughterHepMC->momentum().py(), daughterHepMC->momentum().pz(), daughterHepMC->momentum().e());
           pid = daughterHepMC->pdg_id();
 
           // Now get the decay vertex position
           HepMC::GenVertex *thisVtx = daughterHepMC->production_vertex();
 
-          daughter3Vector->SetXYZ(thisVtx->point3d().x(), thisVtx->point3d().y(), thisVtx->point3d().z());
+          daughter3Vector.SetXYZ(thisVtx->point3d().x(), thisVtx->point3d().y(), thisVtx->point3d().z());
         }
         else
         {
-          PHG4TruthInfoContainer::ConstRange range = m_truthInfo->GetParticleRange();
-//m_truthInfo->identify();
-//exit(1);
-          for (PHG4TruthInfoContainer::ConstIterator iter2 = range.first; iter2 != range.second; ++iter2)
+          if (!m_truth_index.isBuilt())
           {
-            PHG4Particle *daughterG4 = iter2->second;
+            m_truth_index.build(m_truthInfo);
+          }
 
-            PHG4Particle *motherG4 = nullptr;
-            PHG4Particle *grandmotherG4 = nullptr;
-            if (daughterG4->get_parent_id() != 0)
-            {
-              motherG4 = m_truthInfo->GetParticle(daughterG4->get_parent_id());
-              if (motherG4->get_parent_id() != 0)
-              {
-                grandmotherG4 = m_truthInfo->GetParticle(motherG4->get_parent_id());
-              }
-            }
-            else
-            {
-              continue;
-            }
+          // all particles with the daughter's (barcode, pid), in container order; the last match wins
+          for (int ientry = m_truth_index.first(decay[i].first.second, decay[i].second); ientry >= 0; ientry = m_truth_index.entry(ientry).next)
+          {
+            const TruthParticleIndex::Entry &truth = m_truth_index.entry(ientry);
+            PHG4Particle *daughterG4 = truth.particle;
+            PHG4Particle *motherG4 = truth.mother;
+            PHG4Particle *grandmotherG4 = truth.grandmother;
 
-            if (motherG4->get_pid() == decay[0].second && motherG4->get_barcode() == decay[0].first.second && daughterG4->get_pid() == decay[i].second && daughterG4->get_barcode() == decay[i].first.second)
+            if (motherG4->get_pid() == decay[0].second && motherG4->get_barcode() == decay[0].first.second)
             {
               pid = daughterG4->get_pid();
 
-              TVector3 *motherTrue3Vector = new TVector3(motherG4->get_px(), motherG4->get_py(), motherG4->get_pz());
-              motherTrueLV->SetVectM((*motherTrue3Vector), getParticleMass(decay[0].second));
+              motherTrueLV.SetVectM(TVector3(motherG4->get_px(), motherG4->get_py(), motherG4->get_pz()), getParticleMass(decay[0].second));
 
-              PHG4VtxPoint *thisVtx = m_truthInfo->GetVtx(motherG4->get_vtx_id());
-              mother3Vector->SetXYZ(thisVtx->get_x(), thisVtx->get_y(), thisVtx->get_z());
+              PHG4VtxPoint *thisVtx = truth.mother_vertex;
+              mother3Vector.SetXYZ(thisVtx->get_x(), thisVtx->get_y(), thisVtx->get_z());
 
-              daughterTrueLV->SetVectM(TVector3(daughterG4->get_px(), daughterG4->get_py(), daughterG4->get_pz()), getParticleMass(decay[i].second));
+              daughterTrueLV.SetVectM(TVector3(daughterG4->get_px(), daughterG4->get_py(), daughterG4->get_pz()), getParticleMass(decay[i].second));
 
               // Now get the decay vertex position
-              thisVtx = m_truthInfo->GetVtx(daughterG4->get_vtx_id());
-              daughter3Vector->SetXYZ(thisVtx->get_x(), thisVtx->get_y(), thisVtx->get_z());
-//std::cout<<"daughterG4->get_pid() = "<<daughterG4->get_pid()<<" , daughterG4->get_barcode() = "<<daughterG4->get_barcode()<<" , thisVtx->get_x() = "<<thisVtx->get_x()<<std::endl;
+              thisVtx = truth.vertex;
+              daughter3Vector.SetXYZ(thisVtx->get_x(), thisVtx->get_y(), thisVtx->get_z());
 
               if (grandmotherG4)
               {
                 grandmotherID = grandmotherG4->get_pid();
-                //std::cout<<"G4 grandmotherID = "<<grandmotherID<<std::endl;
-              }
-              else
-              {
-                //std::cout<<"No grandmotherID in G4."<<std::endl;
               }
-
-              delete motherTrue3Vector;
             }
           }
         }
@@ -1836,344 +1672,182 @@ std::cout<<"begin truth matching"<<std::endl;
         // e+ pdgid = -11, e- pdgid = 11
         if (pid==-11)
         {
-          _true_ep_px.push_back(daughterTrueLV->Px());
-          _true_ep_py.push_back(daughterTrueLV->Py());
-          _true_ep_pz.push_back(daughterTrueLV->Pz());
-          _true_ep_pE.push_back(daughterTrueLV->E());
-          _true_ep_eta.push_back(daughterTrueLV->PseudoRapidity());
-          _true_ep_phi.push_back(daughterTrueLV->Phi());
-          _true_ep_x.push_back(daughter3Vector->X());
-          _true_ep_y.push_back(daughter3Vector->Y());
-          _true_ep_z.push_back(daughter3Vector->Z());
+          _true_ep_px.push_back(daughterTrueLV.Px());
+          _true_ep_py.push_back(daughterTrueLV.Py());
+          _true_ep_pz.push_back(daughterTrueLV.Pz());
+          _true_ep_pE.push_back(daughterTrueLV.E());
+          _true_ep_eta.push_back(daughterTrueLV.PseudoRapidity());
+          _true_ep_phi.push_back(daughterTrueLV.Phi());
+          _true_ep_x.push_back(daughter3Vector.X());
+          _true_ep_y.push_back(daughter3Vector.Y());
+          _true_ep_z.push_back(daughter3Vector.Z());
         }
         else if (pid==11)
         {
-          _true_em_px.push_back(daughterTrueLV->Px());
-          _true_em_py.push_back(daughterTrueLV->Py());
-          _true_em_pz.push_back(daughterTrueLV->Pz());
-          _true_em_pE.push_back(daughterTrueLV->E());
-          _true_em_eta.push_back(daughterTrueLV->PseudoRapidity());
-          _true_em_phi.push_back(daughterTrueLV->Phi());
-          _true_em_x.push_back(daughter3Vector->X());
-          _true_em_y.push_back(daughter3Vector->Y());
-          _true_em_z.push_back(daughter3Vector->Z());
+          _true_em_px.push_back(daughterTrueLV.Px());
+          _true_em_py.push_back(daughterTrueLV.Py());
+          _true_em_pz.push_back(daughterTrueLV.Pz());
+          _true_em_pE.push_back(daughterTrueLV.E());
+          _true_em_eta.push_back(daughterTrueLV.PseudoRapidity());
+          _true_em_phi.push_back(daughterTrueLV.Phi());
+          _true_em_x.push_back(daughter3Vector.X());
+          _true_em_y.push_back(daughter3Vector.Y());
+          _true_em_z.push_back(daughter3Vector.Z());
         }
 
       }
 
-      _true_gamma_px.push_back(motherTrueLV->Px());
-      _true_gamma_py.push_back(motherTrueLV->Py());
-      _true_gamma_pz.push_back(motherTrueLV->Pz());
-      _true_gamma_pE.push_back(motherTrueLV->E());
-      _true_gamma_eta.push_back(motherTrueLV->PseudoRapidity());
-      _true_gamma_phi.push_back(motherTrueLV->Phi());
-      _true_gamma_x.push_back(mother3Vector->X());
-      _true_gamma_y.push_back(mother3Vector->Y());
-      _true_gamma_z.push_back(mother3Vector->Z());
+      _true_gamma_px.push_back(motherTrueLV.Px());
+      _true_gamma_py.push_back(motherTrueLV.Py());
+      _true_gamma_pz.push_back(motherTrueLV.Pz());
+      _true_gamma_pE.push_back(motherTrueLV.E());
+      _true_gamma_eta.push_back(motherTrueLV.PseudoRapidity());
+      _true_gamma_phi.push_back(motherTrueLV.Phi());
+      _true_gamma_x.push_back(mother3Vector.X());
+      _true_gamma_y.push_back(mother3Vector.Y());
+      _true_gamma_z.push_back(mother3Vector.Z());
       _true_gamma_mother_id.push_back(grandmotherID);
       _true_gamma_embedding_id.push_back(decay[0].first.first);
     }
 
   }
 
-  _tree_KFP->Fill();
+  m_writer.commit(m_kfp_output);
+
+}
+
+//____________________________________________________________________________..
+bool TrackToCalo::buildKFPCandidates()
+{
+  m_kfp_candidates.clear();
+
+  // the KFParticle track map stores one SvtxTrack per container entry, in the same order
+  if (KFP_trackMap->size() != KFP_Container->size())
+  {
+    std::cout << "TrackToCalo::buildKFPCandidates " << m_KFPtrackMap_name << " has " << KFP_trackMap->size()
+              << " entries but " << m_KFPCont_name << " has " << KFP_Container->size() << ". Skip!" << std::endl;
+    return false;
+  }
+
+  m_kfp_entries.clear();
+  auto it_kfp_trackmap = KFP_trackMap->begin();
+  for (auto &iter : *KFP_Container)
+  {
+    m_kfp_entries.emplace_back(iter.second, it_kfp_trackmap->second);
+    ++it_kfp_trackmap;
+  }
+
+  // entries come as (mother, daughter, daughter) triplets; a triplet is accepted when the mother is
+  // neutral and the daughters have opposite unit charge, otherwise the walk resynchronizes one entry later
+  size_t n_skipped = 0;
+  size_t k = 0;
+  while (k + 2 < m_kfp_entries.size())
+  {
+    KFParticle *mother = m_kfp_entries[k].first;
+    KFParticle *daughter1 = m_kfp_entries[k + 1].first;
+    KFParticle *daughter2 = m_kfp_entries[k + 2].first;
+    if (mother && daughter1 && daughter2 && mother->Q() == 0 && daughter1->Q() * daughter2->Q() == -1 &&
+        m_kfp_entries[k + 1].second && m_kfp_entries[k + 2].second)
+    {
+      m_kfp_candidates.push_back({mother, {daughter1, daughter2}, {m_kfp_entries[k + 1].second, m_kfp_entries[k + 2].second}});
+      k += 3;
+    }
+    else
+    {
+      n_skipped++;
+      k++;
+    }
+  }
+  n_skipped += m_kfp_entries.size() - k;
+
+  if (n_skipped > 0)
+  {
+    std::cout << "TrackToCalo::buildKFPCandidates " << n_skipped << " of " << m_kfp_entries.size()
+              << " KFParticle entries are not part of a (neutral mother, e+, e-) triplet and are skipped" << std::endl;
+  }
 
+  return !m_kfp_candidates.empty();
 }
 
 //____________________________________________________________________________..
 int TrackToCalo::End(PHCompositeNode *topNode)
 {
   std::cout << topNode << std::endl;
+  // the writer thread has to be done with the trees before they are written
+  m_writer.flush();
+  if (m_writer.depth() > 0)
+  {
+    std::cout << "TrackToCalo::End output queue: " << m_writer.stalls() << " stalls, at most "
+              << m_writer.maxQueued() << " events queued, " << m_writer.fillErrors() << " fill errors" << std::endl;
+  }
+  if (m_validate_helix)
+  {
+    const char *names[2] = {"iHCal", "oHCal"};
+    for (int k = 0; k < 2; k++)
+    {
+      if (m_helix_checked[k] == 0) continue;
+      std::cout << "TrackToCalo::End helix vs Acts states at the " << names[k] << " radius: " << m_helix_checked[k]
+                << " tracks, mean distance " << m_helix_sum_distance[k] / m_helix_checked[k] << " cm, max "
+                << m_helix_max_distance[k] << " cm, " << 100. * m_helix_outside[k] / m_helix_checked[k]
+                << "% beyond " << m_helix_tolerance << " cm" << std::endl;
+    }
+  }
+  // the normalized trees are joined on (run, event)
+  for (TTree *tree : m_level_trees)
+  {
+    tree->BuildIndex("_runNumber", "_eventNumber");
+  }
   _outfile->cd();
+  writeLevelIndices();
   _outfile->Write();
   _outfile->Close();
+
   return Fun4AllReturnCodes::EVENT_OK;
 }
 
+//____________________________________________________________________________..
+void TrackToCalo::writeLevelIndices()
+{
+  for (const auto &level : m_level_indices)
+  {
+    const std::string name = level.name + "_index";
+    TTree *index = new TTree(name.c_str(), ("Entry and position of every object of " + level.name + ", keyed by (_runNumber, _key)").c_str());
+    int run = 0;
+    int event = 0;
+    int position = 0;
+    Long64_t key = 0;
+    Long64_t entry = 0;
+    index->Branch("_runNumber", &run);
+    index->Branch("_eventNumber", &event);
+    index->Branch("_index", &position);
+    index->Branch("_key", &key);
+    index->Branch("_entry", &entry);
+    m_file_options.applyToTree(index);
+    for (entry = 0; entry < static_cast<Long64_t>(level.counts.size()); entry++)
+    {
+      run = m_level_events[entry].first;
+      event = m_level_events[entry].second;
+      for (position = 0; position < static_cast<int>(level.counts[entry]); position++)
+      {
+        key = levelKey(event, position);
+        index->Fill();
+      }
+    }
+    index->BuildIndex("_runNumber", "_key");
+    // the branches point at the locals of this function
+    index->ResetBranchAddresses();
+  }
+}
+
+//____________________________________________________________________________..
 void TrackToCalo::ResetTreeVectors()
 {
-  _vertex_id.clear();
-  _vertex_crossing.clear();
-  _vertex_ntracks.clear();
-  _vertex_x.clear();
-  _vertex_y.clear();
-  _vertex_z.clear();
-  _cluster_x.clear();
-  _cluster_y.clear();
-  _cluster_z.clear();
-  _track_id.clear();
-  _track_bc.clear();
-  _track_phi.clear();
-  _track_eta.clear();
-  _track_pcax.clear();
-  _track_pcay.clear();
-  _track_pcaz.clear();
-  _track_crossing.clear();
-  _track_vx.clear();
-  _track_vy.clear();
-  _track_vz.clear();
-  _track_quality.clear();
-  _track_dcaxy.clear();
-  _track_dcaz.clear();
-  _track_nc_mvtx.clear();
-  _track_nc_intt.clear();
-  _track_nc_tpc.clear();
-  _track_ptq.clear();
-  _track_px.clear();
-  _track_py.clear();
-  _track_pz.clear();
-  _track_phi_origin.clear();
-  _track_eta_origin.clear();
-  _track_px_origin.clear();
-  _track_py_origin.clear();
-  _track_pz_origin.clear();
-  _track_x_origin.clear();
-  _track_y_origin.clear();
-  _track_z_origin.clear();
-  _track_phi_emc.clear();
-  _track_eta_emc.clear();
-  _track_px_emc.clear();
-  _track_py_emc.clear();
-  _track_pz_emc.clear();
-  _track_x_emc.clear();
-  _track_y_emc.clear();
-  _track_z_emc.clear();
-  _track_phi_ihc.clear();
-  _track_eta_ihc.clear();
-  _track_px_ihc.clear();
-  _track_py_ihc.clear();
-  _track_pz_ihc.clear();
-  _track_x_ihc.clear();
-  _track_y_ihc.clear();
-  _track_z_ihc.clear();
-  _track_phi_ohc.clear();
-  _track_eta_ohc.clear();
-  _track_px_ohc.clear();
-  _track_py_ohc.clear();
-  _track_pz_ohc.clear();
-  _track_x_ohc.clear();
-  _track_y_ohc.clear();
-  _track_z_ohc.clear();
-  _trClus_track_id.clear();
-  _trClus_type.clear();
-  _trClus_x.clear();
-  _trClus_y.clear();
-  _trClus_z.clear();
-  _emcal_id.clear();
-  _emcal_phi.clear();
-  _emcal_eta.clear();
-  _emcal_x.clear();
-  _emcal_y.clear();
-  _emcal_z.clear();
-  _emcal_e.clear();
-  _emcal_ecore.clear();
-  _emcal_prob.clear();
-  _emcal_chi2.clear();
-  _emcal_tower_cluster_id.clear();
-  _emcal_tower_e.clear();
-  _emcal_tower_phi.clear();
-  _emcal_tower_eta.clear();
-  _emcal_tower_status.clear();
-  _hcal_id.clear();
-  _hcal_phi.clear();
-  _hcal_eta.clear();
-  _hcal_x.clear();
-  _hcal_y.clear();
-  _hcal_z.clear();
-  _hcal_e.clear();
-  _hcal_tower_cluster_id.clear();
-  _hcal_tower_e.clear();
-  _hcal_tower_phi.clear();
-  _hcal_tower_eta.clear();
-  _hcal_tower_status.clear();
-  _hcal_tower_io.clear();
-  _mbd_x.clear();
-  _mbd_y.clear();
-  _mbd_z.clear();
-  _triggers.clear();
-  _ntracks.clear();
+  m_columns.reset(kMainTree);
 }
 
 void TrackToCalo::ResetTreeVectors_KFP()
 {
-  _gamma_mass.clear();
-  _gamma_massErr.clear();
-  _gamma_x.clear();
-  _gamma_y.clear();
-  _gamma_z.clear();
-  _gamma_px.clear();
-  _gamma_py.clear();
-  _gamma_pz.clear();
-  _gamma_pE.clear();
-  _gamma_pT.clear();
-  _gamma_pTErr.clear();
-  _gamma_p.clear();
-  _gamma_pErr.clear();
-  _gamma_pseudorapidity.clear();
-  _gamma_rapidity.clear();
-  _gamma_theta.clear();
-  _gamma_phi.clear();
-  _gamma_chi2.clear();
-  _gamma_nDoF.clear();
-  _gamma_vertex_volume.clear();
-  _gamma_SV_chi2_per_nDoF.clear();
-  _ep_mass.clear();
-  _ep_x.clear();
-  _ep_x_raw.clear();
-  _ep_y.clear();
-  _ep_y_raw.clear();
-  _ep_z.clear();
-  _ep_z_raw.clear();
-  _ep_px.clear();
-  _ep_px_raw.clear();
-  _ep_py.clear();
-  _ep_py_raw.clear();
-  _ep_pz.clear();
-  _ep_pz_raw.clear();
-  _ep_pE.clear();
-  _ep_pE_unmoved.clear();
-  _ep_pT.clear();
-  _ep_pTErr.clear();
-  _ep_pT_raw.clear();
-  _ep_pT_unmoved.clear();
-  _ep_p.clear();
-  _ep_pErr.clear();
-  _ep_p_raw.clear();
-  _ep_p_unmoved.clear();
-  _ep_pseudorapidity.clear();
-  _ep_pseudorapidity_raw.clear();
-  _ep_rapidity.clear();
-  _ep_theta.clear();
-  _ep_phi.clear();
-  _ep_phi_raw.clear();
-  _ep_chi2.clear();
-  _ep_chi2_raw.clear();
-  _ep_nDoF.clear();
-  _ep_nDoF_raw.clear();
-  _ep_crossing.clear();
-  _ep_clus_ican.clear();
-  _ep_clus_x.clear();
-  _ep_clus_y.clear();
-  _ep_clus_z.clear();
-  _ep_phi_emc.clear();
-  _ep_eta_emc.clear();
-  _ep_px_emc.clear();
-  _ep_py_emc.clear();
-  _ep_pz_emc.clear();
-  _ep_x_emc.clear();
-  _ep_y_emc.clear();
-  _ep_z_emc.clear();
-  _em_mass.clear();
-  _em_x.clear();
-  _em_x_raw.clear();
-  _em_y.clear();
-  _em_y_raw.clear();
-  _em_z.clear();
-  _em_z_raw.clear();
-  _em_px.clear();
-  _em_px_raw.clear();
-  _em_py.clear();
-  _em_py_raw.clear();
-  _em_pz.clear();
-  _em_pz_raw.clear();
-  _em_pE.clear();
-  _em_pE_unmoved.clear();
-  _em_pT.clear();
-  _em_pTErr.clear();
-  _em_pT_raw.clear();
-  _em_pT_unmoved.clear();
-  _em_p.clear();
-  _em_pErr.clear();
-  _em_p_raw.clear();
-  _em_p_unmoved.clear();
-  _em_pseudorapidity.clear();
-  _em_pseudorapidity_raw.clear();
-  _em_rapidity.clear();
-  _em_theta.clear();
-  _em_phi.clear();
-  _em_phi_raw.clear();
-  _em_chi2.clear();
-  _em_chi2_raw.clear();
-  _em_nDoF.clear();
-  _em_nDoF_raw.clear();
-  _em_crossing.clear();
-  _em_clus_ican.clear();
-  _em_clus_x.clear();
-  _em_clus_y.clear();
-  _em_clus_z.clear();
-  _em_phi_emc.clear();
-  _em_eta_emc.clear();
-  _em_px_emc.clear();
-  _em_py_emc.clear();
-  _em_pz_emc.clear();
-  _em_x_emc.clear();
-  _em_y_emc.clear();
-  _em_z_emc.clear();
-  _emcal_phi.clear();
-  _emcal_eta.clear();
-  _emcal_x.clear();
-  _emcal_y.clear();
-  _emcal_z.clear();
-  _emcal_e.clear();
-  _epem_DCA_2d.clear();
-  _epem_DCA_3d.clear();
-
-  _em_has_truthmatching.clear();
-  _em_true_id.clear();
-  _em_true_px.clear();
-  _em_true_py.clear();
-  _em_true_pz.clear();
-  _em_true_vertex_x.clear();
-  _em_true_vertex_y.clear();
-  _em_true_vertex_z.clear();
-  _em_true_vertex_x_method2.clear();
-  _em_true_vertex_y_method2.clear();
-  _em_true_vertex_z_method2.clear();
-
-  _ep_has_truthmatching.clear();
-  _ep_true_id.clear();
-  _ep_true_px.clear();
-  _ep_true_py.clear();
-  _ep_true_pz.clear();
-  _ep_true_vertex_x.clear();
-  _ep_true_vertex_y.clear();
-  _ep_true_vertex_z.clear();
-  _ep_true_vertex_x_method2.clear();
-  _ep_true_vertex_y_method2.clear();
-  _ep_true_vertex_z_method2.clear();
-
-  _true_gamma_phi.clear();
-  _true_gamma_eta.clear();
-  _true_gamma_px.clear();
-  _true_gamma_py.clear();
-  _true_gamma_pz.clear();
-  _true_gamma_pE.clear();
-  _true_gamma_x.clear();
-  _true_gamma_y.clear();
-  _true_gamma_z.clear();
-  _true_gamma_mother_id.clear();
-  _true_gamma_embedding_id.clear();
-
-  _true_ep_phi.clear();
-  _true_ep_eta.clear();
-  _true_ep_px.clear();
-  _true_ep_py.clear();
-  _true_ep_pz.clear();
-  _true_ep_pE.clear();
-  _true_ep_x.clear();
-  _true_ep_y.clear();
-  _true_ep_z.clear();
-
-  _true_em_phi.clear();
-  _true_em_eta.clear();
-  _true_em_px.clear();
-  _true_em_py.clear();
-  _true_em_pz.clear();
-  _true_em_pE.clear();
-  _true_em_x.clear();
-  _true_em_y.clear();
-  _true_em_z.clear();
-
+  m_columns.reset(kKFPTree);
 }
 
 void TrackToCalo::resetCaloRadius()
@@ -51,12 +51,23 @@
 #include <HepMC/GenVertex.h>  // for GenVertex::particle_iterator
 #pragma GCC diagnostic pop
 
+#include <memory>
 #include <string>
 #include <vector>
 
 #include <TDatabasePDG.h>
 
+#include "AsyncTreeWriter.h"
+#include "CaloGeometryLUT.h"
+#include "ClusterPositionCache.h"
+#include "HelixProjector.h"
+#include "OutputFileOptions.h"
+#include "TreeColumnRegistry.h"
+#include "TruthParticleIndex.h"
+#include "WorkerPool.h"
+
 class PHCompositeNode;
+class TrackSummary;
 class TH1;
 class TH2;
 class TFile;
@@ -83,6 +94,9 @@ class TrackToCalo : public SubsysReco
    */
   int Init(PHCompositeNode *topNode) override;
 
+  /// Called at the start of each run; picks up the tower geometry lookup table of the run.
+  int InitRun(PHCompositeNode *topNode) override;
+
   /** Called for each event.
       This is where you do the real work.
    */
@@ -101,6 +115,7 @@ class TrackToCalo : public SubsysReco
 
   void createBranches();
   void createBranches_KFP();
+  void writeLevelIndices();
 
   void EMcalRadiusUser(bool use) {m_use_emcal_radius = use;}
   void IHcalRadiusUser(bool use) {m_use_ihcal_radius = use;}
@@ -130,12 +145,125 @@ class TrackToCalo : public SubsysReco
   void anaCaloInfo(bool flag = true) {m_doCaloOnly = flag;}
 
   void doSimulation(bool flag = true) {m_doSimulation = flag;}
+
   void setDFNodeName(const std::string &name) { m_df_module_name = name; }
 
   PHG4Particle *getTruthTrack(SvtxTrack *thisTrack);
 
+  /// groups of columns sharing one multiplicity, used to pre-reserve the output buffers
+  enum ColumnCollection
+  {
+    kEventColumns = 0,
+    kVertexColumns,
+    kTpcClusterColumns,
+    kTrackColumns,
+    kTrackClusterColumns,
+    kEMCalColumns,
+    kEMCalTowerColumns,
+    kHCalColumns,
+    kHCalTowerColumns,
+    kCandidateColumns,
+    kCandidateClusterColumns,
+    kTruthColumns,
+    kNColumnCollections
+  };
+  void setColumnReserve(ColumnCollection collection, unsigned int n) {m_column_reserve[collection] = n;}
+
+  /// fill the trees on a background thread with up to depth events in flight; 0 fills in process_event
+  void setOutputQueueDepth(unsigned int depth) {m_writer.setDepth(depth);}
+  /// kRNTuple writes "tree" and "tree_KFP" as RNTuples of the same columns
+  void setOutputFormat(AsyncTreeWriter::OutputFormat format) {m_output_format = format;}
+  /*!
+   * split "tree" into event, track, track_cluster, cluster, emcal, emcal_tower, hcal and hcal_tower
+   * trees; each has one entry per event, carries _runNumber/_eventNumber and is indexed on them.
+   * Every tree but event gets a <name>_index tree with one entry per object, indexed on
+   * (_runNumber, _key = levelKey(event, position in the vectors)); its _entry and _index locate
+   * the object in the level tree.
+   */
+  void setNormalizedOutput(bool normalized) {m_normalized_output = normalized;}
+  /// minor key of the <name>_index trees, e.g. index->GetEntryWithIndex(run, TrackToCalo::levelKey(event, i))
+  static Long64_t levelKey(int event, int position) {return static_cast<Long64_t>(event) * (1LL << 24) + position;}
+  /// output file tuning: compression (ROOT::RCompressionSetting::EAlgorithm, level), basket sizes, TTree::SetAutoFlush/SetAutoSave
+  void setCompression(int algorithm, int level) {m_file_options.setCompression(algorithm, level);}
+  void setBasketSize(const std::string &pattern, int bytes) {m_file_options.setBasketSize(pattern, bytes);}
+  void setAutoFlush(long long value) {m_file_options.setAutoFlush(value);}
+  void setAutoSave(long long value) {m_file_options.setAutoSave(value);}
+  /// run the track loop of anaTrkrInfo on n threads, the calling one included; 0 or 1 keeps it serial, the output is the same
+  void setTrackThreads(unsigned int n) {m_track_threads = n;}
+  /// node written by TrackSummaryMaker; when it is current the seeds, vertices and states are taken from it
+  void setTrackSummaryName(const std::string &name) {m_track_summary_name = name;}
+  /*!
+   * add _track_{x,y,z,phi,eta}_r<radius> columns holding the EMCal states propagated analytically
+   * to radius (cm), e.g. to the shower max or for a radius scan; needs anaCaloInfo, call before Init
+   */
+  void addHelixRadius(float radius);
+  /// solenoid field along z used by the helix propagation, in tesla
+  void setHelixField(float tesla) {m_helix.setField(tesla);}
+  /// compare the helix from the EMCal states with the Acts states at the iHCal and oHCal radii; reported at End
+  void validateHelixProjection(bool validate = true, float tolerance_cm = 0.5) {m_validate_helix = validate; m_helix_tolerance = tolerance_cm;}
+
  private:
   using Decay = std::vector<std::pair<std::pair<int, int>, int>>;
+
+  // one photon conversion candidate, with the daughters in KFParticle container order
+  struct KFPCandidate
+  {
+    KFParticle *mother;
+    KFParticle *daughters[2];
+    SvtxTrack *daughter_tracks[2];
+  };
+  bool buildKFPCandidates();
+  int openOutput(const std::string &name, const std::string &title, unsigned int treeBit, unsigned int collections, TTree *&tree);
+
+  // one track of fillTree_TrackOnly; tracks are evaluated independently and appended to the columns in track map order
+  struct ProjectedState
+  {
+    float phi, eta, px, py, pz, x, y, z;
+  };
+  struct TrackClusterRow
+  {
+    int type;
+    float x, y, z;
+  };
+  struct TrackRow
+  {
+    bool accepted;   // passed the pt and quality cuts: cluster counts and track clusters are written
+    bool passed_ntpc;  // passed the TPC cluster cut: the track columns are written
+    bool projected;  // the states at the origin and the three calorimeter radii are written
+    int id, bc, nc_mvtx, nc_intt, nc_tpc;
+    float quality, vx, vy, vz, dcaxy, dcaz, ptq, px, py, pz, phi, eta, pcax, pcay, pcaz, crossing;
+    std::vector<TrackClusterRow> clusters;
+    ProjectedState states[4];  // origin, EMCal, iHCal, oHCal
+  };
+  // index is the position of the track in trackMap, i.e. in m_track_summary
+  void fillTrackRow(SvtxTrack *thisTrack, std::size_t index, TrackRow &row, bool cache_positions);
+  void appendTrackRow(const TrackRow &row);
+  std::string m_track_summary_name = "TrackSummary";
+  TrackSummary *m_track_summary = nullptr;
+  unsigned int m_track_threads = 0;
+  std::unique_ptr<WorkerPool> m_track_pool;
+  std::vector<SvtxTrack *> m_track_list;
+  std::vector<TrackRow> m_track_rows;
+
+  struct HelixColumns
+  {
+    float radius;
+    std::vector<float> *x, *y, *z, *phi, *eta;
+  };
+  void fillHelixProjections();
+  HelixProjector m_helix;
+  HelixProjector::Points m_helix_points;
+  std::vector<HelixColumns> m_helix_columns;
+  bool m_validate_helix = false;
+  float m_helix_tolerance = 0.5;
+  // per validation radius (iHCal, oHCal): compared tracks, tracks beyond the tolerance, sum and maximum of the distance
+  unsigned long m_helix_checked[2] = {0, 0};
+  unsigned long m_helix_outside[2] = {0, 0};
+  double m_helix_sum_distance[2] = {0, 0};
+  double m_helix_max_distance[2] = {0, 0};
+  std::vector<std::pair<KFParticle *, SvtxTrack *>> m_kfp_entries;
+  std::vector<KFPCandidate> m_kfp_candidates;
+
   float getParticleMass(const int PDGID) { return TDatabasePDG::Instance()->GetParticle(PDGID)->Mass(); }
 
   bool m_use_emcal_radius = false;
@@ -156,294 +284,325 @@ class TrackToCalo : public SubsysReco
   std::string m_KFPCont_name = "KFParticle_Container";
   std::string m_KFPtrackMap_name = "SvtxTrackMap";
 
-  int _runNumber;
-  int _eventNumber;
-  std::vector<int> _vertex_id;
-  std::vector<int> _vertex_crossing;
-  std::vector<int> _vertex_ntracks;
-  std::vector<float> _vertex_x;
-  std::vector<float> _vertex_y;
-  std::vector<float> _vertex_z;
-  std::vector<float> _cluster_x;
-  std::vector<float> _cluster_y;
-  std::vector<float> _cluster_z;
-  std::vector<int> _track_id;
-  std::vector<int> _track_bc;
-  std::vector<float> _track_phi;
-  std::vector<float> _track_eta;
-  std::vector<float> _track_pcax;
-  std::vector<float> _track_pcay;
-  std::vector<float> _track_pcaz;
-  std::vector<float> _track_crossing;
-  std::vector<float> _track_vx;
-  std::vector<float> _track_vy;
-  std::vector<float> _track_vz;
-  std::vector<float> _track_quality;
-  std::vector<float> _track_dcaxy;
-  std::vector<float> _track_dcaz;
-  std::vector<int> _track_nc_mvtx;
-  std::vector<int> _track_nc_intt;
-  std::vector<int> _track_nc_tpc;
-  std::vector<float> _track_ptq;
-  std::vector<float> _track_px;
-  std::vector<float> _track_py;
-  std::vector<float> _track_pz;
-  std::vector<float> _track_phi_origin;
-  std::vector<float> _track_eta_origin;
-  std::vector<float> _track_px_origin;
-  std::vector<float> _track_py_origin;
-  std::vector<float> _track_pz_origin;
-  std::vector<float> _track_x_origin;
-  std::vector<float> _track_y_origin;
-  std::vector<float> _track_z_origin;
-  std::vector<float> _track_phi_emc;
-  std::vector<float> _track_eta_emc;
-  std::vector<float> _track_px_emc;
-  std::vector<float> _track_py_emc;
-  std::vector<float> _track_pz_emc;
-  std::vector<float> _track_x_emc;
-  std::vector<float> _track_y_emc;
-  std::vector<float> _track_z_emc;
-  std::vector<float> _track_phi_ihc;
-  std::vector<float> _track_eta_ihc;
-  std::vector<float> _track_px_ihc;
-  std::vector<float> _track_py_ihc;
-  std::vector<float> _track_pz_ihc;
-  std::vector<float> _track_x_ihc;
-  std::vector<float> _track_y_ihc;
-  std::vector<float> _track_z_ihc;
-  std::vector<float> _track_phi_ohc;
-  std::vector<float> _track_eta_ohc;
-  std::vector<float> _track_px_ohc;
-  std::vector<float> _track_py_ohc;
-  std::vector<float> _track_pz_ohc;
-  std::vector<float> _track_x_ohc;
-  std::vector<float> _track_y_ohc;
-  std::vector<float> _track_z_ohc;
-
-  std::vector<int> _trClus_track_id;
-  std::vector<int> _trClus_type;
-  std::vector<float> _trClus_x;
-  std::vector<float> _trClus_y;
-  std::vector<float> _trClus_z;
-
-  std::vector<int> _emcal_id;
-  std::vector<float> _emcal_phi;
-  std::vector<float> _emcal_eta;
-  std::vector<float> _emcal_x;
-  std::vector<float> _emcal_y;
-  std::vector<float> _emcal_z;
-  std::vector<float> _emcal_e;
-  std::vector<float> _emcal_ecore;
-  std::vector<float> _emcal_chi2;
-  std::vector<float> _emcal_prob;
-  std::vector<int> _emcal_tower_cluster_id;
-  std::vector<float> _emcal_tower_e;
-  std::vector<float> _emcal_tower_phi;
-  std::vector<float> _emcal_tower_eta;
-  std::vector<int> _emcal_tower_status;
-
-  std::vector<int> _hcal_id;
-  std::vector<float> _hcal_phi;
-  std::vector<float> _hcal_eta;
-  std::vector<float> _hcal_x;
-  std::vector<float> _hcal_y;
-  std::vector<float> _hcal_z;
-  std::vector<float> _hcal_e;
-  std::vector<int> _hcal_tower_cluster_id;
-  std::vector<float> _hcal_tower_e;
-  std::vector<float> _hcal_tower_phi;
-  std::vector<float> _hcal_tower_eta;
-  std::vector<int> _hcal_tower_status;
-  std::vector<int> _hcal_tower_io;
-
-  std::vector<float> _mbd_x;
-  std::vector<float> _mbd_y;
-  std::vector<float> _mbd_z;
-
-  std::vector<int> _triggers;
-
-  std::vector<int> _ntracks;
-
-  int _numCan;
-
-  std::vector<float> _gamma_mass;
-  std::vector<float> _gamma_massErr;
-  std::vector<float> _gamma_x;
-  std::vector<float> _gamma_y;
-  std::vector<float> _gamma_z;
-  std::vector<float> _gamma_px;
-  std::vector<float> _gamma_py;
-  std::vector<float> _gamma_pz;
-  std::vector<float> _gamma_pE;
-  std::vector<float> _gamma_pT;
-  std::vector<float> _gamma_pTErr;
-  std::vector<float> _gamma_p;
-  std::vector<float> _gamma_pErr;
-  std::vector<float> _gamma_pseudorapidity;
-  std::vector<float> _gamma_rapidity;
-  std::vector<float> _gamma_theta;
-  std::vector<float> _gamma_phi;
-  std::vector<float> _gamma_chi2;
-  std::vector<float> _gamma_nDoF;
-  std::vector<float> _gamma_vertex_volume;
-  std::vector<float> _gamma_SV_chi2_per_nDoF;
-
-  std::vector<float> _ep_mass;
-  std::vector<float> _ep_x;
-  std::vector<float> _ep_x_raw;
-  std::vector<float> _ep_y;
-  std::vector<float> _ep_y_raw;
-  std::vector<float> _ep_z;
-  std::vector<float> _ep_z_raw;
-  std::vector<float> _ep_px;
-  std::vector<float> _ep_px_raw;
-  std::vector<float> _ep_py;
-  std::vector<float> _ep_py_raw;
-  std::vector<float> _ep_pz;
-  std::vector<float> _ep_pz_raw;
-  std::vector<float> _ep_pE;
-  std::vector<float> _ep_pE_unmoved;
-  std::vector<float> _ep_pT;
-  std::vector<float> _ep_pTErr;
-  std::vector<float> _ep_pT_raw;
-  std::vector<float> _ep_pT_unmoved;
-  std::vector<float> _ep_p;
-  std::vector<float> _ep_pErr;
-  std::vector<float> _ep_p_raw;
-  std::vector<float> _ep_p_unmoved;
-  std::vector<float> _ep_pseudorapidity;
-  std::vector<float> _ep_pseudorapidity_raw;
-  std::vector<float> _ep_rapidity;
-  std::vector<float> _ep_theta;
-  std::vector<float> _ep_phi;
-  std::vector<float> _ep_phi_raw;
-  std::vector<float> _ep_chi2;
-  std::vector<float> _ep_chi2_raw;
-  std::vector<float> _ep_nDoF;
-  std::vector<float> _ep_nDoF_raw;
-  std::vector<float> _ep_crossing;
-  std::vector<int> _ep_clus_ican;
+  enum OutputTree
+  {
+    kMainTree = 1U << 0,
+    kKFPTree = 1U << 1
+  };
+
+  // every output column is declared once below; the registry books the branches and resets them
+  TreeColumnRegistry m_columns;
+  AsyncTreeWriter m_writer{m_columns};
+  AsyncTreeWriter::OutputFormat m_output_format = AsyncTreeWriter::kTTree;
+  OutputFileOptions m_file_options;
+  bool m_normalized_output = false;
+  std::vector<int> m_main_outputs;
+  std::vector<TTree *> m_level_trees;
+  // objects per entry of the normalized trees, written as <name>_index trees in End
+  struct LevelIndex
+  {
+    std::string name;
+    int collection;
+    std::vector<unsigned int> counts;
+  };
+  std::vector<LevelIndex> m_level_indices;
+  std::vector<std::pair<int, int>> m_level_events;
+  int m_kfp_output = -1;
+  unsigned int m_column_reserve[kNColumnCollections] = {16, 64, 65536, 1024, 16384, 1024, 8192, 512, 4096, 64, 4096, 64};
+
+  int &_runNumber = m_columns.addScalar<int>("_runNumber", kMainTree | kKFPTree);
+  int &_eventNumber = m_columns.addScalar<int>("_eventNumber", kMainTree | kKFPTree);
+  std::vector<int> &_vertex_id = m_columns.add<int>("_vertex_id", kVertexColumns, kMainTree);
+  std::vector<int> &_vertex_crossing = m_columns.add<int>("_vertex_crossing", kVertexColumns, kMainTree);
+  std::vector<int> &_vertex_ntracks = m_columns.add<int>("_vertex_ntracks", kVertexColumns, kMainTree);
+  std::vector<float> &_vertex_x = m_columns.add<float>("_vertex_x", kVertexColumns, kMainTree);
+  std::vector<float> &_vertex_y = m_columns.add<float>("_vertex_y", kVertexColumns, kMainTree);
+  std::vector<float> &_vertex_z = m_columns.add<float>("_vertex_z", kVertexColumns, kMainTree);
+  std::vector<float> &_cluster_x = m_columns.add<float>("_cluster_x", kTpcClusterColumns, kMainTree);
+  std::vector<float> &_cluster_y = m_columns.add<float>("_cluster_y", kTpcClusterColumns, kMainTree);
+  std::vector<float> &_cluster_z = m_columns.add<float>("_cluster_z", kTpcClusterColumns, kMainTree);
+  std::vector<int> &_track_id = m_columns.add<int>("_track_id", kTrackColumns, kMainTree);
+  std::vector<int> &_track_bc = m_columns.add<int>("_track_bc", kTrackColumns, kMainTree);
+  std::vector<float> &_track_phi = m_columns.add<float>("_track_phi", kTrackColumns, kMainTree);
+  std::vector<float> &_track_eta = m_columns.add<float>("_track_eta", kTrackColumns, kMainTree);
+  std::vector<float> &_track_pcax = m_columns.add<float>("_track_pcax", kTrackColumns, kMainTree);
+  std::vector<float> &_track_pcay = m_columns.add<float>("_track_pcay", kTrackColumns, kMainTree);
+  std::vector<float> &_track_pcaz = m_columns.add<float>("_track_pcaz", kTrackColumns, kMainTree);
+  std::vector<float> &_track_crossing = m_columns.add<float>("_track_crossing", kTrackColumns, kMainTree);
+  std::vector<float> &_track_vx = m_columns.add<float>("_track_vx", kTrackColumns, kMainTree);
+  std::vector<float> &_track_vy = m_columns.add<float>("_track_vy", kTrackColumns, kMainTree);
+  std::vector<float> &_track_vz = m_columns.add<float>("_track_vz", kTrackColumns, kMainTree);
+  std::vector<float> &_track_quality = m_columns.add<float>("_track_quality", kTrackColumns, kMainTree);
+  std::vector<float> &_track_dcaxy = m_columns.add<float>("_track_dcaxy", kTrackColumns, kMainTree);
+  std::vector<float> &_track_dcaz = m_columns.add<float>("_track_dcaz", kTrackColumns, kMainTree);
+  std::vector<int> &_track_nc_mvtx = m_columns.add<int>("_track_nc_mvtx", kTrackColumns, kMainTree);
+  std::vector<int> &_track_nc_intt = m_columns.add<int>("_track_nc_intt", kTrackColumns, kMainTree);
+  std::vector<int> &_track_nc_tpc = m_columns.add<int>("_track_nc_tpc", kTrackColumns, kMainTree);
+  std::vector<float> &_track_ptq = m_columns.add<float>("_track_ptq", kTrackColumns, kMainTree);
+  std::vector<float> &_track_px = m_columns.add<float>("_track_px", kTrackColumns, kMainTree);
+  std::vector<float> &_track_py = m_columns.add<float>("_track_py", kTrackColumns, kMainTree);
+  std::vector<float> &_track_pz = m_columns.add<float>("_track_pz", kTrackColumns, kMainTree);
+  std::vector<float> &_track_phi_origin = m_columns.add<float>("_track_phi_origin", kTrackColumns, kMainTree);
+  std::vector<float> &_track_eta_origin = m_columns.add<float>("_track_eta_origin", kTrackColumns, kMainTree);
+  std::vector<float> &_track_px_origin = m_columns.add<float>("_track_px_origin", kTrackColumns, kMainTree);
+  std::vector<float> &_track_py_origin = m_columns.add<float>("_track_py_origin", kTrackColumns, kMainTree);
+  std::vector<float> &_track_pz_origin = m_columns.add<float>("_track_pz_origin", kTrackColumns, kMainTree);
+  std::vector<float> &_track_x_origin = m_columns.add<float>("_track_x_origin", kTrackColumns, kMainTree);
+  std::vector<float> &_track_y_origin = m_columns.add<float>("_track_y_origin", kTrackColumns, kMainTree);
+  std::vector<float> &_track_z_origin = m_columns.add<float>("_track_z_origin", kTrackColumns, kMainTree);
+  std::vector<float> &_track_phi_emc = m_columns.add<float>("_track_phi_emc", kTrackColumns, kMainTree);
+  std::vector<float> &_track_eta_emc = m_columns.add<float>("_track_eta_emc", kTrackColumns, kMainTree);
+  std::vector<float> &_track_px_emc = m_columns.add<float>("_track_px_emc", kTrackColumns, kMainTree);
+  std::vector<float> &_track_py_emc = m_columns.add<float>("_track_py_emc", kTrackColumns, kMainTree);
+  std::vector<float> &_track_pz_emc = m_columns.add<float>("_track_pz_emc", kTrackColumns, kMainTree);
+  std::vector<float> &_track_x_emc = m_columns.add<float>("_track_x_emc", kTrackColumns, kMainTree);
+  std::vector<float> &_track_y_emc = m_columns.add<float>("_track_y_emc", kTrackColumns, kMainTree);
+  std::vector<float> &_track_z_emc = m_columns.add<float>("_track_z_emc", kTrackColumns, kMainTree);
+  std::vector<float> &_track_phi_ihc = m_columns.add<float>("_track_phi_ihc", kTrackColumns, kMainTree);
+  std::vector<float> &_track_eta_ihc = m_columns.add<float>("_track_eta_ihc", kTrackColumns, kMainTree);
+  std::vector<float> &_track_px_ihc = m_columns.add<float>("_track_px_ihc", kTrackColumns, kMainTree);
+  std::vector<float> &_track_py_ihc = m_columns.add<float>("_track_py_ihc", kTrackColumns, kMainTree);
+  std::vector<float> &_track_pz_ihc = m_columns.add<float>("_track_pz_ihc", kTrackColumns, kMainTree);
+  std::vector<float> &_track_x_ihc = m_columns.add<float>("_track_x_ihc", kTrackColumns, kMainTree);
+  std::vector<float> &_track_y_ihc = m_columns.add<float>("_track_y_ihc", kTrackColumns, kMainTree);
+  std::vector<float> &_track_z_ihc = m_columns.add<float>("_track_z_ihc", kTrackColumns, kMainTree);
+  std::vector<float> &_track_phi_ohc = m_columns.add<float>("_track_phi_ohc", kTrackColumns, kMainTree);
+  std::vector<float> &_track_eta_ohc = m_columns.add<float>("_track_eta_ohc", kTrackColumns, kMainTree);
+  std::vector<float> &_track_px_ohc = m_columns.add<float>("_track_px_ohc", kTrackColumns, kMainTree);
+  std::vector<float> &_track_py_ohc = m_columns.add<float>("_track_py_ohc", kTrackColumns, kMainTree);
+  std::vector<float> &_track_pz_ohc = m_columns.add<float>("_track_pz_ohc", kTrackColumns, kMainTree);
+  std::vector<float> &_track_x_ohc = m_columns.add<float>("_track_x_ohc", kTrackColumns, kMainTree);
+  std::vector<float> &_track_y_ohc = m_columns.add<float>("_track_y_ohc", kTrackColumns, kMainTree);
+  std::vector<float> &_track_z_ohc = m_columns.add<float>("_track_z_ohc", kTrackColumns, kMainTree);
+
+  std::vector<int> &_trClus_track_id = m_columns.add<int>("_trClus_track_id", kTrackClusterColumns, kMainTree);
+  std::vector<int> &_trClus_type = m_columns.add<int>("_trClus_type", kTrackClusterColumns, kMainTree);
+  std::vector<float> &_trClus_x = m_columns.add<float>("_trClus_x", kTrackClusterColumns, kMainTree);
+  std::vector<float> &_trClus_y = m_columns.add<float>("_trClus_y", kTrackClusterColumns, kMainTree);
+  std::vector<float> &_trClus_z = m_columns.add<float>("_trClus_z", kTrackClusterColumns, kMainTree);
+
+  std::vector<int> &_emcal_id = m_columns.add<int>("_emcal_id", kEMCalColumns, kMainTree);
+  std::vector<float> &_emcal_phi = m_columns.add<float>("_emcal_phi", kEMCalColumns, kMainTree);
+  std::vector<float> &_emcal_eta = m_columns.add<float>("_emcal_eta", kEMCalColumns, kMainTree);
+  std::vector<float> &_emcal_x = m_columns.add<float>("_emcal_x", kEMCalColumns, kMainTree);
+  std::vector<float> &_emcal_y = m_columns.add<float>("_emcal_y", kEMCalColumns, kMainTree);
+  std::vector<float> &_emcal_z = m_columns.add<float>("_emcal_z", kEMCalColumns, kMainTree);
+  std::vector<float> &_emcal_e = m_columns.add<float>("_emcal_e", kEMCalColumns, kMainTree);
+  // same branches in tree_KFP; own buffers, since committing one output empties its vector columns
+  std::vector<float> &_kfp_emcal_phi = m_columns.add<float>("_emcal_phi", kEMCalColumns, kKFPTree);
+  std::vector<float> &_kfp_emcal_eta = m_columns.add<float>("_emcal_eta", kEMCalColumns, kKFPTree);
+  std::vector<float> &_kfp_emcal_x = m_columns.add<float>("_emcal_x", kEMCalColumns, kKFPTree);
+  std::vector<float> &_kfp_emcal_y = m_columns.add<float>("_emcal_y", kEMCalColumns, kKFPTree);
+  std::vector<float> &_kfp_emcal_z = m_columns.add<float>("_emcal_z", kEMCalColumns, kKFPTree);
+  std::vector<float> &_kfp_emcal_e = m_columns.add<float>("_emcal_e", kEMCalColumns, kKFPTree);
+  std::vector<float> &_emcal_ecore = m_columns.add<float>("_emcal_ecore", kEMCalColumns, kMainTree);
+  std::vector<float> &_emcal_chi2 = m_columns.add<float>("_emcal_chi2", kEMCalColumns, kMainTree);
+  std::vector<float> &_emcal_prob = m_columns.add<float>("_emcal_prob", kEMCalColumns, kMainTree);
+  std::vector<int> &_emcal_tower_cluster_id = m_columns.add<int>("_emcal_tower_cluster_id", kEMCalTowerColumns, kMainTree);
+  std::vector<float> &_emcal_tower_e = m_columns.add<float>("_emcal_tower_e", kEMCalTowerColumns, kMainTree);
+  std::vector<float> &_emcal_tower_phi = m_columns.add<float>("_emcal_tower_phi", kEMCalTowerColumns, kMainTree);
+  std::vector<float> &_emcal_tower_eta = m_columns.add<float>("_emcal_tower_eta", kEMCalTowerColumns, kMainTree);
+  std::vector<int> &_emcal_tower_status = m_columns.add<int>("_emcal_tower_status", kEMCalTowerColumns, kMainTree);
+
+  std::vector<int> &_hcal_id = m_columns.add<int>("_hcal_id", kHCalColumns, kMainTree);
+  std::vector<float> &_hcal_phi = m_columns.add<float>("_hcal_phi", kHCalColumns, kMainTree);
+  std::vector<float> &_hcal_eta = m_columns.add<float>("_hcal_eta", kHCalColumns, kMainTree);
+  std::vector<float> &_hcal_x = m_columns.add<float>("_hcal_x", kHCalColumns, kMainTree);
+  std::vector<float> &_hcal_y = m_columns.add<float>("_hcal_y", kHCalColumns, kMainTree);
+  std::vector<float> &_hcal_z = m_columns.add<float>("_hcal_z", kHCalColumns, kMainTree);
+  std::vector<float> &_hcal_e = m_columns.add<float>("_hcal_e", kHCalColumns, kMainTree);
+  std::vector<int> &_hcal_tower_cluster_id = m_columns.add<int>("_hcal_tower_cluster_id", kHCalTowerColumns, kMainTree);
+  std::vector<float> &_hcal_tower_e = m_columns.add<float>("_hcal_tower_e", kHCalTowerColumns, kMainTree);
+  std::vector<float> &_hcal_tower_phi = m_columns.add<float>("_hcal_tower_phi", kHCalTowerColumns, kMainTree);
+  std::vector<float> &_hcal_tower_eta = m_columns.add<float>("_hcal_tower_eta", kHCalTowerColumns, kMainTree);
+  std::vector<int> &_hcal_tower_status = m_columns.add<int>("_hcal_tower_status", kHCalTowerColumns, kMainTree);
+  std::vector<int> &_hcal_tower_io = m_columns.add<int>("_hcal_tower_io", kHCalTowerColumns, kMainTree);
+
+  std::vector<float> &_mbd_x = m_columns.add<float>("_mbd_x", kEventColumns, kMainTree);
+  std::vector<float> &_mbd_y = m_columns.add<float>("_mbd_y", kEventColumns, kMainTree);
+  std::vector<float> &_mbd_z = m_columns.add<float>("_mbd_z", kEventColumns, kMainTree);
+
+  std::vector<int> &_triggers = m_columns.add<int>("_triggers", kEventColumns, kMainTree);
+
+  std::vector<int> &_ntracks = m_columns.add<int>("_ntracks", kEventColumns, kMainTree);
+
+  int &_numCan = m_columns.addScalar<int>("_numCan", kKFPTree);
+
+  std::vector<float> &_gamma_mass = m_columns.add<float>("_gamma_mass", kCandidateColumns, kKFPTree);
+  std::vector<float> &_gamma_massErr = m_columns.add<float>("_gamma_massErr", kCandidateColumns, kKFPTree);
+  std::vector<float> &_gamma_x = m_columns.add<float>("_gamma_x", kCandidateColumns, kKFPTree);
+  std::vector<float> &_gamma_y = m_columns.add<float>("_gamma_y", kCandidateColumns, kKFPTree);
+  std::vector<float> &_gamma_z = m_columns.add<float>("_gamma_z", kCandidateColumns, kKFPTree);
+  std::vector<float> &_gamma_px = m_columns.add<float>("_gamma_px", kCandidateColumns, kKFPTree);
+  std::vector<float> &_gamma_py = m_columns.add<float>("_gamma_py", kCandidateColumns, kKFPTree);
+  std::vector<float> &_gamma_pz = m_columns.add<float>("_gamma_pz", kCandidateColumns, kKFPTree);
+  std::vector<float> &_gamma_pE = m_columns.add<float>("_gamma_pE", kCandidateColumns, kKFPTree);
+  std::vector<float> &_gamma_pT = m_columns.add<float>("_gamma_pT", kCandidateColumns, kKFPTree);
+  std::vector<float> &_gamma_pTErr = m_columns.add<float>("_gamma_pTErr", kCandidateColumns, kKFPTree);
+  std::vector<float> &_gamma_p = m_columns.add<float>("_gamma_p", kCandidateColumns, kKFPTree);
+  std::vector<float> &_gamma_pErr = m_columns.add<float>("_gamma_pErr", kCandidateColumns, kKFPTree);
+  std::vector<float> &_gamma_pseudorapidity = m_columns.add<float>("_gamma_pseudorapidity", kCandidateColumns, kKFPTree);
+  std::vector<float> &_gamma_rapidity = m_columns.add<float>("_gamma_rapidity", kCandidateColumns, kKFPTree);
+  std::vector<float> &_gamma_theta = m_columns.add<float>("_gamma_theta", kCandidateColumns, kKFPTree);
+  std::vector<float> &_gamma_phi = m_columns.add<float>("_gamma_phi", kCandidateColumns, kKFPTree);
+  std::vector<float> &_gamma_chi2 = m_columns.add<float>("_gamma_chi2", kCandidateColumns, kKFPTree);
+  std::vector<float> &_gamma_nDoF = m_columns.add<float>("_gamma_nDoF", kCandidateColumns, kKFPTree);
+  std::vector<float> &_gamma_vertex_volume = m_columns.add<float>("_gamma_vertex_volume", kCandidateColumns, kKFPTree);
+  std::vector<float> &_gamma_SV_chi2_per_nDoF = m_columns.add<float>("_gamma_SV_chi2_per_nDoF", kCandidateColumns, kKFPTree);
+
+  std::vector<float> &_ep_mass = m_columns.add<float>("_ep_mass", kCandidateColumns, kKFPTree);
+  std::vector<float> &_ep_x = m_columns.add<float>("_ep_x", kCandidateColumns, kKFPTree);
+  std::vector<float> &_ep_x_raw = m_columns.add<float>("_ep_x_raw", kCandidateColumns, kKFPTree);
+  std::vector<float> &_ep_y = m_columns.add<float>("_ep_y", kCandidateColumns, kKFPTree);
+  std::vector<float> &_ep_y_raw = m_columns.add<float>("_ep_y_raw", kCandidateColumns, kKFPTree);
+  std::vector<float> &_ep_z = m_columns.add<float>("_ep_z", kCandidateColumns, kKFPTree);
+  std::vector<float> &_ep_z_raw = m_columns.add<float>("_ep_z_raw", kCandidateColumns, kKFPTree);
+  std::vector<float> &_ep_px = m_columns.add<float>("_ep_px", kCandidateColumns, kKFPTree);
+  std::vector<float> &_ep_px_raw = m_columns.add<float>("_ep_px_raw", kCandidateColumns, kKFPTree);
+  std::vector<float> &_ep_py = m_columns.add<float>("_ep_py", kCandidateColumns, kKFPTree);
+  std::vector<float> &_ep_py_raw = m_columns.add<float>("_ep_py_raw", kCandidateColumns, kKFPTree);
+  std::vector<float> &_ep_pz = m_columns.add<float>("_ep_pz", kCandidateColumns, kKFPTree);
+  std::vector<float> &_ep_pz_raw = m_columns.add<float>("_ep_pz_raw", kCandidateColumns, kKFPTree);
+  std::vector<float> &_ep_pE = m_columns.add<float>("_ep_pE", kCandidateColumns, kKFPTree);
+  std::vector<float> &_ep_pE_unmoved = m_columns.add<float>("_ep_pE_unmoved", kCandidateColumns, kKFPTree);
+  std::vector<float> &_ep_pT = m_columns.add<float>("_ep_pT", kCandidateColumns, kKFPTree);
+  std::vector<float> &_ep_pTErr = m_columns.add<float>("_ep_pTErr", kCandidateColumns, kKFPTree);
+  std::vector<float> &_ep_pT_raw = m_columns.add<float>("_ep_pT_raw", kCandidateColumns, kKFPTree);
+  std::vector<float> &_ep_pT_unmoved = m_columns.add<float>("_ep_pT_unmoved", kCandidateColumns, kKFPTree);
+  std::vector<float> &_ep_p = m_columns.add<float>("_ep_p", kCandidateColumns, kKFPTree);
+  std::vector<float> &_ep_pErr = m_columns.add<float>("_ep_pErr", kCandidateColumns, kKFPTree);
+  std::vector<float> &_ep_p_raw = m_columns.add<float>("_ep_p_raw", kCandidateColumns, kKFPTree);
+  std::vector<float> &_ep_p_unmoved = m_columns.add<float>("_ep_p_unmoved", kCandidateColumns, kKFPTree);
+  std::vector<float> &_ep_pseudorapidity = m_columns.add<float>("_ep_pseudorapidity", kCandidateColumns, kKFPTree);
+  std::vector<float> &_ep_pseudorapidity_raw = m_columns.add<float>("_ep_pseudorapidity_raw", kCandidateColumns, kKFPTree);
+  std::vector<float> &_ep_rapidity = m_columns.add<float>("_ep_rapidity", kCandidateColumns, kKFPTree);
+  std::vector<float> &_ep_theta = m_columns.add<float>("_ep_theta", kCandidateColumns, kKFPTree);
+  std::vector<float> &_ep_phi = m_columns.add<float>("_ep_phi", kCandidateColumns, kKFPTree);
+  std::vector<float> &_ep_phi_raw = m_columns.add<float>("_ep_phi_raw", kCandidateColumns, kKFPTree);
+  std::vector<float> &_ep_chi2 = m_columns.add<float>("_ep_chi2", kCandidateColumns, kKFPTree);
+  std::vector<float> &_ep_chi2_raw = m_columns.add<float>("_ep_chi2_raw", kCandidateColumns, kKFPTree);
+  std::vector<float> &_ep_nDoF = m_columns.add<float>("_ep_nDoF", kCandidateColumns, kKFPTree);
+  std::vector<float> &_ep_nDoF_raw = m_columns.add<float>("_ep_nDoF_raw", kCandidateColumns, kKFPTree);
+  std::vector<float> &_ep_crossing = m_columns.add<float>("_ep_crossing", kCandidateColumns, kKFPTree);
+  std::vector<int> &_ep_clus_ican = m_columns.add<int>("_ep_clus_ican", kCandidateClusterColumns, kKFPTree);
   //std::vector<int> _ep_clus_type;
-  std::vector<float> _ep_clus_x;
-  std::vector<float> _ep_clus_y;
-  std::vector<float> _ep_clus_z;
-  std::vector<int> _ep_has_truthmatching;
-  std::vector<int> _ep_true_id;
-  std::vector<float> _ep_true_px;
-  std::vector<float> _ep_true_py;
-  std::vector<float> _ep_true_pz;
-  std::vector<float> _ep_true_vertex_x;
-  std::vector<float> _ep_true_vertex_y;
-  std::vector<float> _ep_true_vertex_z;
-  std::vector<float> _ep_true_vertex_x_method2;
-  std::vector<float> _ep_true_vertex_y_method2;
-  std::vector<float> _ep_true_vertex_z_method2;
-
-  std::vector<float> _em_mass;
-  std::vector<float> _em_x;
-  std::vector<float> _em_x_raw;
-  std::vector<float> _em_y;
-  std::vector<float> _em_y_raw;
-  std::vector<float> _em_z;
-  std::vector<float> _em_z_raw;
-  std::vector<float> _em_px;
-  std::vector<float> _em_px_raw;
-  std::vector<float> _em_py;
-  std::vector<float> _em_py_raw;
-  std::vector<float> _em_pz;
-  std::vector<float> _em_pz_raw;
-  std::vector<float> _em_pE;
-  std::vector<float> _em_pE_unmoved;
-  std::vector<float> _em_pT;
-  std::vector<float> _em_pTErr;
-  std::vector<float> _em_pT_raw;
-  std::vector<float> _em_pT_unmoved;
-  std::vector<float> _em_p;
-  std::vector<float> _em_pErr;
-  std::vector<float> _em_p_raw;
-  std::vector<float> _em_p_unmoved;
-  std::vector<float> _em_pseudorapidity;
-  std::vector<float> _em_pseudorapidity_raw;
-  std::vector<float> _em_rapidity;
-  std::vector<float> _em_theta;
-  std::vector<float> _em_phi;
-  std::vector<float> _em_phi_raw;
-  std::vector<float> _em_chi2;
-  std::vector<float> _em_chi2_raw;
-  std::vector<float> _em_nDoF;
-  std::vector<float> _em_nDoF_raw;
-  std::vector<float> _em_crossing;
-  std::vector<int> _em_clus_ican;
+  std::vector<float> &_ep_clus_x = m_columns.add<float>("_ep_clus_x", kCandidateClusterColumns, kKFPTree);
+  std::vector<float> &_ep_clus_y = m_columns.add<float>("_ep_clus_y", kCandidateClusterColumns, kKFPTree);
+  std::vector<float> &_ep_clus_z = m_columns.add<float>("_ep_clus_z", kCandidateClusterColumns, kKFPTree);
+  std::vector<float> &_ep_phi_emc = m_columns.add<float>("_ep_phi_emc", kCandidateColumns, kKFPTree);
+  std::vector<float> &_ep_eta_emc = m_columns.add<float>("_ep_eta_emc", kCandidateColumns, kKFPTree);
+  std::vector<float> &_ep_px_emc = m_columns.add<float>("_ep_px_emc", kCandidateColumns, kKFPTree);
+  std::vector<float> &_ep_py_emc = m_columns.add<float>("_ep_py_emc", kCandidateColumns, kKFPTree);
+  std::vector<float> &_ep_pz_emc = m_columns.add<float>("_ep_pz_emc", kCandidateColumns, kKFPTree);
+  std::vector<float> &_ep_x_emc = m_columns.add<float>("_ep_x_emc", kCandidateColumns, kKFPTree);
+  std::vector<float> &_ep_y_emc = m_columns.add<float>("_ep_y_emc", kCandidateColumns, kKFPTree);
+  std::vector<float> &_ep_z_emc = m_columns.add<float>("_ep_z_emc", kCandidateColumns, kKFPTree);
+  std::vector<int> &_ep_has_truthmatching = m_columns.add<int>("_ep_has_truthmatching", kCandidateColumns, kKFPTree);
+  std::vector<int> &_ep_true_id = m_columns.add<int>("_ep_true_id", kCandidateColumns, kKFPTree);
+  std::vector<float> &_ep_true_px = m_columns.add<float>("_ep_true_px", kCandidateColumns, kKFPTree);
+  std::vector<float> &_ep_true_py = m_columns.add<float>("_ep_true_py", kCandidateColumns, kKFPTree);
+  std::vector<float> &_ep_true_pz = m_columns.add<float>("_ep_true_pz", kCandidateColumns, kKFPTree);
+  std::vector<float> &_ep_true_vertex_x = m_columns.add<float>("_ep_true_vertex_x", kCandidateColumns, kKFPTree);
+  std::vector<float> &_ep_true_vertex_y = m_columns.add<float>("_ep_true_vertex_y", kCandidateColumns, kKFPTree);
+  std::vector<float> &_ep_true_vertex_z = m_columns.add<float>("_ep_true_vertex_z", kCandidateColumns, kKFPTree);
+  std::vector<float> &_ep_true_vertex_x_method2 = m_columns.add<float>("_ep_true_vertex_x_method2", kCandidateColumns, kKFPTree);
+  std::vector<float> &_ep_true_vertex_y_method2 = m_columns.add<float>("_ep_true_vertex_y_method2", kCandidateColumns, kKFPTree);
+  std::vector<float> &_ep_true_vertex_z_method2 = m_columns.add<float>("_ep_true_vertex_z_method2", kCandidateColumns, kKFPTree);
+
+  std::vector<float> &_em_mass = m_columns.add<float>("_em_mass", kCandidateColumns, kKFPTree);
+  std::vector<float> &_em_x = m_columns.add<float>("_em_x", kCandidateColumns, kKFPTree);
+  std::vector<float> &_em_x_raw = m_columns.add<float>("_em_x_raw", kCandidateColumns, kKFPTree);
+  std::vector<float> &_em_y = m_columns.add<float>("_em_y", kCandidateColumns, kKFPTree);
+  std::vector<float> &_em_y_raw = m_columns.add<float>("_em_y_raw", kCandidateColumns, kKFPTree);
+  std::vector<float> &_em_z = m_columns.add<float>("_em_z", kCandidateColumns, kKFPTree);
+  std::vector<float> &_em_z_raw = m_columns.add<float>("_em_z_raw", kCandidateColumns, kKFPTree);
+  std::vector<float> &_em_px = m_columns.add<float>("_em_px", kCandidateColumns, kKFPTree);
+  std::vector<float> &_em_px_raw = m_columns.add<float>("_em_px_raw", kCandidateColumns, kKFPTree);
+  std::vector<float> &_em_py = m_columns.add<float>("_em_py", kCandidateColumns, kKFPTree);
+  std::vector<float> &_em_py_raw = m_columns.add<float>("_em_py_raw", kCandidateColumns, kKFPTree);
+  std::vector<float> &_em_pz = m_columns.add<float>("_em_pz", kCandidateColumns, kKFPTree);
+  std::vector<float> &_em_pz_raw = m_columns.add<float>("_em_pz_raw", kCandidateColumns, kKFPTree);
+  std::vector<float> &_em_pE = m_columns.add<float>("_em_pE", kCandidateColumns, kKFPTree);
+  std::vector<float> &_em_pE_unmoved = m_columns.add<float>("_em_pE_unmoved", kCandidateColumns, kKFPTree);
+  std::vector<float> &_em_pT = m_columns.add<float>("_em_pT", kCandidateColumns, kKFPTree);
+  std::vector<float> &_em_pTErr = m_columns.add<float>("_em_pTErr", kCandidateColumns, kKFPTree);
+  std::vector<float> &_em_pT_raw = m_columns.add<float>("_em_pT_raw", kCandidateColumns, kKFPTree);
+  std::vector<float> &_em_pT_unmoved = m_columns.add<float>("_em_pT_unmoved", kCandidateColumns, kKFPTree);
+  std::vector<float> &_em_p = m_columns.add<float>("_em_p", kCandidateColumns, kKFPTree);
+  std::vector<float> &_em_pErr = m_columns.add<float>("_em_pErr", kCandidateColumns, kKFPTree);
+  std::vector<float> &_em_p_raw = m_columns.add<float>("_em_p_raw", kCandidateColumns, kKFPTree);
+  std::vector<float> &_em_p_unmoved = m_columns.add<float>("_em_p_unmoved", kCandidateColumns, kKFPTree);
+  std::vector<float> &_em_pseudorapidity = m_columns.add<float>("_em_pseudorapidity", kCandidateColumns, kKFPTree);
+  std::vector<float> &_em_pseudorapidity_raw = m_columns.add<float>("_em_pseudorapidity_raw", kCandidateColumns, kKFPTree);
+  std::vector<float> &_em_rapidity = m_columns.add<float>("_em_rapidity", kCandidateColumns, kKFPTree);
+  std::vector<float> &_em_theta = m_columns.add<float>("_em_theta", kCandidateColumns, kKFPTree);
+  std::vector<float> &_em_phi = m_columns.add<float>("_em_phi", kCandidateColumns, kKFPTree);
+  std::vector<float> &_em_phi_raw = m_columns.add<float>("_em_phi_raw", kCandidateColumns, kKFPTree);
+  std::vector<float> &_em_chi2 = m_columns.add<float>("_em_chi2", kCandidateColumns, kKFPTree);
+  std::vector<float> &_em_chi2_raw = m_columns.add<float>("_em_chi2_raw", kCandidateColumns, kKFPTree);
+  std::vector<float> &_em_nDoF = m_columns.add<float>("_em_nDoF", kCandidateColumns, kKFPTree);
+  std::vector<float> &_em_nDoF_raw = m_columns.add<float>("_em_nDoF_raw", kCandidateColumns, kKFPTree);
+  std::vector<float> &_em_crossing = m_columns.add<float>("_em_crossing", kCandidateColumns, kKFPTree);
+  std::vector<int> &_em_clus_ican = m_columns.add<int>("_em_clus_ican", kCandidateClusterColumns, kKFPTree);
   //std::vector<int> _em_clus_type;
-  std::vector<float> _em_clus_x;
-  std::vector<float> _em_clus_y;
-  std::vector<float> _em_clus_z;
-  std::vector<int> _em_has_truthmatching;
-  std::vector<int> _em_true_id;
-  std::vector<float> _em_true_px;
-  std::vector<float> _em_true_py;
-  std::vector<float> _em_true_pz;
-  std::vector<float> _em_true_vertex_x;
-  std::vector<float> _em_true_vertex_y;
-  std::vector<float> _em_true_vertex_z;
-  std::vector<float> _em_true_vertex_x_method2;
-  std::vector<float> _em_true_vertex_y_method2;
-  std::vector<float> _em_true_vertex_z_method2;
-
-  std::vector<float> _ep_phi_emc;
-  std::vector<float> _ep_eta_emc;
-  std::vector<float> _ep_px_emc;
-  std::vector<float> _ep_py_emc;
-  std::vector<float> _ep_pz_emc;
-  std::vector<float> _ep_x_emc;
-  std::vector<float> _ep_y_emc;
-  std::vector<float> _ep_z_emc;
-
-  std::vector<float> _em_phi_emc;
-  std::vector<float> _em_eta_emc;
-  std::vector<float> _em_px_emc;
-  std::vector<float> _em_py_emc;
-  std::vector<float> _em_pz_emc;
-  std::vector<float> _em_x_emc;
-  std::vector<float> _em_y_emc;
-  std::vector<float> _em_z_emc;
-
-  std::vector<float> _epem_DCA_2d;
-  std::vector<float> _epem_DCA_3d;
-
-  int _true_numCan;
-  std::vector<float> _true_gamma_phi;
-  std::vector<float> _true_gamma_eta;
-  std::vector<float> _true_gamma_px;
-  std::vector<float> _true_gamma_py;
-  std::vector<float> _true_gamma_pz;
-  std::vector<float> _true_gamma_pE;
-  std::vector<float> _true_gamma_x;
-  std::vector<float> _true_gamma_y;
-  std::vector<float> _true_gamma_z;
-  std::vector<int> _true_gamma_mother_id;
-  std::vector<int> _true_gamma_embedding_id;
-
-  std::vector<float> _true_ep_phi;
-  std::vector<float> _true_ep_eta;
-  std::vector<float> _true_ep_px;
-  std::vector<float> _true_ep_py;
-  std::vector<float> _true_ep_pz;
-  std::vector<float> _true_ep_pE;
-  std::vector<float> _true_ep_x;
-  std::vector<float> _true_ep_y;
-  std::vector<float> _true_ep_z;
-
-  std::vector<float> _true_em_phi;
-  std::vector<float> _true_em_eta;
-  std::vector<float> _true_em_px;
-  std::vector<float> _true_em_py;
-  std::vector<float> _true_em_pz;
-  std::vector<float> _true_em_pE;
-  std::vector<float> _true_em_x;
-  std::vector<float> _true_em_y;
-  std::vector<float> _true_em_z;
+  std::vector<float> &_em_clus_x = m_columns.add<float>("_em_clus_x", kCandidateClusterColumns, kKFPTree);
+  std::vector<float> &_em_clus_y = m_columns.add<float>("_em_clus_y", kCandidateClusterColumns, kKFPTree);
+  std::vector<float> &_em_clus_z = m_columns.add<float>("_em_clus_z", kCandidateClusterColumns, kKFPTree);
+  std::vector<float> &_em_phi_emc = m_columns.add<float>("_em_phi_emc", kCandidateColumns, kKFPTree);
+  std::vector<float> &_em_eta_emc = m_columns.add<float>("_em_eta_emc", kCandidateColumns, kKFPTree);
+  std::vector<float> &_em_px_emc = m_columns.add<float>("_em_px_emc", kCandidateColumns, kKFPTree);
+  std::vector<float> &_em_py_emc = m_columns.add<float>("_em_py_emc", kCandidateColumns, kKFPTree);
+  std::vector<float> &_em_pz_emc = m_columns.add<float>("_em_pz_emc", kCandidateColumns, kKFPTree);
+  std::vector<float> &_em_x_emc = m_columns.add<float>("_em_x_emc", kCandidateColumns, kKFPTree);
+  std::vector<float> &_em_y_emc = m_columns.add<float>("_em_y_emc", kCandidateColumns, kKFPTree);
+  std::vector<float> &_em_z_emc = m_columns.add<float>("_em_z_emc", kCandidateColumns, kKFPTree);
+  std::vector<int> &_em_has_truthmatching = m_columns.add<int>("_em_has_truthmatching", kCandidateColumns, kKFPTree);
+  std::vector<int> &_em_true_id = m_columns.add<int>("_em_true_id", kCandidateColumns, kKFPTree);
+  std::vector<float> &_em_true_px = m_columns.add<float>("_em_true_px", kCandidateColumns, kKFPTree);
+  std::vector<float> &_em_true_py = m_columns.add<float>("_em_true_py", kCandidateColumns, kKFPTree);
+  std::vector<float> &_em_true_pz = m_columns.add<float>("_em_true_pz", kCandidateColumns, kKFPTree);
+  std::vector<float> &_em_true_vertex_x = m_columns.add<float>("_em_true_vertex_x", kCandidateColumns, kKFPTree);
+  std::vector<float> &_em_true_vertex_y = m_columns.add<float>("_em_true_vertex_y", kCandidateColumns, kKFPTree);
+  std::vector<float> &_em_true_vertex_z = m_columns.add<float>("_em_true_vertex_z", kCandidateColumns, kKFPTree);
+  std::vector<float> &_em_true_vertex_x_method2 = m_columns.add<float>("_em_true_vertex_x_method2", kCandidateColumns, kKFPTree);
+  std::vector<float> &_em_true_vertex_y_method2 = m_columns.add<float>("_em_true_vertex_y_method2", kCandidateColumns, kKFPTree);
+  std::vector<float> &_em_true_vertex_z_method2 = m_columns.add<float>("_em_true_vertex_z_method2", kCandidateColumns, kKFPTree);
+
+  std::vector<float> &_epem_DCA_2d = m_columns.add<float>("_epem_DCA_2d", kCandidateColumns, kKFPTree);
+  std::vector<float> &_epem_DCA_3d = m_columns.add<float>("_epem_DCA_3d", kCandidateColumns, kKFPTree);
+
+  int &_true_numCan = m_columns.addScalar<int>("_true_numCan", kKFPTree);
+  std::vector<float> &_true_gamma_phi = m_columns.add<float>("_true_gamma_phi", kTruthColumns, kKFPTree);
+  std::vector<float> &_true_gamma_eta = m_columns.add<float>("_true_gamma_eta", kTruthColumns, kKFPTree);
+  std::vector<float> &_true_gamma_px = m_columns.add<float>("_true_gamma_px", kTruthColumns, kKFPTree);
+  std::vector<float> &_true_gamma_py = m_columns.add<float>("_true_gamma_py", kTruthColumns, kKFPTree);
+  std::vector<float> &_true_gamma_pz = m_columns.add<float>("_true_gamma_pz", kTruthColumns, kKFPTree);
+  std::vector<float> &_true_gamma_pE = m_columns.add<float>("_true_gamma_pE", kTruthColumns, kKFPTree);
+  std::vector<float> &_true_gamma_x = m_columns.add<float>("_true_gamma_x", kTruthColumns, kKFPTree);
+  std::vector<float> &_true_gamma_y = m_columns.add<float>("_true_gamma_y", kTruthColumns, kKFPTree);
+  std::vector<float> &_true_gamma_z = m_columns.add<float>("_true_gamma_z", kTruthColumns, kKFPTree);
+  std::vector<int> &_true_gamma_mother_id = m_columns.add<int>("_true_gamma_mother_id", kTruthColumns, kKFPTree);
+  std::vector<int> &_true_gamma_embedding_id = m_columns.add<int>("_true_gamma_embedding_id", kTruthColumns, kKFPTree);
+
+  std::vector<float> &_true_ep_phi = m_columns.add<float>("_true_ep_phi", kTruthColumns, kKFPTree);
+  std::vector<float> &_true_ep_eta = m_columns.add<float>("_true_ep_eta", kTruthColumns, kKFPTree);
+  std::vector<float> &_true_ep_px = m_columns.add<float>("_true_ep_px", kTruthColumns, kKFPTree);
+  std::vector<float> &_true_ep_py = m_columns.add<float>("_true_ep_py", kTruthColumns, kKFPTree);
+  std::vector<float> &_true_ep_pz = m_columns.add<float>("_true_ep_pz", kTruthColumns, kKFPTree);
+  std::vector<float> &_true_ep_pE = m_columns.add<float>("_true_ep_pE", kTruthColumns, kKFPTree);
+  std::vector<float> &_true_ep_x = m_columns.add<float>("_true_ep_x", kTruthColumns, kKFPTree);
+  std::vector<float> &_true_ep_y = m_columns.add<float>("_true_ep_y", kTruthColumns, kKFPTree);
+  std::vector<float> &_true_ep_z = m_columns.add<float>("_true_ep_z", kTruthColumns, kKFPTree);
+
+  std::vector<float> &_true_em_phi = m_columns.add<float>("_true_em_phi", kTruthColumns, kKFPTree);
+  std::vector<float> &_true_em_eta = m_columns.add<float>("_true_em_eta", kTruthColumns, kKFPTree);
+  std::vector<float> &_true_em_px = m_columns.add<float>("_true_em_px", kTruthColumns, kKFPTree);
+  std::vector<float> &_true_em_py = m_columns.add<float>("_true_em_py", kTruthColumns, kKFPTree);
+  std::vector<float> &_true_em_pz = m_columns.add<float>("_true_em_pz", kTruthColumns, kKFPTree);
+  std::vector<float> &_true_em_pE = m_columns.add<float>("_true_em_pE", kTruthColumns, kKFPTree);
+  std::vector<float> &_true_em_x = m_columns.add<float>("_true_em_x", kTruthColumns, kKFPTree);
+  std::vector<float> &_true_em_y = m_columns.add<float>("_true_em_y", kTruthColumns, kKFPTree);
+  std::vector<float> &_true_em_z = m_columns.add<float>("_true_em_z", kTruthColumns, kKFPTree);
 
   GlobalVertexMap *vertexmap = nullptr;
   SvtxVertexMap *vertexMap = nullptr;
@@ -463,6 +622,7 @@ class TrackToCalo : public SubsysReco
   RawTowerGeomContainer *EMCalGeo = nullptr;
   RawTowerGeomContainer *IHCalGeo = nullptr;
   RawTowerGeomContainer *OHCalGeo = nullptr;
+  CaloGeometryLUT *m_calo_lut = nullptr;
   DecayFinderContainer_v1 *m_decayMap = nullptr;
   std::string m_df_module_name;
 
@@ -504,6 +664,8 @@ class TrackToCalo : public SubsysReco
   SvtxTrackEval *trackeval = nullptr;
   SvtxTruthEval *trutheval = nullptr;
   SvtxVertexEval *vertexeval = nullptr;
+  TruthParticleIndex m_truth_index;
+  ClusterPositionCache m_cluster_positions;
 };
 
 #endif // TRACKTOCALO_H
@@ -0,0 +1,83 @@
+/*!
+ *  \file   TreeColumnRegistry.cc
+ *  \brief  Table of output tree columns: owns the per-event buffers,
+ *          books the branches and resets them in one pass
+ */
+#include "TreeColumnRegistry.h"
+
+#include <TTree.h>
+
+//____________________________________________________________________________..
+void TreeColumnRegistry::reserve(int collection, std::size_t n)
+{
+  for (auto &column : m_columns)
+  {
+    if (column.collection != collection) continue;
+    if (column.type == kFloatVector) static_cast<std::vector<float> *>(column.address)->reserve(n);
+    else if (column.type == kIntVector) static_cast<std::vector<int> *>(column.address)->reserve(n);
+  }
+}
+
+//____________________________________________________________________________..
+void TreeColumnRegistry::bindArray(const std::string &name, float *address, std::size_t size, const std::string &leaflist, unsigned int trees)
+{
+  m_columns.push_back({name, kFloatArray, -1, trees, address, size, leaflist});
+}
+
+//____________________________________________________________________________..
+void TreeColumnRegistry::createBranches(TTree *tree, unsigned int treeBit) const
+{
+  for (const auto &column : m_columns)
+  {
+    if (!(column.trees & treeBit)) continue;
+    createBranch(tree, column, column.address);
+  }
+}
+
+//____________________________________________________________________________..
+void TreeColumnRegistry::createBranch(TTree *tree, const Column &column, void *address)
+{
+  switch (column.type)
+  {
+  case kFloatVector:
+    tree->Branch(column.name.c_str(), static_cast<std::vector<float> *>(address));
+    break;
+  case kIntVector:
+    tree->Branch(column.name.c_str(), static_cast<std::vector<int> *>(address));
+    break;
+  case kFloatScalar:
+    tree->Branch(column.name.c_str(), static_cast<float *>(address));
+    break;
+  case kIntScalar:
+    tree->Branch(column.name.c_str(), static_cast<int *>(address));
+    break;
+  case kFloatArray:
+    tree->Branch(column.name.c_str(), static_cast<float *>(address), column.leaflist.c_str());
+    break;
+  }
+}
+
+//____________________________________________________________________________..
+void TreeColumnRegistry::reset(unsigned int treeMask)
+{
+  // clear() keeps the capacity, so buffers reserved once are reused event after event
+  for (auto &column : m_columns)
+  {
+    if (!(column.trees & treeMask)) continue;
+    if (column.type == kFloatVector) static_cast<std::vector<float> *>(column.address)->clear();
+    else if (column.type == kIntVector) static_cast<std::vector<int> *>(column.address)->clear();
+  }
+}
+
+//____________________________________________________________________________..
+std::size_t TreeColumnRegistry::size(int collection, unsigned int treeMask) const
+{
+  // all vector columns of a collection are filled together
+  for (const auto &column : m_columns)
+  {
+    if (column.collection != collection || !(column.trees & treeMask)) continue;
+    if (column.type == kFloatVector) return static_cast<const std::vector<float> *>(column.address)->size();
+    if (column.type == kIntVector) return static_cast<const std::vector<int> *>(column.address)->size();
+  }
+  return 0;
+}
@@ -0,0 +1,120 @@
+// Tell emacs that this is a C++ source
+//  -*- C++ -*-.
+/*!
+ *  \file   TreeColumnRegistry.h
+ *  \brief  Table of output tree columns: owns the per-event buffers,
+ *          books the branches and resets them in one pass
+ */
+
+#ifndef TREECOLUMNREGISTRY_H
+#define TREECOLUMNREGISTRY_H
+
+#include <cstddef>
+#include <deque>
+#include <string>
+#include <vector>
+
+class TTree;
+
+class TreeColumnRegistry
+{
+ public:
+  enum ColumnType
+  {
+    kFloatVector,
+    kIntVector,
+    kFloatScalar,
+    kIntScalar,
+    kFloatArray
+  };
+
+  struct Column
+  {
+    std::string name;
+    ColumnType type;
+    int collection;
+    unsigned int trees;
+    void *address;
+    std::size_t size = 0;  // number of floats of a kFloatArray
+    std::string leaflist;  // leaflist of a kFloatArray, e.g. "e[24][64]/F"
+  };
+
+  TreeColumnRegistry() = default;
+  TreeColumnRegistry(const TreeColumnRegistry &) = delete;
+  TreeColumnRegistry &operator=(const TreeColumnRegistry &) = delete;
+
+  /// register a per-object column; the returned buffer stays valid for the lifetime of the registry
+  template <typename T>
+  std::vector<T> &add(const std::string &name, int collection, unsigned int trees);
+
+  /// register a per-event scalar; scalars are not touched by reset()
+  template <typename T>
+  T &addScalar(const std::string &name, unsigned int trees);
+
+  /// register a fixed size float array owned by the caller; arrays are not touched by reset()
+  void bindArray(const std::string &name, float *address, std::size_t size, const std::string &leaflist, unsigned int trees);
+
+  /// pre-allocate every column of a collection for n entries
+  void reserve(int collection, std::size_t n);
+
+  /// book one branch per column flagged with treeBit, in registration order
+  void createBranches(TTree *tree, unsigned int treeBit) const;
+
+  /// book the branch of one column on a buffer of the column's type, which need not be the registry's own
+  static void createBranch(TTree *tree, const Column &column, void *address);
+
+  /// clear every vector column belonging to any tree in treeMask
+  void reset(unsigned int treeMask);
+
+  /// current number of entries of a collection, taken from its first vector column in treeMask; 0 if it has none
+  std::size_t size(int collection, unsigned int treeMask) const;
+
+  const std::vector<Column> &columns() const { return m_columns; }
+
+ private:
+  template <typename T>
+  std::deque<std::vector<T>> &vectorStorage();
+  template <typename T>
+  std::deque<T> &scalarStorage();
+  template <typename T>
+  static ColumnType vectorType();
+  template <typename T>
+  static ColumnType scalarType();
+
+  // deques never relocate their elements, so references handed out by add() remain stable
+  std::deque<std::vector<float>> m_float_vectors;
+  std::deque<std::vector<int>> m_int_vectors;
+  std::deque<float> m_float_scalars;
+  std::deque<int> m_int_scalars;
+
+  std::vector<Column> m_columns;
+};
+
+template <> inline std::deque<std::vector<float>> &TreeColumnRegistry::vectorStorage<float>() { return m_float_vectors; }
+template <> inline std::deque<std::vector<int>> &TreeColumnRegistry::vectorStorage<int>() { return m_int_vectors; }
+template <> inline std::deque<float> &TreeColumnRegistry::scalarStorage<float>() { return m_float_scalars; }
+template <> inline std::deque<int> &TreeColumnRegistry::scalarStorage<int>() { return m_int_scalars; }
+template <> inline TreeColumnRegistry::ColumnType TreeColumnRegistry::vectorType<float>() { return kFloatVector; }
+template <> inline TreeColumnRegistry::ColumnType TreeColumnRegistry::vectorType<int>() { return kIntVector; }
+template <> inline TreeColumnRegistry::ColumnType TreeColumnRegistry::scalarType<float>() { return kFloatScalar; }
+template <> inline TreeColumnRegistry::ColumnType TreeColumnRegistry::scalarType<int>() { return kIntScalar; }
+
+template <typename T>
+std::vector<T> &TreeColumnRegistry::add(const std::string &name, int collection, unsigned int trees)
+{
+  std::deque<std::vector<T>> &storage = vectorStorage<T>();
+  storage.emplace_back();
+  m_columns.push_back({name, vectorType<T>(), collection, trees, &storage.back(), 0, ""});
+  return storage.back();
+}
+
+template <typename T>
+T &TreeColumnRegistry::addScalar(const std::string &name, unsigned int trees)
+{
+  std::deque<T> &storage = scalarStorage<T>();
+  storage.emplace_back();
+  m_columns.push_back({name, scalarType<T>(), -1, trees, &storage.back(), 0, ""});
+  return storage.back();
+}
+
+#endif // TREECOLUMNREGISTRY_H
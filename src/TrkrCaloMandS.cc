@@ -4,6 +4,9 @@
 
 #include "TrkrCaloMandS.h"
 
+#include "TrackCaloMatchIndex.h"
+#include "TrackSummary.h"
+
 #include <calobase/RawClusterContainer.h>
 #include <calobase/RawTowerGeomContainer.h>
 #include <calobase/RawCluster.h>
@@ -56,7 +59,10 @@
 #include <phool/PHNodeIterator.h>
 
 #include <CLHEP/Vector/ThreeVector.h>
+#include <algorithm>
+#include <cmath>
 #include <math.h>
+#include <sstream>
 #include <vector>
 
 #include <TFile.h>
@@ -133,68 +139,70 @@ int TrkrCaloMandS::Init(PHCompositeNode *topNode)
         dstNode->addNode(svtxNode);
     }
 
-    trackMap_new = findNode::getClass<SvtxTrackMap_v2>(topNode, m_trackMapName_new);
-    if(!trackMap_new)
+    // the matches are kept as keys into the original containers; the tracks themselves are not copied
+    m_match_index = findNode::getClass<TrackCaloMatchIndex>(topNode, m_match_index_name);
+    if(!m_match_index)
     {
-        trackMap_new = new SvtxTrackMap_v2;
-        PHIODataNode<PHObject>* trackNode = new PHIODataNode<PHObject>(trackMap_new, m_trackMapName_new, "PHObject");
-        svtxNode->addNode(trackNode);
-        trackMap_new->clear();
+        m_match_index = new TrackCaloMatchIndex;
+        PHIODataNode<PHObject>* indexNode = new PHIODataNode<PHObject>(m_match_index, m_match_index_name, "PHObject");
+        svtxNode->addNode(indexNode);
     }
 
-    // vector to store information for mva-eid
-    _track_ptq.clear();
-    _track_pt.clear();
-    _track_px.clear();
-    _track_py.clear();
-    _track_pz.clear();
-
-    _track_px_emc.clear();
-    _track_py_emc.clear();
-    _track_pz_emc.clear();
+    if(m_write_matched_trackmap)
+    {
+        trackMap_new = findNode::getClass<SvtxTrackMap_v2>(topNode, m_trackMapName_new);
+        if(!trackMap_new)
+        {
+            trackMap_new = new SvtxTrackMap_v2;
+            PHIODataNode<PHObject>* trackNode = new PHIODataNode<PHObject>(trackMap_new, m_trackMapName_new, "PHObject");
+            svtxNode->addNode(trackNode);
+            trackMap_new->clear();
+        }
+    }
 
-    _emcal_e.clear();
-    _emcal_phi.clear();
-    _emcal_eta.clear();
-    _emcal_x.clear();
-    _emcal_y.clear();
-    _emcal_z.clear();
-    _emcal_ecore.clear();
-    _emcal_chi2.clear();
-    _emcal_prob.clear();
+    if (m_monitor_residuals)
+    {
+        // twice the window, so that the tails outside the cuts are visible
+        m_residuals.book(2 * m_dphi_cut, 2 * m_dz_cut);
+    }
 
-    _ihcal_delta_eta.clear();
-    _ihcal_delta_phi.clear();
+    if (!m_eid_weight_file.empty() && !m_eid.load(m_eid_weight_file, m_eid_method))
+    {
+        throw std::runtime_error("Failed to book " + m_eid_method + " from " + m_eid_weight_file + " in TrkrCaloMandS::Init");
+    }
 
     // write a tree to store data for mva-eid
     delete file_4mva;
     file_4mva = new TFile(_outfilename.c_str(), "RECREATE");
+    m_file_options.applyToFile(file_4mva);
 
-    tree_4mva = new TTree("tree_4mva", "MVA-EID pico dst info");
-
-    tree_4mva->Branch("track_ptq", &_track_ptq);
-    tree_4mva->Branch("track_pt", &_track_pt);
-    tree_4mva->Branch("track_px", &_track_px);
-    tree_4mva->Branch("track_py", &_track_py);
-    tree_4mva->Branch("track_pz", &_track_pz);
-
-    tree_4mva->Branch("track_px_emc", &_track_px_emc);
-    tree_4mva->Branch("track_py_emc", &_track_py_emc);
-    tree_4mva->Branch("track_pz_emc", &_track_pz_emc);
-
-    tree_4mva->Branch("emcal_e", &_emcal_e);
-    tree_4mva->Branch("emcal_phi", &_emcal_phi);
-    tree_4mva->Branch("emcal_eta", &_emcal_eta);
-    tree_4mva->Branch("emcal_x", &_emcal_x);
-    tree_4mva->Branch("emcal_y", &_emcal_y);
-    tree_4mva->Branch("emcal_z", &_emcal_z);
-    tree_4mva->Branch("emcal_ecore", &_emcal_ecore);
-    tree_4mva->Branch("emcal_chi2", &_emcal_chi2);
-    tree_4mva->Branch("emcal_prob", &_emcal_prob);
+    if (m_output_format == AsyncTreeWriter::kRNTuple)
+    {
+        m_mva_output = m_writer.addNTuple("tree_4mva", file_4mva, kMVATree);
+        if (m_mva_output < 0)
+        {
+            std::cout << "TrkrCaloMandS::Init - RNTuple output is not available, writing a TTree" << std::endl;
+        }
+    }
+    if (m_mva_output < 0)
+    {
+        tree_4mva = new TTree("tree_4mva", "MVA-EID pico dst info");
+        m_mva_output = m_writer.addTree(tree_4mva, kMVATree);
+        m_file_options.applyToTree(tree_4mva);
+    }
 
-    tree_4mva->Branch("ihcal_delta_eta", &_ihcal_delta_eta);
-    tree_4mva->Branch("ihcal_delta_phi", &_ihcal_delta_phi);
+    return Fun4AllReturnCodes::EVENT_OK;
+}
 
+//____________________________________________________________________________..
+int TrkrCaloMandS::InitRun(PHCompositeNode *topNode)
+{
+    m_calo_lut = CaloGeometryLUT::get(topNode, m_RawTowerGeomCont_name);
+    if (!m_calo_lut)
+    {
+        std::cout << "TrkrCaloMandS::InitRun - calorimeter tower geometry not found! Aborting!" << std::endl;
+        return Fun4AllReturnCodes::ABORTRUN;
+    }
     return Fun4AllReturnCodes::EVENT_OK;
 }
 
@@ -299,6 +307,16 @@ int TrkrCaloMandS::process_event(PHCompositeNode* topNode)
         }
     }
   
+    if(!OHCalGeo)
+    {
+        OHCalGeo = findNode::getClass<RawTowerGeomContainer>(topNode, "TOWERGEOM_HCALOUT");
+        if (!OHCalGeo)
+        {
+            std::cout << "TrkrCaloMandS::process_event " << "TOWERGEOM_HCALOUT" << " not found! Aborting!" << std::endl;
+            return Fun4AllReturnCodes::ABORTEVENT;
+        }
+    }
+  
     if(m_is_simulation)
     {
       if(!m_truthInfo)
@@ -371,8 +389,13 @@ int TrkrCaloMandS::process_event(PHCompositeNode* topNode)
         caloRadiusIHCal = 117;
     }
 
-    // get the hcal 2d energy map
-    Fill_calo_tower(topNode, "HCALIN");
+    // get the calo 2d energy maps and their summed-area tables
+    Fill_calo_tower(topNode, CaloGeometryLUT::kCEMC);
+    Fill_calo_tower(topNode, CaloGeometryLUT::kHCALIN);
+    Fill_calo_tower(topNode, CaloGeometryLUT::kHCALOUT);
+    m_emcal_sums.build(&emcal_tower_e[0][0], n_emcal_tower_etabin, n_emcal_tower_phibin);
+    m_ihcal_sums.build(&ihcal_tower_e[0][0], n_hcal_tower_etabin, n_hcal_tower_phibin);
+    m_ohcal_sums.build(&ohcal_tower_e[0][0], n_hcal_tower_etabin, n_hcal_tower_phibin);
   
     SvtxTrackState *cemcState = nullptr;
     SvtxTrackState *ihcalState = nullptr;
@@ -380,49 +403,72 @@ int TrkrCaloMandS::process_event(PHCompositeNode* topNode)
     TrackSeed *tpc_seed = nullptr;
     TrkrCluster *trkrCluster = nullptr;
 
-    _track_ptq.clear();
-    _track_pt.clear();
-    _track_px.clear();
-    _track_py.clear();
-    _track_pz.clear();
-
-    _track_px_emc.clear();
-    _track_py_emc.clear();
-    _track_pz_emc.clear();
-
-    _emcal_e.clear();
-    _emcal_phi.clear();
-    _emcal_eta.clear();
-    _emcal_x.clear();
-    _emcal_y.clear();
-    _emcal_z.clear();
-    _emcal_ecore.clear();
-    _emcal_chi2.clear();
-    _emcal_prob.clear();
-
-    _ihcal_delta_eta.clear();
-    _ihcal_delta_phi.clear();
+    m_columns.reset(kMVATree);
+    m_match_index->Reset();
+
+    // seed walk and states shared with the other modules, if TrackSummaryMaker ran for this event
+    m_track_summary = findNode::getClass<TrackSummary>(topNode, m_track_summary_name);
+    if (m_track_summary && !m_track_summary->current(trackMap))
+    {
+        m_track_summary = nullptr;
+    }
+
+    // cluster positions are computed once per event and binned for the track loop
+    buildClusterIndex(m_helix_match_radius > 0 ? m_helix_match_radius : caloRadiusEMCal, caloRadiusIHCal);
+
+    // matching at another depth: the EMCal states of the selected tracks are propagated in one pass
+    std::size_t helix_slot = 0;
+    if (m_helix_match_radius > 0)
+    {
+        m_helix.clear();
+        m_helix_tracks.clear();
+        std::size_t itrack = 0;
+        for (auto &iter : *trackMap)
+        {
+            track = iter.second;
+            const std::size_t index = itrack++;
+            if(!checkTrack(track, index)) continue;
+            cemcState = getState(track, index, TrackSummary::kEMCal, caloRadiusEMCal);
+            if(!cemcState) continue;
+            m_helix.add(cemcState->get_x(), cemcState->get_y(), cemcState->get_z(), cemcState->get_px(), cemcState->get_py(), cemcState->get_pz(), track->get_charge());
+            m_helix_tracks.push_back(track);
+        }
+        m_helix.project(m_helix_match_radius, m_helix_points);
+    }
+
+    m_assignment.clear();
+    m_match_tracks.clear();
+    m_evt_display_tracks.clear();
+    m_candidate_dphi.clear();
+    m_candidate_dz.clear();
 
     int num_matched_pair = 0;
     int num_cemcstate = 0;
     int num_ihcalstate = 0;
+    std::size_t itrack = 0;
     for (auto &iter : *trackMap)
     {
         track = iter.second;
+        const std::size_t index = itrack++;
     
-        if(!checkTrack(track))
+        if (m_helix_match_radius > 0)
+        {
+          // checkTrack() and the EMCal state were already required by the pre-pass
+          if (helix_slot >= m_helix_tracks.size() || m_helix_tracks[helix_slot] != track) continue;
+        }
+        else if(!checkTrack(track, index))
         {
           continue;
         }
       
-        cemcState = track->get_state(caloRadiusEMCal);
+        cemcState = getState(track, index, TrackSummary::kEMCal, caloRadiusEMCal);
         float _track_phi_emc = NAN;
         float _track_eta_emc = NAN;
         float _track_x_emc = NAN;
         float _track_y_emc = NAN;
         float _track_z_emc = NAN;
     
-        ihcalState = track->get_state(caloRadiusIHCal);
+        ihcalState = getState(track, index, TrackSummary::kIHCal, caloRadiusIHCal);
         float _track_phi_ihc = NAN;
         float _track_eta_ihc = NAN;
         float _track_x_ihc = NAN;
@@ -440,6 +486,15 @@ int TrkrCaloMandS::process_event(PHCompositeNode* topNode)
             _track_x_emc = cemcState->get_x();
             _track_y_emc = cemcState->get_y();
             _track_z_emc = cemcState->get_z();
+            if (m_helix_match_radius > 0)
+            {
+                _track_phi_emc = m_helix_points.phi[helix_slot];
+                _track_eta_emc = m_helix_points.eta[helix_slot];
+                _track_x_emc = m_helix_points.x[helix_slot];
+                _track_y_emc = m_helix_points.y[helix_slot];
+                _track_z_emc = m_helix_points.z[helix_slot];
+                helix_slot++;
+            }
 
             num_cemcstate += 1;
         }
@@ -459,6 +514,11 @@ int TrkrCaloMandS::process_event(PHCompositeNode* topNode)
             num_ihcalstate += 1;
 
             // // from track2ihcal
+            // the geometry exits on a non-finite eta or phi
+            if (!std::isfinite(_track_eta_ihc) || !std::isfinite(_track_phi_ihc))
+            {
+                continue;
+            }
             int etabin = IHCalGeo->get_etabin(_track_eta_ihc);
             int phibin = IHCalGeo->get_phibin(_track_phi_ihc);
 
@@ -482,42 +542,121 @@ int TrkrCaloMandS::process_event(PHCompositeNode* topNode)
             // }
         }
 
+        // 3x3, 5x5 and 7x7 tower energies around the projections, written for every matched cluster;
+        // NaN when a projection is not finite (a helix that misses the radius), since the geometry exits on it
+        MatchTrack match_track;
+        match_track.key = iter.first;
+        match_track.track = track;
+        match_track.state = cemcState;
+        for (int iw = 0; iw < 3; iw++)
+        {
+            for (int ic = 0; ic < 3; ic++) match_track.tower_sums[ic][iw] = NAN;
+        }
+        if (std::isfinite(_track_eta_emc) && std::isfinite(_track_phi_emc))
+        {
+            const int emc_etabin = EMCalGeo->get_etabin(_track_eta_emc);
+            const int emc_phibin = EMCalGeo->get_phibin(_track_phi_emc);
+            for (int iw = 0; iw < 3; iw++)
+            {
+                match_track.tower_sums[0][iw] = m_emcal_sums.sum(emc_etabin, emc_phibin, 3 + 2 * iw);
+            }
+        }
+        if (std::isfinite(_track_eta_ihc) && std::isfinite(_track_phi_ihc))
+        {
+            const int ihc_etabin = IHCalGeo->get_etabin(_track_eta_ihc);
+            const int ihc_phibin = IHCalGeo->get_phibin(_track_phi_ihc);
+            const int ohc_etabin = OHCalGeo->get_etabin(_track_eta_ihc);
+            const int ohc_phibin = OHCalGeo->get_phibin(_track_phi_ihc);
+            for (int iw = 0; iw < 3; iw++)
+            {
+                match_track.tower_sums[1][iw] = m_ihcal_sums.sum(ihc_etabin, ihc_phibin, 3 + 2 * iw);
+                match_track.tower_sums[2][iw] = m_ohcal_sums.sum(ohc_etabin, ohc_phibin, 3 + 2 * iw);
+            }
+        }
+
+        // Loop over the HCal(Topo) clusters ------------------------------------
+        // topo clusters with EMCal towers, compared to the EMCal projection; the helix point is compared
+        // to the clusters at the helix radius, the EMCal state to the ones at the IHCal radius as before
+        const CaloClusterIndex &em_topo_index = m_helix_match_radius > 0 ? m_em_topo_index : m_topo_index;
+        em_topo_index.query(_track_phi_emc, _track_z_emc, m_index_candidates);
+        for (unsigned int i : m_index_candidates)
+        {
+            if (!(em_topo_index.flags(i) & kTopoHasEMCal)) continue;
+
+            float _topo_phi_tem = em_topo_index.phi(i);
+            float _topo_z_tem = em_topo_index.z(i);
+            float dphi = PiRange(_track_phi_emc - _topo_phi_tem);
+            float dz = _track_z_emc - _topo_z_tem;
+            if(fabs(dphi)<m_dphi_cut && fabs(dz)<m_dz_cut) 
+            {
+                if (Verbosity() > 1) {std::cout<<"EM topo cluster phi and eta: "<< _topo_phi_tem << ", "<< _topo_z_tem <<std::endl;}
+                count_topo_clusters += 1;
+            }
+        }
+
+        // topo clusters with OHCal towers, compared to the IHCal projection
+        int match_topo_cluster = 0;
+        m_topo_index.query(_track_phi_ihc, _track_z_ihc, m_index_candidates);
+        for (unsigned int i : m_index_candidates)
+        {
+            float _topo_phi_tem = m_topo_index.phi(i);
+            float _topo_z_tem = m_topo_index.z(i);
+            float dphi = PiRange(_track_phi_ihc - _topo_phi_tem);
+            float dz = _track_z_ihc - _topo_z_tem;
+            if (m_monitor_residuals) m_residuals.fill(0, ResidualMonitor::kIHCalTopo, dphi, dz, _track_phi_ihc, _track_z_ihc, track->get_charge() * track->get_pt());
+
+            // any topo cluster behind the track provides the layer fractions, the closest in phi wins
+            if(fabs(dphi)<m_dphi_cut && fabs(dz)<m_dz_cut && (match_track.closest_topo < 0 || fabs(dphi) < fabs(PiRange(_track_phi_ihc - m_topo_index.phi(match_track.closest_topo)))))
+            {
+                match_track.closest_topo = i;
+            }
+
+            if (!(m_topo_index.flags(i) & kTopoHasOHCal)) continue;
+
+            float _topo_eta_tem = m_topo_index.eta(i);
+            float _topo_x_tem = m_topo_index.x(i);
+            float _topo_y_tem = m_topo_index.y(i);
+
+            if (Verbosity() > 2) {std::cout << "TOPO cluster R is: " << m_topo_index.r(i) << std::endl;}
+
+            if(fabs(dphi)<m_dphi_cut && fabs(dz)<m_dz_cut) // default: m_dphi_cut = 0.5, m_dz_cut = 20;
+            {
+                match_topo_cluster += 1;
+                if (Verbosity() > 1)
+                {
+                    if(match_topo_cluster>1.1) std::cout << "match topo cluster > 1. "<< std::endl;
+                    std::cout<<"corresponding topo cluster: "<<std::endl;
+                    std::cout<<"topo x = "<<_topo_x_tem<<" , y = "<<_topo_y_tem<<" , z = "<<_topo_z_tem<<" , phi = "<<_topo_phi_tem<<" , eta = "<<_topo_eta_tem<<std::endl;
+                    std::cout<<"track projected x = "<<_track_x_ihc<<" , y = "<<_track_y_ihc<<" , z = "<<_track_z_ihc<<" , phi = "<<_track_phi_ihc<<" , eta = "<<_track_eta_ihc<<std::endl;       
+                }
+            }
+        }
+
         bool is_match = false; // ****************************
         
-        RawCluster *cluster = nullptr;
-        
-        RawClusterContainer::Range begin_end_EMC = clustersEM->getClusters();
-        RawClusterContainer::Iterator clusIter_EMC;
-    
         int match_emc_cluster = 0;
-        /// Loop over the EMCal clusters
-        for (clusIter_EMC = begin_end_EMC.first; clusIter_EMC != begin_end_EMC.second; ++clusIter_EMC)
+        /// Loop over the EMCal clusters around the track projection
+        m_emc_index.query(_track_phi_emc, _track_z_emc, m_index_candidates);
+        for (unsigned int i : m_index_candidates)
         {
-            cluster = clusIter_EMC->second;
-            if(cluster->get_energy() < m_emcal_e_low_cut) // default 0.5 GeV
-            {
-                continue;
-            }
-          
-            float _emcal_phi_tem = atan2(cluster->get_y(), cluster->get_x());
-            float _emcal_eta_tem = asinh(cluster->get_z()/sqrt(cluster->get_x()*cluster->get_x() + cluster->get_y()*cluster->get_y()));
-            float _emcal_x_tem = cluster->get_x();
-            float _emcal_y_tem = cluster->get_y();
-            float radius_scale = caloRadiusEMCal / sqrt(_emcal_x_tem*_emcal_x_tem+_emcal_y_tem*_emcal_y_tem);
-            float _emcal_z_tem = radius_scale*cluster->get_z();
+            float _emcal_phi_tem = m_emc_index.phi(i);
+            float _emcal_eta_tem = m_emc_index.eta(i);
+            float _emcal_x_tem = m_emc_index.x(i);
+            float _emcal_y_tem = m_emc_index.y(i);
+            float _emcal_z_tem = m_emc_index.z(i);
             
             float dphi = PiRange(_track_phi_emc - _emcal_phi_tem);
             float dz = _track_z_emc - _emcal_z_tem;
+            if (m_monitor_residuals) m_residuals.fill(0, ResidualMonitor::kEMCal, dphi, dz, _track_phi_emc, _track_z_emc, track->get_charge() * track->get_pt());
           
             if(fabs(dphi)<m_dphi_cut && fabs(dz)<m_dz_cut) // default: m_dphi_cut = 0.5, m_dz_cut = 20;
             {
                 match_emc_cluster += 1;
                 // if(match_emc_cluster>1.1) std::cout << "match cluster > 1. "<< std::endl;
 
-                std::cout<<"EM temple cluster phi and eta: "<< _emcal_phi_tem << ", "<< _emcal_z_tem <<std::endl;
+                if (Verbosity() > 1) {std::cout<<"EM temple cluster phi and eta: "<< _emcal_phi_tem << ", "<< _emcal_z_tem <<std::endl;}
                 count_em_clusters += 1;
 
-                is_match = true;
 	            if (Verbosity() > 2)
 	            {
                     std::cout<<"matched tracks!!!"<<std::endl;
@@ -525,107 +664,58 @@ int TrkrCaloMandS::process_event(PHCompositeNode* topNode)
                     std::cout<<"track projected x = "<<_track_x_emc<<" , y = "<<_track_y_emc<<" , z = "<<_track_z_emc<<" , phi = "<<_track_phi_emc<<" , eta = "<<_track_eta_emc<<std::endl;
                     std::cout<<"track px = "<<track->get_px()<<" , py = "<<track->get_py()<<" , pz = "<<track->get_pz()<<" , pt = "<<track->get_pt()<<" , p = "<<track->get_p()<<" , charge = "<<track->get_charge()<<std::endl;
                 }
-                Fill_Match_Info_TrkCalo(track, cemcState, cluster);       
-            }
-        }
-
-        // Loop over the HCal(Topo) clusters ------------------------------------
-        RawCluster *cluster_topo = nullptr;
-        RawClusterContainer::Range begin_end_TOPO = clustersTOPO->getClusters();
-        RawClusterContainer::Iterator clusIter_TOPO;
-        for (clusIter_TOPO = begin_end_TOPO.first; clusIter_TOPO != begin_end_TOPO.second; ++clusIter_TOPO)
-        {
-            cluster_topo = clusIter_TOPO->second;
-            if(cluster_topo->get_energy() < m_topo_e_low_cut) // default 0.5 GeV
-            {
-                continue;
-            }
-
-            double caloRadiusTopo = caloRadiusIHCal;
-          
-            float _topo_phi_tem = atan2(cluster_topo->get_y(), cluster_topo->get_x());
-            float _topo_eta_tem = asinh(cluster_topo->get_z()/sqrt(cluster_topo->get_x()*cluster_topo->get_x() + cluster_topo->get_y()*cluster_topo->get_y()));
-            float _topo_x_tem = cluster_topo->get_x();
-            float _topo_y_tem = cluster_topo->get_y();
-            double _topo_R = sqrt(_topo_x_tem*_topo_x_tem + _topo_y_tem*_topo_y_tem);
-
-            float radius_scale = caloRadiusTopo / _topo_R;
-            float _topo_z_tem = radius_scale*cluster_topo->get_z();
-            
-            bool em_on_topo = false;
-            bool ih_on_topo = false;
-            bool oh_on_topo = false;
-            RawCluster::TowerConstRange towers = cluster_topo->get_towers();
-            for (RawCluster::TowerConstIterator it = towers.first; it != towers.second; ++it)
-            {
-                unsigned int towerid = it->first;
-                float fraction = it->second;
-                
-                RawTowerDefs::CalorimeterId calo_id = RawTowerDefs::decode_caloid(towerid);
-                int ieta = RawTowerDefs::decode_index1(towerid);
-                int iphi = RawTowerDefs::decode_index2(towerid);
-            
-                if (calo_id == RawTowerDefs::CEMC)
-                {
-                    em_on_topo = true;
-                    // std::cout << "EMCal tower: eta = " << ieta << ", phi = " << iphi << ", fraction = " << fraction << "\n";
-                }
-                else if (calo_id == RawTowerDefs::HCALIN)
+                // window-normalised distance, used to rank the candidates
+                float residual = sqrt((dphi/m_dphi_cut)*(dphi/m_dphi_cut) + (dz/m_dz_cut)*(dz/m_dz_cut));
+                if (m_assignment_mode == kAllCandidates)
                 {
-                    ih_on_topo = true;
-                    // std::cout << "IHCal tower: eta = " << ieta << ", phi = " << iphi << ", fraction = " << fraction << "\n";
+                    if (fillMatchRow(match_track, i, dphi, dz, residual, NAN)) is_match = true;
                 }
-                else if (calo_id == RawTowerDefs::HCALOUT)
+                else
                 {
-                    oh_on_topo = true;
-                    // std::cout << "OHCal tower: eta = " << ieta << ", phi = " << iphi << ", fraction = " << fraction << "\n";
+                    m_assignment.add(m_match_tracks.size(), i, residual);
+                    m_candidate_dphi.push_back(dphi);
+                    m_candidate_dz.push_back(dz);
                 }
             }
+        }
 
-            if(em_on_topo) 
-            {
-                float dphi = PiRange(_track_phi_emc - _topo_phi_tem);
-                float dz = _track_z_emc - _topo_z_tem;
-                if(fabs(dphi)<m_dphi_cut && fabs(dz)<m_dz_cut) 
-                {
-                    std::cout<<"EM topo cluster phi and eta: "<< _topo_phi_tem << ", "<< _topo_z_tem <<std::endl;
-                    count_topo_clusters += 1;
-                }
-            }
-
-            if (!oh_on_topo) continue;
-
-            std::cout << "TOPO cluster R is: " << _topo_R << std::endl;
-            
-            int match_topo_cluster = 0;
-            float dphi = PiRange(_track_phi_ihc - _topo_phi_tem);
-            float dz = _track_z_ihc - _topo_z_tem;
-            if(fabs(dphi)<m_dphi_cut && fabs(dz)<m_dz_cut) // default: m_dphi_cut = 0.5, m_dz_cut = 20;
-            {
-                match_topo_cluster += 1;
-                if(match_topo_cluster>1.1) std::cout << "match topo cluster > 1. "<< std::endl;
-
-                std::cout<<"corresponding topo cluster: "<<std::endl;
-                std::cout<<"topo x = "<<_topo_x_tem<<" , y = "<<_topo_y_tem<<" , z = "<<_topo_z_tem<<" , phi = "<<_topo_phi_tem<<" , eta = "<<_topo_eta_tem<<std::endl;
-                std::cout<<"track projected x = "<<_track_x_ihc<<" , y = "<<_track_y_ihc<<" , z = "<<_track_z_ihc<<" , phi = "<<_track_phi_ihc<<" , eta = "<<_track_eta_ihc<<std::endl;       
-            }
- 
-            
+        if (m_assignment_mode != kAllCandidates)
+        {
+            // rows are written once every track has its candidates
+            if (match_emc_cluster > 0) m_match_tracks.push_back(match_track);
+            continue;
         }
 
         // 可以match 的 track存个svtxmap
         if(is_match)
         {                                             
-            //trackMap_new->insert(iter.second);
-            trackMap_new->insertWithKey(iter.second,iter.first);
-            if (Verbosity() > 1) {std::cout<<"insertWithKey iter.first = "<<iter.first<<" , track->get_id() = "<<track->get_id()<<std::endl;}
+            storeMatchedTrack(match_track);
+            num_matched_pair++;
+        }
+    }
+
+    // one cluster per track and one track per cluster
+    if (m_assignment_mode != kAllCandidates)
+    {
+        m_assignment.solve(m_assignment_mode == kHungarian ? TrackCaloAssignment::kHungarian : TrackCaloAssignment::kGreedy, m_assignment_max_component);
+        for (std::size_t slot = 0; slot < m_match_tracks.size(); slot++)
+        {
+            int edge = m_assignment.assigned(slot);
+            if (edge < 0) continue;
+            if (!fillMatchRow(m_match_tracks[slot], m_assignment.cluster(edge), m_candidate_dphi[edge], m_candidate_dz[edge], m_assignment.residual(edge), m_assignment.runnerUp(slot))) continue;
+            storeMatchedTrack(m_match_tracks[slot]);
             num_matched_pair++;
         }
     }
 
     // std::cout<<"num_cemc_ihcal is: "<< num_cemcstate <<", "<< num_ihcalstate <<std::endl;
     
-    tree_4mva->Fill();
+    if (m_write_evt_display)
+    {
+        writeEventDisplay();
+    }
+
+    m_writer.commit(m_mva_output);
     
     // std::cout<<"33333333333333333333333"<<std::endl;
 
@@ -633,7 +723,60 @@ int TrkrCaloMandS::process_event(PHCompositeNode* topNode)
 }
 
 //____________________________________________________________________________..
-bool TrkrCaloMandS::checkTrack(SvtxTrack* track)
+bool TrkrCaloMandS::fillMatchRow(const MatchTrack &match_track, unsigned int icluster, float dphi, float dz, float residual, float runner_up)
+{
+    RawCluster *cluster = m_emc_index_clusters[icluster];
+    float score = m_eid.evaluate(match_track.tower_sums[0][0], match_track.track->get_p(), match_track.tower_sums[1][0], cluster->get_chi2());
+    if (m_eid_apply_cut && m_eid.loaded() && !(score >= m_eid_score_cut))
+    {
+        m_eid_rejected++;
+        return false;
+    }
+
+    Fill_Match_Info_TrkCalo(match_track.track, match_track.state, cluster);
+    for (int icalo = 0; icalo < 3; icalo++)
+    {
+        for (int iw = 0; iw < 3; iw++) _tower_sum_columns[icalo][iw]->push_back(match_track.tower_sums[icalo][iw]);
+    }
+    for (int ilayer = 0; ilayer < kNTopoLayers; ilayer++)
+    {
+        _topo_efrac_columns[ilayer]->push_back(match_track.closest_topo < 0 ? NAN : m_topo_fractions[kNTopoLayers * match_track.closest_topo + ilayer]);
+    }
+    _emcal_match_residual.push_back(residual);
+    _emcal_runnerup_residual.push_back(runner_up);
+    _eid_score.push_back(score);
+    m_match_index->add(match_track.key, cluster->get_id(), dphi, dz, cluster->get_energy() / match_track.track->get_p());
+    return true;
+}
+
+//____________________________________________________________________________..
+void TrkrCaloMandS::storeMatchedTrack(const MatchTrack &match_track)
+{
+    const unsigned int key = match_track.key;
+    SvtxTrack *track = match_track.track;
+    if (m_write_evt_display)
+    {
+        // straight segment from the track origin to its EMCal state
+        const float dx = match_track.state->get_x() - track->get_x();
+        const float dy = match_track.state->get_y() - track->get_y();
+        const float dz = match_track.state->get_z() - track->get_z();
+        std::ostringstream json;
+        json << (m_evt_display_tracks.empty() ? "" : ",") << "{\"color\":16777215,\"l\":" << sqrt(dx*dx + dy*dy + dz*dz)
+             << ",\"nh\":0,\"pxyz\":[" << track->get_px() << "," << track->get_py() << "," << track->get_pz()
+             << "],\"q\":" << track->get_charge() << ",\"xyz\":[" << track->get_x() << "," << track->get_y() << "," << track->get_z() << "]}";
+        m_evt_display_tracks += json.str();
+    }
+
+    //trackMap_new->insert(track);
+    if(trackMap_new)
+    {
+        trackMap_new->insertWithKey(track, key);
+        if (Verbosity() > 1) {std::cout<<"insertWithKey key = "<<key<<" , track->get_id() = "<<track->get_id()<<std::endl;}
+    }
+}
+
+//____________________________________________________________________________..
+bool TrkrCaloMandS::checkTrack(SvtxTrack* track, std::size_t index)
 {
     if(!track)
     {
@@ -650,6 +793,15 @@ bool TrkrCaloMandS::checkTrack(SvtxTrack* track)
         return false;
     }
 
+    if (m_track_summary)
+    {
+        // same key counts as below, from the seed walk of TrackSummaryMaker
+        return m_track_summary->nkeys[TrackSummary::kMvtx][index] >= m_nmvtx_low_cut &&
+               m_track_summary->nkeys[TrackSummary::kIntt][index] >= m_nintt_low_cut &&
+               m_track_summary->nkeys[TrackSummary::kTpc][index] >= m_ntpc_low_cut &&
+               m_track_summary->nkeys[TrackSummary::kTpot][index] >= m_ntpot_low_cut;
+    }
+
     const auto cluster_keys(get_cluster_keys(track));
     if (count_clusters<TrkrDefs::mvtxId>(cluster_keys) < m_nmvtx_low_cut)
     {
@@ -672,23 +824,167 @@ bool TrkrCaloMandS::checkTrack(SvtxTrack* track)
 }
 
 //____________________________________________________________________________..
-void TrkrCaloMandS::event_file_start(std::ofstream &jason_file_header, std::string date, int runid, int evtid)
+SvtxTrackState *TrkrCaloMandS::getState(SvtxTrack *track, std::size_t index, int projection, double radius)
 {
-    jason_file_header << "{\n    \"EVENT\": {\n        \"runid\": " << runid << ", \n        \"evtid\": " << evtid << ", \n        \"time\": 0, \n        \"type\": \"Collision\", \n        \"s_nn\": 0, \n        \"B\": 3.0,\n        \"pv\": [0,0,0],\n        \"runstats\": [\"sPHENIX Internal\",        \n        \"200 GeV pp\",        \n        \"" << date << ", Run " << runid << "\",        \n        \"Event #" << evtid << "\"]  \n    },\n" << std::endl;
+    if (m_track_summary && m_track_summary->radius[projection] == radius)
+    {
+        return m_track_summary->state[projection][index];
+    }
+    return track->get_state(radius);
+}
 
-    jason_file_header << "    \"META\": {\n       \"HITS\": {\n          \"INNERTRACKER\": {\n              \"type\": \"3D\",\n              \"options\": {\n              \"size\": 6.0,\n              \"color\": 16711680\n              } \n          },\n" << std::endl;
-    jason_file_header << "          \"TRACKHITS\": {\n              \"type\": \"3D\",\n              \"options\": {\n              \"size\": 2.0,\n              \"transparent\": 0.6,\n              \"color\": 16777215\n              } \n          },\n" << std::endl;
-    jason_file_header << "          \"CEMC\": {\n              \"type\": \"PROJECTIVE\",\n              \"options\": {\n                  \"rmin\": 90,\n                  \"rmax\": 136.1,\n                  \"deta\": 0.025,\n                  \"dphi\": 0.025,\n                  \"color\": 16766464,\n                  \"transparent\": 0.6,\n                  \"scaleminmax\": true\n              }\n          },\n" << std::endl;
-    jason_file_header << "    \"JETS\": {\n        \"type\": \"JET\",\n        \"options\": {\n            \"rmin\": 0,\n            \"rmax\": 78,\n            \"emin\": 0,\n            \"emax\": 30,\n            \"color\": 16777215,\n            \"transparent\": 0.5 \n        }\n    }\n        }\n    }\n," << std::endl;
+//____________________________________________________________________________..
+void TrkrCaloMandS::buildClusterIndex(double caloRadiusEMCal, double caloRadiusIHCal)
+{
+    m_emc_index.clear();
+    m_emc_index_clusters.clear();
+    RawClusterContainer::Range begin_end_EMC = clustersEM->getClusters();
+    for (RawClusterContainer::Iterator clusIter_EMC = begin_end_EMC.first; clusIter_EMC != begin_end_EMC.second; ++clusIter_EMC)
+    {
+        RawCluster *cluster = clusIter_EMC->second;
+        if(cluster->get_energy() < m_emcal_e_low_cut) // default 0.5 GeV
+        {
+            continue;
+        }
+        m_emc_index.add(cluster->get_x(), cluster->get_y(), cluster->get_z(), caloRadiusEMCal);
+        m_emc_index_clusters.push_back(cluster);
+    }
+    m_emc_index.build(m_dphi_cut, m_dz_cut);
+
+    // topo clusters are projected to the IHCal radius and tagged with the calorimeters they span;
+    // with helix matching the ones with EMCal towers are also projected to the helix radius of the EMCal match
+    m_topo_index.clear();
+    m_em_topo_index.clear();
+    m_topo_fractions.clear();
+    RawClusterContainer::Range begin_end_TOPO = clustersTOPO->getClusters();
+    for (RawClusterContainer::Iterator clusIter_TOPO = begin_end_TOPO.first; clusIter_TOPO != begin_end_TOPO.second; ++clusIter_TOPO)
+    {
+        RawCluster *cluster_topo = clusIter_TOPO->second;
+        if(cluster_topo->get_energy() < m_topo_e_low_cut) // default 0.5 GeV
+        {
+            continue;
+        }
+
+        unsigned int layers = 0;
+        float layer_e[kNTopoLayers] = {0, 0, 0};
+        RawCluster::TowerConstRange towers = cluster_topo->get_towers();
+        for (RawCluster::TowerConstIterator it = towers.first; it != towers.second; ++it)
+        {
+            RawTowerDefs::CalorimeterId calo_id = RawTowerDefs::decode_caloid(it->first);
+            if (calo_id == RawTowerDefs::CEMC) {layers |= kTopoHasEMCal; layer_e[0] += it->second;}
+            else if (calo_id == RawTowerDefs::HCALIN) {layers |= kTopoHasIHCal; layer_e[1] += it->second;}
+            else if (calo_id == RawTowerDefs::HCALOUT) {layers |= kTopoHasOHCal; layer_e[2] += it->second;}
+        }
+        m_topo_index.add(cluster_topo->get_x(), cluster_topo->get_y(), cluster_topo->get_z(), caloRadiusIHCal, layers);
+        if (m_helix_match_radius > 0 && (layers & kTopoHasEMCal))
+        {
+            m_em_topo_index.add(cluster_topo->get_x(), cluster_topo->get_y(), cluster_topo->get_z(), caloRadiusEMCal, layers);
+        }
+        const float sum_e = layer_e[0] + layer_e[1] + layer_e[2];
+        for (int ilayer = 0; ilayer < kNTopoLayers; ilayer++)
+        {
+            m_topo_fractions.push_back(sum_e > 0 ? layer_e[ilayer] / sum_e : NAN);
+        }
+    }
+    m_topo_index.build(m_dphi_cut, m_dz_cut);
+    m_em_topo_index.build(m_dphi_cut, m_dz_cut);
+}
+
+//____________________________________________________________________________..
+void TrkrCaloMandS::event_file_start(std::string &json, std::string date, int runid, int evtid)
+{
+    // one line per event: the event display reads newline-delimited JSON
+    json += "{\"EVENT\":{\"runid\":" + std::to_string(runid) + ",\"evtid\":" + std::to_string(evtid) +
+            ",\"time\":0,\"type\":\"Collision\",\"s_nn\":0,\"B\":3.0,\"pv\":[0,0,0],"
+            "\"runstats\":[\"sPHENIX Internal\",\"200 GeV pp\",\"" + date + ", Run " + std::to_string(runid) + "\",\"Event #" + std::to_string(evtid) + "\"]},";
+    json += "\"META\":{\"HITS\":{"
+            "\"INNERTRACKER\":{\"type\":\"3D\",\"options\":{\"size\":6.0,\"color\":16711680}},"
+            "\"TRACKHITS\":{\"type\":\"3D\",\"options\":{\"size\":2.0,\"transparent\":0.6,\"color\":16777215}},"
+            "\"CEMC\":{\"type\":\"PROJECTIVE\",\"options\":{\"rmin\":90,\"rmax\":136.1,\"deta\":0.025,\"dphi\":0.025,\"color\":16766464,\"transparent\":0.6,\"scaleminmax\":true}},"
+            "\"JETS\":{\"type\":\"JET\",\"options\":{\"rmin\":0,\"rmax\":78,\"emin\":0,\"emax\":30,\"color\":16777215,\"transparent\":0.5}}}}";
+}
+
+//____________________________________________________________________________..
+void TrkrCaloMandS::writeEventDisplay()
+{
+    // one file per run, the name carries the run number
+    if (m_evt_display.isOpen() && m_runNumber != m_evt_display_run)
+    {
+        closeEventDisplay();
+    }
+    if (!m_evt_display.isOpen())
+    {
+        m_evt_display_run = m_runNumber;
+        std::string filename = m_evt_display_path + "/EventDisplays_run" + std::to_string(m_runNumber) + EventDisplayWriter::extension(m_evt_display.compression());
+        if (!m_evt_display.open(filename))
+        {
+            std::cout << "TrkrCaloMandS::writeEventDisplay - cannot write " << filename << ", event displays are disabled" << std::endl;
+            m_write_evt_display = false;
+            return;
+        }
+    }
+
+    m_evt_display_json.clear();
+    event_file_start(m_evt_display_json, m_run_date, m_runNumber, m_evtNumber);
+
+    // CEMC towers above threshold at their geometric centres
+    std::ostringstream hits;
+    bool first = true;
+    for (int ieta = 0; ieta < n_emcal_tower_etabin; ieta++)
+    {
+        for (int iphi = 0; iphi < n_emcal_tower_phibin; iphi++)
+        {
+            if (emcal_tower_e[ieta][iphi] < m_evt_display_tower_e) continue;
+            int channel = m_calo_lut->channel(CaloGeometryLUT::kCEMC, ieta, iphi);
+            if (channel < 0) continue;
+            hits << (first ? "" : ",") << "{\"eta\":" << m_calo_lut->eta(CaloGeometryLUT::kCEMC, channel) << ",\"phi\":" << m_calo_lut->phi(CaloGeometryLUT::kCEMC, channel) << ",\"e\":" << emcal_tower_e[ieta][iphi] << "}";
+            first = false;
+        }
+    }
+    m_evt_display_json += ",\"HITS\":{\"CEMC\":[" + hits.str() + "]}";
+    m_evt_display_json += ",\"TRACKS\":{\"INNERTRACKER\":[" + m_evt_display_tracks + "]}}";
+    m_evt_display.write(m_runNumber, m_evtNumber, m_evt_display_json);
+}
+
+//____________________________________________________________________________..
+void TrkrCaloMandS::closeEventDisplay()
+{
+    if (!m_evt_display.isOpen()) return;
+    m_evt_display.close();
+    std::cout << "TrkrCaloMandS::closeEventDisplay run " << m_evt_display_run << ": " << m_evt_display.events() << " event displays, "
+              << m_evt_display.bytesIn() << " bytes of JSON written as " << m_evt_display.bytesOut();
+    if (m_evt_display.dropped()) std::cout << ", " << m_evt_display.dropped() << " dropped";
+    std::cout << std::endl;
 }
 
 //____________________________________________________________________________..
 int TrkrCaloMandS::End(PHCompositeNode *topNode)
 {
     std::cout << "count clus num is: "<< count_em_clusters << ", " << count_topo_clusters << std::endl;
+    if (m_eid_apply_cut && m_eid.loaded())
+    {
+        std::cout << "TrkrCaloMandS::End " << m_eid_rejected << " matches below the e-ID score cut " << m_eid_score_cut << std::endl;
+    }
+
+    // the writer thread has to be done with tree_4mva before it is written
+    m_writer.flush();
+    if (m_writer.depth() > 0)
+    {
+        std::cout << "TrkrCaloMandS::End output queue: " << m_writer.stalls() << " stalls, at most "
+                  << m_writer.maxQueued() << " events queued, " << m_writer.fillErrors() << " fill errors" << std::endl;
+    }
+
+    closeEventDisplay();
+
+    if (m_residuals.booked())
+    {
+        std::cout << "TrkrCaloMandS::End residual histograms from " << m_residuals.entries(ResidualMonitor::kEMCal) << " EMCal and "
+                  << m_residuals.entries(ResidualMonitor::kIHCalTopo) << " IHCal-topo candidates" << std::endl;
+        m_residuals.write(file_4mva);
+    }
 
     file_4mva -> cd();
-    tree_4mva -> Write();
+    if (tree_4mva) tree_4mva -> Write();
     h2etaphibin->Write();
     h2tracketaphi->Write();
     file_4mva -> Close();
@@ -726,36 +1022,41 @@ void TrkrCaloMandS::Fill_Match_Info_TrkCalo(SvtxTrack* track_matched, SvtxTrackS
 }
 
 
-void TrkrCaloMandS::Fill_calo_tower(PHCompositeNode *topNode, std::string calorimeter) 
+void TrkrCaloMandS::Fill_calo_tower(PHCompositeNode *topNode, CaloGeometryLUT::Calo calo) 
 {
-    std::string tower_info_container_name = "TOWERINFO_CALIB_" + calorimeter;
-    TowerInfoContainer *_towers_calo = findNode::getClass<TowerInfoContainer>(topNode, tower_info_container_name);
-    
+    static const char *tower_info_container_names[CaloGeometryLUT::kNCalos] = {"TOWERINFO_CALIB_CEMC", "TOWERINFO_CALIB_HCALIN", "TOWERINFO_CALIB_HCALOUT"};
+    TowerInfoContainer *_towers_calo = findNode::getClass<TowerInfoContainer>(topNode, tower_info_container_names[calo]);
+
+    // energy map of the calorimeter, row-major in (etabin, phibin)
+    float *image = &emcal_tower_e[0][0];
+    int n_etabin = n_emcal_tower_etabin;
+    int n_phibin = n_emcal_tower_phibin;
+    if (calo != CaloGeometryLUT::kCEMC)
+    {
+        image = calo == CaloGeometryLUT::kHCALIN ? &ihcal_tower_e[0][0] : &ohcal_tower_e[0][0];
+        n_etabin = n_hcal_tower_etabin;
+        n_phibin = n_hcal_tower_phibin;
+    }
+
     if (_towers_calo) 
     {
-        for (int channel = 0; channel < (int)_towers_calo->size(); ++channel) 
+        // channels beyond the geometry table or bins beyond the map are skipped
+        const unsigned int n_channels = std::min<std::size_t>(_towers_calo->size(), m_calo_lut->size(calo));
+        for (unsigned int channel = 0; channel < n_channels; ++channel) 
         {
-        	TowerInfo *_tower = _towers_calo->get_tower_at_channel(channel);
-        	
-            unsigned int towerkey = _towers_calo->encode_key(channel);
-        	int etabin = _towers_calo->getTowerEtaBin(towerkey);
-        	int phibin = _towers_calo->getTowerPhiBin(towerkey);
-            
-            float towE = _tower->get_energy();
-            if (calorimeter == "HCALIN") 
-            {
-                ihcal_tower_e[etabin][phibin] = towE;
-                // std::cout<<"towE is: "<<towE<<std::endl;  
-            } 
-            else if (calorimeter == "HCALOUT") 
-            {
-                ohcal_tower_e[etabin][phibin] = towE;
-            }
+            TowerInfo *_tower = _towers_calo->get_tower_at_channel(channel);
+            if (!_tower) continue;
+
+            int etabin = m_calo_lut->ieta(calo, channel);
+            int phibin = m_calo_lut->iphi(calo, channel);
+            if (etabin < 0 || etabin >= n_etabin || phibin < 0 || phibin >= n_phibin) continue;
+
+            image[etabin * n_phibin + phibin] = _tower->get_energy();
         }
     } 
     else 
     { 
-        std::cout << "TowerInfoContainer for " << calorimeter << " is missing" << std::endl;
+        std::cout << "TowerInfoContainer " << tower_info_container_names[calo] << " is missing" << std::endl;
     }
 }
 
@@ -25,11 +25,26 @@
 
 #include <TH2D.h>
 
+#include "AsyncTreeWriter.h"
+#include "CaloClusterIndex.h"
+#include "CaloGeometryLUT.h"
+#include "ElectronIdScorer.h"
+#include "EventDisplayWriter.h"
+#include "HelixProjector.h"
+#include "OutputFileOptions.h"
+#include "ResidualMonitor.h"
+#include "TrackCaloAssignment.h"
+#include "TowerSumTable.h"
+#include "TreeColumnRegistry.h"
+
 #include <string>
 #include <vector>
 
 class PHCompositeNode;
 class PHNode;
+class SvtxTrackState;
+class TrackCaloMatchIndex;
+class TrackSummary;
 class TH1;
 class TH2;
 class TFile;
@@ -55,6 +70,9 @@ class TrkrCaloMandS : public SubsysReco
    */
   int Init(PHCompositeNode *topNode) override;
 
+  /// Called at the start of each run; picks up the tower geometry lookup table of the run.
+  int InitRun(PHCompositeNode *topNode) override;
+
   /** Called for each event.
       This is where you do the real work.
    */
@@ -69,8 +87,16 @@ class TrkrCaloMandS : public SubsysReco
   void SetTrackMapName(std::string name) {m_trackMapName = name;}
   std::string GetMyTrackMapName() {return m_trackMapName_new;}
   void SetMyTrackMapName(std::string name) {m_trackMapName_new = name;}
+  /// also copy the matched tracks into the SvtxTrackMap named by SetMyTrackMapName, for consumers that only read track maps
+  void writeMatchedTrackMap(bool value) {m_write_matched_trackmap = value;}
+  /// node holding the (track key, EMCal cluster id, dphi, dz, E/p) records of the matches
+  void setMatchIndexName(const std::string &name) {m_match_index_name = name;}
 
+  /// stream one JSON line per event into <path>/EventDisplays_run<run>.ndjson[.gz|.zst] with an offset index next to it; a new file is started when the run changes
   void writeEventDisplays( bool value ) { m_write_evt_display = value; }
+  void setEventDisplayCompression( EventDisplayWriter::Compression compression ) { m_evt_display.setCompression(compression); }
+  /// CEMC towers below e (GeV) are left out of the event display
+  void setEventDisplayTowerThreshold( float e ) { m_evt_display_tower_e = e; }
 
   void setEventDisplayPath( std::string path ) { m_evt_display_path = path; }
   std::string getEventDisplayPath() {return m_evt_display_path;}
@@ -78,7 +104,7 @@ class TrkrCaloMandS : public SubsysReco
   void setRunDate ( std::string date ) { m_run_date = date; }
   std::string getRunDate () {return m_run_date;}
 
-  void event_file_start(std::ofstream &jason_file_header, std::string date, int runid, int evtid);
+  void event_file_start(std::string &json, std::string date, int runid, int evtid);
 
   void doSimulation(bool set) {m_is_simulation = set;}
 
@@ -103,9 +129,42 @@ class TrkrCaloMandS : public SubsysReco
   void setTrackQuality(float q) {m_track_quality = q;}
   void setdphicut(float a) {m_dphi_cut = a;};
   void setdzcut(float a) {m_dz_cut = a;};
+  /// node written by TrackSummaryMaker; when it is current the cluster counts and states are taken from it
+  void setTrackSummaryName(const std::string &name) {m_track_summary_name = name;}
+  /// match the EMCal clusters and the topo clusters with EMCal towers at radius r (cm), e.g. shower max, with the EMCal states propagated analytically; 0 uses the EMCal states
+  void setHelixMatchRadius(float r) {m_helix_match_radius = r;}
+  /// solenoid field along z used by the helix propagation, in tesla
+  void setHelixField(float tesla) {m_helix.setField(tesla);}
+
+  enum MatchAssignment
+  {
+    kAllCandidates = 0,  ///< one row per cluster inside the window
+    kGreedy = 1,         ///< one cluster per track and track per cluster, smallest residual first
+    kHungarian = 2       ///< as kGreedy, solved exactly on candidate groups of up to max_component tracks/clusters
+  };
+  /// how the EMCal clusters inside the (dphi, dz) window are turned into rows of tree_4mva
+  void setMatchAssignment(MatchAssignment mode, unsigned int max_component = 16) {m_assignment_mode = mode; m_assignment_max_component = max_component;}
+
+  /// histogram dphi and dz of all EMCal and IHCal-topo candidates around the projections (|dphi| < 2 dphicut, |dz| < 2 dzcut), written to the output file
+  void monitorResiduals(bool value) {m_monitor_residuals = value;}
+
+  /// score every matched track with a TMVA weight file (e.g. offAna/dataset_*/weights/TMVAClassification_BDT.weights.xml), booked in Init
+  void setEIDWeightFile(const std::string &file, const std::string &method = "BDT") {m_eid_weight_file = file; m_eid_method = method;}
+  /// with a weight file, rows scoring below cut are not written
+  void setEIDScoreCut(float cut) {m_eid_score_cut = cut; m_eid_apply_cut = true;}
+
+  /// fill tree_4mva on a background thread with up to depth events in flight; 0 fills in process_event
+  void setOutputQueueDepth(unsigned int depth) {m_writer.setDepth(depth);}
+  /// kRNTuple writes tree_4mva as an RNTuple of the same columns
+  void setOutputFormat(AsyncTreeWriter::OutputFormat format) {m_output_format = format;}
+  /// output file tuning: compression (ROOT::RCompressionSetting::EAlgorithm, level), basket sizes, TTree::SetAutoFlush/SetAutoSave
+  void setCompression(int algorithm, int level) {m_file_options.setCompression(algorithm, level);}
+  void setBasketSize(const std::string &pattern, int bytes) {m_file_options.setBasketSize(pattern, bytes);}
+  void setAutoFlush(long long value) {m_file_options.setAutoFlush(value);}
+  void setAutoSave(long long value) {m_file_options.setAutoSave(value);}
 
   void Fill_Match_Info_TrkCalo(SvtxTrack* track_matched, SvtxTrackState *thisState_matched, RawCluster *EMcluster_matched);
-  void Fill_calo_tower(PHCompositeNode *topNode, std::string calorimeter);
+  void Fill_calo_tower(PHCompositeNode *topNode, CaloGeometryLUT::Calo calo);
 
     float PiRange(float phi)
     {
@@ -115,7 +174,69 @@ class TrkrCaloMandS : public SubsysReco
     }
 
  private:
-    bool checkTrack(SvtxTrack* track);
+    // index is the position of the track in trackMap, i.e. in m_track_summary
+    bool checkTrack(SvtxTrack* track, std::size_t index);
+    SvtxTrackState *getState(SvtxTrack *track, std::size_t index, int projection, double radius);
+    void buildClusterIndex(double caloRadiusEMCal, double caloRadiusIHCal);
+
+    // what a row of tree_4mva needs from the track side of a match
+    struct MatchTrack
+    {
+        unsigned int key = 0;
+        SvtxTrack *track = nullptr;
+        SvtxTrackState *state = nullptr;
+        float tower_sums[3][3] = {};
+        int closest_topo = -1;
+    };
+    bool fillMatchRow(const MatchTrack &match_track, unsigned int icluster, float dphi, float dz, float residual, float runner_up);
+    void storeMatchedTrack(const MatchTrack &match_track);
+    void writeEventDisplay();
+    void closeEventDisplay();
+
+    bool m_monitor_residuals = false;
+    ResidualMonitor m_residuals;
+
+    std::string m_eid_weight_file;
+    std::string m_eid_method = "BDT";
+    float m_eid_score_cut = 0;
+    bool m_eid_apply_cut = false;
+    ElectronIdScorer m_eid;
+    unsigned long m_eid_rejected = 0;
+
+    // candidates of the event when the clusters are assigned; edge e of m_assignment has m_candidate_dphi/dz[e]
+    MatchAssignment m_assignment_mode = kAllCandidates;
+    unsigned int m_assignment_max_component = 16;
+    TrackCaloAssignment m_assignment;
+    std::vector<MatchTrack> m_match_tracks;
+    std::vector<float> m_candidate_dphi;
+    std::vector<float> m_candidate_dz;
+
+    // calorimeters contributing towers to a topo cluster
+    enum TopoLayer
+    {
+        kTopoHasEMCal = 1U << 0,
+        kTopoHasIHCal = 1U << 1,
+        kTopoHasOHCal = 1U << 2
+    };
+    static const int kNTopoLayers = 3;
+
+    // per-event cluster lookup; index i of m_emc_index is m_emc_index_clusters[i]
+    CaloClusterIndex m_emc_index;
+    CaloClusterIndex m_topo_index;
+    CaloClusterIndex m_em_topo_index;  // topo clusters with EMCal towers at the helix radius, only with helix matching
+    std::vector<RawCluster*> m_emc_index_clusters;
+    std::vector<unsigned int> m_index_candidates;
+    // EMCal, IHCal and OHCal energy fractions of topo cluster i at [kNTopoLayers * i + layer]
+    std::vector<float> m_topo_fractions;
+
+    std::string m_track_summary_name = "TrackSummary";
+    TrackSummary *m_track_summary = nullptr;
+
+    // EMCal states of the selected tracks, in track map order, and their positions at m_helix_match_radius
+    float m_helix_match_radius = 0;
+    HelixProjector m_helix;
+    HelixProjector::Points m_helix_points;
+    std::vector<SvtxTrack*> m_helix_tracks;
 
     int count_em_clusters = 0;
     int count_topo_clusters = 0;
@@ -134,6 +255,7 @@ class TrkrCaloMandS : public SubsysReco
     PHHepMCGenEvent *m_genevt = nullptr;
     SvtxTrackMap* trackMap = nullptr;
     SvtxTrackMap_v2* trackMap_new = nullptr;
+    TrackCaloMatchIndex* m_match_index = nullptr;
     ActsGeometry* acts_Geometry = nullptr;
     RawClusterContainer* clustersEM = nullptr;
     RawClusterContainer* clustersTOPO = nullptr;
@@ -147,9 +269,12 @@ class TrkrCaloMandS : public SubsysReco
     RawTowerGeomContainer* EMCalGeo = nullptr;
     RawTowerGeomContainer* IHCalGeo = nullptr;
     RawTowerGeomContainer* OHCalGeo = nullptr;
+    CaloGeometryLUT *m_calo_lut = nullptr;
 
     std::string m_trackMapName = "SvtxTrackMap";
     std::string m_trackMapName_new = "MySvtxTrackMap";
+    bool m_write_matched_trackmap = false;
+    std::string m_match_index_name = "TrackCaloMatchIndex";
 
     std::string m_RawClusCont_EM_name = "TOPOCLUSTER_EMCAL";
     std::string m_RawClusCont_TOPO_name = "TOPOCLUSTER_TOPO";
@@ -157,9 +282,14 @@ class TrkrCaloMandS : public SubsysReco
     std::string m_RawTowerGeomCont_name = "TOWERGEOM_CEMC";
     std::string m_towerinfo_container_name = "TOWERINFO_CALIB_HCALIN";
 
-    bool m_write_evt_display;
-    std::string m_evt_display_path;
+    bool m_write_evt_display = false;
+    std::string m_evt_display_path = ".";
     std::string m_run_date;
+    float m_evt_display_tower_e = 0.1;
+    EventDisplayWriter m_evt_display;
+    int m_evt_display_run = 0;
+    std::string m_evt_display_json;
+    std::string m_evt_display_tracks;
 
     float m_track_pt_low_cut = 1;
     float m_emcal_e_low_cut = 0.5;
@@ -176,28 +306,71 @@ class TrkrCaloMandS : public SubsysReco
     TFile* file_4mva = nullptr;
     TTree* tree_4mva = nullptr;
 
-    std::vector<float> _track_ptq;
-    std::vector<float> _track_pt;
-    std::vector<float> _track_px;
-    std::vector<float> _track_py;
-    std::vector<float> _track_pz;
-
-    std::vector<float> _track_px_emc;
-    std::vector<float> _track_py_emc;
-    std::vector<float> _track_pz_emc;
-
-    std::vector<float> _emcal_e;
-    std::vector<float> _emcal_phi;
-    std::vector<float> _emcal_eta;
-    std::vector<float> _emcal_x;
-    std::vector<float> _emcal_y;
-    std::vector<float> _emcal_z;
-    std::vector<float> _emcal_ecore;
-    std::vector<float> _emcal_chi2;
-    std::vector<float> _emcal_prob;
-
-    std::vector<float> _ihcal_delta_eta;
-    std::vector<float> _ihcal_delta_phi;
+    enum OutputTree
+    {
+        kMVATree = 1U << 0
+    };
+    enum ColumnCollection
+    {
+        kMatchColumns = 0
+    };
+
+    // output columns of tree_4mva; the registry books the branches and resets them
+    TreeColumnRegistry m_columns;
+    AsyncTreeWriter m_writer{m_columns};
+    AsyncTreeWriter::OutputFormat m_output_format = AsyncTreeWriter::kTTree;
+    OutputFileOptions m_file_options;
+    int m_mva_output = -1;
+
+    std::vector<float> &_track_ptq = m_columns.add<float>("track_ptq", kMatchColumns, kMVATree);
+    std::vector<float> &_track_pt = m_columns.add<float>("track_pt", kMatchColumns, kMVATree);
+    std::vector<float> &_track_px = m_columns.add<float>("track_px", kMatchColumns, kMVATree);
+    std::vector<float> &_track_py = m_columns.add<float>("track_py", kMatchColumns, kMVATree);
+    std::vector<float> &_track_pz = m_columns.add<float>("track_pz", kMatchColumns, kMVATree);
+
+    std::vector<float> &_track_px_emc = m_columns.add<float>("track_px_emc", kMatchColumns, kMVATree);
+    std::vector<float> &_track_py_emc = m_columns.add<float>("track_py_emc", kMatchColumns, kMVATree);
+    std::vector<float> &_track_pz_emc = m_columns.add<float>("track_pz_emc", kMatchColumns, kMVATree);
+
+    std::vector<float> &_emcal_e = m_columns.add<float>("emcal_e", kMatchColumns, kMVATree);
+    std::vector<float> &_emcal_phi = m_columns.add<float>("emcal_phi", kMatchColumns, kMVATree);
+    std::vector<float> &_emcal_eta = m_columns.add<float>("emcal_eta", kMatchColumns, kMVATree);
+    std::vector<float> &_emcal_x = m_columns.add<float>("emcal_x", kMatchColumns, kMVATree);
+    std::vector<float> &_emcal_y = m_columns.add<float>("emcal_y", kMatchColumns, kMVATree);
+    std::vector<float> &_emcal_z = m_columns.add<float>("emcal_z", kMatchColumns, kMVATree);
+    std::vector<float> &_emcal_ecore = m_columns.add<float>("emcal_ecore", kMatchColumns, kMVATree);
+    std::vector<float> &_emcal_chi2 = m_columns.add<float>("emcal_chi2", kMatchColumns, kMVATree);
+    std::vector<float> &_emcal_prob = m_columns.add<float>("emcal_prob", kMatchColumns, kMVATree);
+
+    // n x n tower energies around the projected towers, n = 3, 5, 7; the OHCal window is centred on the IHCal projection
+    std::vector<float> &_emcal_e3x3 = m_columns.add<float>("emcal_e3x3", kMatchColumns, kMVATree);
+    std::vector<float> &_emcal_e5x5 = m_columns.add<float>("emcal_e5x5", kMatchColumns, kMVATree);
+    std::vector<float> &_emcal_e7x7 = m_columns.add<float>("emcal_e7x7", kMatchColumns, kMVATree);
+    std::vector<float> &_ihcal_e3x3 = m_columns.add<float>("ihcal_e3x3", kMatchColumns, kMVATree);
+    std::vector<float> &_ihcal_e5x5 = m_columns.add<float>("ihcal_e5x5", kMatchColumns, kMVATree);
+    std::vector<float> &_ihcal_e7x7 = m_columns.add<float>("ihcal_e7x7", kMatchColumns, kMVATree);
+    std::vector<float> &_ohcal_e3x3 = m_columns.add<float>("ohcal_e3x3", kMatchColumns, kMVATree);
+    std::vector<float> &_ohcal_e5x5 = m_columns.add<float>("ohcal_e5x5", kMatchColumns, kMVATree);
+    std::vector<float> &_ohcal_e7x7 = m_columns.add<float>("ohcal_e7x7", kMatchColumns, kMVATree);
+    std::vector<float> *_tower_sum_columns[3][3] = {{&_emcal_e3x3, &_emcal_e5x5, &_emcal_e7x7},
+                                                    {&_ihcal_e3x3, &_ihcal_e5x5, &_ihcal_e7x7},
+                                                    {&_ohcal_e3x3, &_ohcal_e5x5, &_ohcal_e7x7}};
+
+    // layer energy fractions of the topo cluster closest to the IHCal projection, NaN without one
+    std::vector<float> &_topo_efrac_emcal = m_columns.add<float>("topo_efrac_emcal", kMatchColumns, kMVATree);
+    std::vector<float> &_topo_efrac_ihcal = m_columns.add<float>("topo_efrac_ihcal", kMatchColumns, kMVATree);
+    std::vector<float> &_topo_efrac_ohcal = m_columns.add<float>("topo_efrac_ohcal", kMatchColumns, kMVATree);
+    std::vector<float> *_topo_efrac_columns[kNTopoLayers] = {&_topo_efrac_emcal, &_topo_efrac_ihcal, &_topo_efrac_ohcal};
+
+    // normalised distance sqrt((dphi/dphi_cut)^2 + (dz/dz_cut)^2) of the cluster, and of the next best candidate of the track (assignment modes only)
+    std::vector<float> &_emcal_match_residual = m_columns.add<float>("emcal_match_residual", kMatchColumns, kMVATree);
+    std::vector<float> &_emcal_runnerup_residual = m_columns.add<float>("emcal_runnerup_residual", kMatchColumns, kMVATree);
+
+    // response of the e-ID classifier on (E3x3/p, IHCal/EMCal 3x3, chi2); NaN without a weight file
+    std::vector<float> &_eid_score = m_columns.add<float>("eid_score", kMatchColumns, kMVATree);
+
+    std::vector<float> &_ihcal_delta_eta = m_columns.add<float>("ihcal_delta_eta", kMatchColumns, kMVATree);
+    std::vector<float> &_ihcal_delta_phi = m_columns.add<float>("ihcal_delta_phi", kMatchColumns, kMVATree);
 
     TH2D* h2etaphibin = new TH2D("h2etaphibin", "h2etaphibin;X Axis;Y Axis;Counts", 103, -2.5, 100.5, 103, -2.5, 100.5);
     TH2D* h2tracketaphi = new TH2D("h2tracketaphi", "h2tracketaphi;X Axis;Y Axis;Counts", 400, -2, 2, 100, -7, 7);
@@ -207,9 +380,18 @@ class TrkrCaloMandS : public SubsysReco
     static const int n_hcal_tower_etabin = 24;
     static const int n_hcal_tower_phibin = 64;
 
+    static const int n_emcal_tower_etabin = 96;
+    static const int n_emcal_tower_phibin = 256;
+
     // HCal Tower information.
     float ihcal_tower_e[n_hcal_tower_etabin][n_hcal_tower_phibin]{};
     float ohcal_tower_e[n_hcal_tower_etabin][n_hcal_tower_phibin]{};
+    float emcal_tower_e[n_emcal_tower_etabin][n_emcal_tower_phibin]{};
+
+    // integral images of the tower maps, rebuilt every event
+    TowerSumTable m_emcal_sums;
+    TowerSumTable m_ihcal_sums;
+    TowerSumTable m_ohcal_sums;
 };  
 
 #endif
@@ -0,0 +1,71 @@
+/*!
+ *  \file   TruthParticleIndex.cc
+ *  \brief  Per-event hashed lookup of secondary G4 truth particles by (barcode, pid)
+ */
+#include "TruthParticleIndex.h"
+
+#include <g4main/PHG4Particle.h>
+#include <g4main/PHG4TruthInfoContainer.h>
+#include <g4main/PHG4VtxPoint.h>
+
+//____________________________________________________________________________..
+void TruthParticleIndex::clear()
+{
+  m_built = false;
+  m_entries.clear();
+  m_chains.clear();
+}
+
+//____________________________________________________________________________..
+void TruthParticleIndex::build(PHG4TruthInfoContainer *truthInfo)
+{
+  clear();
+  m_built = true;
+  if (!truthInfo)
+  {
+    return;
+  }
+
+  PHG4TruthInfoContainer::ConstRange range = truthInfo->GetParticleRange();
+  m_chains.reserve(truthInfo->size());
+  for (PHG4TruthInfoContainer::ConstIterator iter = range.first; iter != range.second; ++iter)
+  {
+    PHG4Particle *particle = iter->second;
+    // primaries cannot be a decay daughter
+    if (particle->get_parent_id() == 0)
+    {
+      continue;
+    }
+
+    Entry entry;
+    entry.particle = particle;
+    entry.mother = truthInfo->GetParticle(particle->get_parent_id());
+    if (!entry.mother)
+    {
+      continue;
+    }
+    if (entry.mother->get_parent_id() != 0)
+    {
+      entry.grandmother = truthInfo->GetParticle(entry.mother->get_parent_id());
+    }
+    entry.vertex = truthInfo->GetVtx(particle->get_vtx_id());
+    entry.mother_vertex = truthInfo->GetVtx(entry.mother->get_vtx_id());
+
+    const int index = static_cast<int>(m_entries.size());
+    m_entries.push_back(entry);
+
+    auto chain = m_chains.emplace(key(particle->get_barcode(), particle->get_pid()), std::make_pair(index, index));
+    if (!chain.second)
+    {
+      m_entries[chain.first->second.second].next = index;
+      chain.first->second.second = index;
+    }
+  }
+}
+
+//____________________________________________________________________________..
+int TruthParticleIndex::first(int barcode, int pid) const
+{
+  auto chain = m_chains.find(key(barcode, pid));
+  return chain == m_chains.end() ? -1 : chain->second.first;
+}
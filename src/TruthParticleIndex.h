@@ -0,0 +1,63 @@
+// Tell emacs that this is a C++ source
+//  -*- C++ -*-.
+/*!
+ *  \file   TruthParticleIndex.h
+ *  \brief  Per-event hashed lookup of secondary G4 truth particles by (barcode, pid)
+ */
+
+#ifndef TRUTHPARTICLEINDEX_H
+#define TRUTHPARTICLEINDEX_H
+
+#include <cstdint>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+class PHG4Particle;
+class PHG4TruthInfoContainer;
+class PHG4VtxPoint;
+
+/*!
+ * Built once per event from the truth container. Every particle with a
+ * parent is stored together with its parent and grandparent and the vertices
+ * of the particle and of its parent, so that DecayFinder daughters can be
+ * matched without rescanning the container. Particles sharing a
+ * (barcode, pid) key are kept in container order.
+ */
+class TruthParticleIndex
+{
+ public:
+  struct Entry
+  {
+    PHG4Particle *particle = nullptr;
+    PHG4Particle *mother = nullptr;
+    PHG4Particle *grandmother = nullptr;
+    PHG4VtxPoint *vertex = nullptr;
+    PHG4VtxPoint *mother_vertex = nullptr;
+    int next = -1;
+  };
+
+  TruthParticleIndex() = default;
+
+  void clear();
+  bool isBuilt() const { return m_built; }
+  void build(PHG4TruthInfoContainer *truthInfo);
+
+  /// first entry with this (barcode, pid), or -1; follow Entry::next for the others
+  int first(int barcode, int pid) const;
+  const Entry &entry(int i) const { return m_entries[i]; }
+  std::size_t size() const { return m_entries.size(); }
+
+ private:
+  static std::uint64_t key(int barcode, int pid)
+  {
+    return (static_cast<std::uint64_t>(static_cast<std::uint32_t>(barcode)) << 32) | static_cast<std::uint32_t>(pid);
+  }
+
+  bool m_built = false;
+  std::vector<Entry> m_entries;
+  // key -> (first, last) entry of the chain
+  std::unordered_map<std::uint64_t, std::pair<int, int>> m_chains;
+};
+
+#endif // TRUTHPARTICLEINDEX_H
@@ -0,0 +1,89 @@
+/*!
+ *  \file   WorkerPool.cc
+ *  \brief  Fixed set of threads running index ranges of one loop at a time
+ */
+#include "WorkerPool.h"
+
+#include <algorithm>
+
+//____________________________________________________________________________..
+WorkerPool::WorkerPool(unsigned int nthreads)
+{
+  for (unsigned int worker = 1; worker < nthreads; worker++)
+  {
+    m_threads.emplace_back(&WorkerPool::run, this, worker);
+  }
+}
+
+//____________________________________________________________________________..
+WorkerPool::~WorkerPool()
+{
+  {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    m_stop = true;
+  }
+  m_start.notify_all();
+  for (auto &thread : m_threads)
+  {
+    thread.join();
+  }
+}
+
+//____________________________________________________________________________..
+void WorkerPool::parallelFor(std::size_t n, std::size_t grain, const std::function<void(unsigned int, std::size_t, std::size_t)> &body)
+{
+  if (n == 0) return;
+  if (m_threads.empty() || n <= grain)
+  {
+    body(0, 0, n);
+    return;
+  }
+
+  {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    m_body = &body;
+    m_size = n;
+    m_grain = std::max<std::size_t>(grain, 1);
+    m_next = 0;
+    m_busy = m_threads.size();
+    m_generation++;
+  }
+  m_start.notify_all();
+
+  work(0);
+
+  // body must stay alive until every thread has left it
+  std::unique_lock<std::mutex> lock(m_mutex);
+  m_done.wait(lock, [this] { return m_busy == 0; });
+  m_body = nullptr;
+}
+
+//____________________________________________________________________________..
+void WorkerPool::work(unsigned int worker)
+{
+  while (true)
+  {
+    std::size_t begin = m_next.fetch_add(m_grain);
+    if (begin >= m_size) return;
+    (*m_body)(worker, begin, std::min(begin + m_grain, m_size));
+  }
+}
+
+//____________________________________________________________________________..
+void WorkerPool::run(unsigned int worker)
+{
+  unsigned long seen = 0;
+  std::unique_lock<std::mutex> lock(m_mutex);
+  while (true)
+  {
+    m_start.wait(lock, [this, seen] { return m_stop || m_generation != seen; });
+    if (m_stop) return;
+    seen = m_generation;
+    lock.unlock();
+
+    work(worker);
+
+    lock.lock();
+    if (--m_busy == 0) m_done.notify_one();
+  }
+}
@@ -0,0 +1,59 @@
+// Tell emacs that this is a C++ source
+//  -*- C++ -*-.
+/*!
+ *  \file   WorkerPool.h
+ *  \brief  Fixed set of threads running index ranges of one loop at a time
+ */
+
+#ifndef WORKERPOOL_H
+#define WORKERPOOL_H
+
+#include <atomic>
+#include <condition_variable>
+#include <cstddef>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+/*!
+ * The threads are started once and sleep between loops. parallelFor()
+ * splits [0, n) into chunks of grain indices which the threads, the
+ * calling one included, take from a shared counter until none is left, so
+ * a thread that drew cheap entries simply takes more chunks. The chunks a
+ * thread gets differ from call to call; callers that need a fixed order
+ * write their results to per-index slots and merge them afterwards.
+ */
+class WorkerPool
+{
+ public:
+  /// nthreads counts the calling thread, so nthreads - 1 threads are started
+  explicit WorkerPool(unsigned int nthreads);
+  ~WorkerPool();
+
+  WorkerPool(const WorkerPool &) = delete;
+  WorkerPool &operator=(const WorkerPool &) = delete;
+
+  unsigned int size() const { return m_threads.size() + 1; }
+
+  /// call body(worker, begin, end) on chunks covering [0, n); returns once all chunks are done
+  void parallelFor(std::size_t n, std::size_t grain, const std::function<void(unsigned int, std::size_t, std::size_t)> &body);
+
+ private:
+  void run(unsigned int worker);
+  void work(unsigned int worker);
+
+  std::vector<std::thread> m_threads;
+  std::mutex m_mutex;
+  std::condition_variable m_start;
+  std::condition_variable m_done;
+  const std::function<void(unsigned int, std::size_t, std::size_t)> *m_body = nullptr;
+  std::size_t m_size = 0;
+  std::size_t m_grain = 1;
+  std::atomic<std::size_t> m_next{0};
+  unsigned long m_generation = 0;
+  unsigned int m_busy = 0;
+  bool m_stop = false;
+};
+
+#endif // WORKERPOOL_H
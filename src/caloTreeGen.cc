@@ -11,6 +11,12 @@
 #include <calobase/TowerInfoContainerv3.h>
 #include <calobase/TowerInfoContainerv4.h>
 #include <calobase/TowerInfoDefs.h>
+#include <calobase/RawTowerGeomContainer.h>
+
+// Tracks.
+#include <trackbase_historic/SvtxTrack.h>
+#include <trackbase_historic/SvtxTrackMap.h>
+#include <trackbase_historic/SvtxTrackState.h>
 
 // Fun4All.
 #include <fun4all/Fun4AllReturnCodes.h>
@@ -29,6 +35,7 @@
 #include <phparameter/PHParameters.h>
 
 // General.
+#include <cmath>
 #include <cstdint>
 #include <iostream>
 #include <map>
@@ -38,6 +45,14 @@ class PHCompositeNode;
 class TowerInfoContainer;
 class caloTreeGen;
 
+namespace {
+  // RawTowerGeomContainer exits the job on a NaN or on an eta outside the calorimeter.
+  bool inAcceptance(const RawTowerGeomContainer *geom, float eta, float phi) {
+    if (!std::isfinite(eta) || !std::isfinite(phi)) return false;
+    return eta >= geom->get_etabounds(0).first && eta <= geom->get_etabounds(geom->get_etabins() - 1).second;
+  }
+}
+
 caloTreeGen::caloTreeGen(const std::string &name, const std::string &outfilename)
   :SubsysReco(name)
 {
@@ -49,25 +64,47 @@ caloTreeGen::caloTreeGen(const std::string &name, const std::string &outfilename
 int caloTreeGen::Init(PHCompositeNode * /*topNode*/) {
   if (verbosity > 0) std::cout << "Processing initialization: CaloEmulatorTreeMaker::Init(PHCompositeNode *topNode)" << std::endl;
   file = new TFile( foutname.c_str(), "RECREATE");
+  file_options.applyToFile(file);
   tree = new TTree("ttree","TTree for JES calibration");
 
   // Tower information.
   Initialize_calo_tower();
+  tree_output = writer.addTree(tree, ttree_bit);
+  file_options.applyToTree(tree);
+
+  if (!image_prefix.empty()) Open_images();
 
   ievent = 0;
   return Fun4AllReturnCodes::EVENT_OK;
 }
 
+int caloTreeGen::InitRun(PHCompositeNode *topNode) {
+  // Missing containers leave their images untouched.
+  Resolve_calo_tower(topNode, kCEMC, n_emcal_tower_etabin, n_emcal_tower_phibin);
+  Resolve_calo_tower(topNode, kHCALIN, n_hcal_tower_etabin, n_hcal_tower_phibin);
+  Resolve_calo_tower(topNode, kHCALOUT, n_hcal_tower_etabin, n_hcal_tower_phibin);
+  return Fun4AllReturnCodes::EVENT_OK;
+}
+
 int caloTreeGen::process_event(PHCompositeNode *topNode) {
   if (verbosity >= 0) {
     if (ievent%100 == 0) std::cout << "Processing event " << ievent << std::endl;
   }
 
   // Tower information.
-  Fill_calo_tower(topNode, "HCALIN");
-  Fill_calo_tower(topNode, "HCALOUT");
+  Fill_calo_tower(kHCALIN, ihcal_tower_e);
+  Fill_calo_tower(kHCALOUT, ohcal_tower_e);
+
+  writer.commit(tree_output);
 
-  tree->Fill();
+  // Images.
+  if (images[0].isOpen()) {
+    Fill_calo_tower(kCEMC, emcal_tower_e);
+    images[0].append(&emcal_tower_e[0][0]);
+    images[1].append(&ihcal_tower_e[0][0]);
+    images[2].append(&ohcal_tower_e[0][0]);
+    if (crop_index.isOpen()) Fill_track_crops(topNode);
+  }
   ievent++;
   return Fun4AllReturnCodes::EVENT_OK;
 }
@@ -81,6 +118,20 @@ int caloTreeGen::ResetEvent(PHCompositeNode * /*topNode*/) {
 int caloTreeGen::End(PHCompositeNode * /*topNode*/) {
   std::cout << "caloTreeGen::End(PHCompositeNode *topNode) Saving TTree" << std::endl;
   std::cout<<"Total events: "<<ievent<<std::endl;
+  // The writer thread has to be done with the tree before it is written.
+  writer.flush();
+  if (writer.depth() > 0) {
+    std::cout << "Output queue: " << writer.stalls() << " stalls, at most " << writer.maxQueued()
+              << " events queued, " << writer.fillErrors() << " fill errors" << std::endl;
+  }
+  if (images[0].isOpen()) {
+    std::cout << "Images: " << images[0].records() << " events, " << crop_index.records() << " track crops" << std::endl;
+  }
+  for (int i = 0; i < 3; i++) {
+    images[i].close();
+    crops[i].close();
+  }
+  crop_index.close();
   file->cd();
   tree->Write();
   file->Close();
@@ -91,39 +142,117 @@ int caloTreeGen::End(PHCompositeNode * /*topNode*/) {
 
 ////////// ********** Initialize functions ********** //////////
 void caloTreeGen::Initialize_calo_tower() {
-  tree->Branch("ihcal_tower_e", ihcal_tower_e, "ihcal_tower_e[24][64]/F");
-  tree->Branch("ohcal_tower_e", ohcal_tower_e, "ohcal_tower_e[24][64]/F");
+  columns.bindArray("ihcal_tower_e", &ihcal_tower_e[0][0], n_hcal_tower, "ihcal_tower_e[24][64]/F", ttree_bit);
+  columns.bindArray("ohcal_tower_e", &ohcal_tower_e[0][0], n_hcal_tower, "ohcal_tower_e[24][64]/F", ttree_bit);
 }
 
 ////////// ********** Fill functions ********** //////////
-void caloTreeGen::Fill_calo_tower(PHCompositeNode *topNode, std::string calorimeter) 
-{
-    std::string tower_info_container_name = "TOWERINFO_CALIB_" + calorimeter;
-    TowerInfoContainer *_towers_calo = findNode::getClass<TowerInfoContainer>(topNode, tower_info_container_name);
-    
-    if (_towers_calo) 
-    {
-        for (int channel = 0; channel < (int)_towers_calo->size(); ++channel) 
-        {
-        	TowerInfo *_tower = _towers_calo->get_tower_at_channel(channel);
-        	
-            unsigned int towerkey = _towers_calo->encode_key(channel);
-        	int etabin = _towers_calo->getTowerEtaBin(towerkey);
-        	int phibin = _towers_calo->getTowerPhiBin(towerkey);
-            
-            float towE = _tower->get_energy();
-            if (calorimeter == "HCALIN") 
-            {
-                ihcal_tower_e[etabin][phibin] = towE;   
-            } 
-            else if (calorimeter == "HCALOUT") 
-            {
-                ohcal_tower_e[etabin][phibin] = towE;
-            }
+bool caloTreeGen::Resolve_calo_tower(PHCompositeNode *topNode, Calorimeter calo, int neta, int nphi) {
+  const char *names[kNCalorimeters] = {"CEMC", "HCALIN", "HCALOUT"};
+  const std::string tower_info_container_name = std::string("TOWERINFO_CALIB_") + names[calo];
+  towers[calo] = findNode::getClass<TowerInfoContainer>(topNode, tower_info_container_name);
+  tower_bin[calo].clear();
+  if (!towers[calo]) {
+    std::cout << "TowerInfoContainer for " << names[calo] << " is missing" << std::endl;
+    return false;
+  }
+
+  // The key decoding is done here once instead of per channel and event.
+  for (unsigned int channel = 0; channel < towers[calo]->size(); ++channel) {
+    unsigned int towerkey = towers[calo]->encode_key(channel);
+    int etabin = towers[calo]->getTowerEtaBin(towerkey);
+    int phibin = towers[calo]->getTowerPhiBin(towerkey);
+    if (etabin < 0 || etabin >= neta || phibin < 0 || phibin >= nphi) {
+      std::cout << "TowerInfoContainer for " << names[calo] << ": channel " << channel << " is outside the " << neta << "x" << nphi << " image" << std::endl;
+      towers[calo] = nullptr;
+      tower_bin[calo].clear();
+      return false;
+    }
+    tower_bin[calo].push_back(etabin * nphi + phibin);
+  }
+  return true;
+}
+
+////////// ********** Image functions ********** //////////
+void caloTreeGen::Open_images() {
+  const NpyWriter::DType dtype = image_float16 ? NpyWriter::kFloat16 : NpyWriter::kFloat32;
+  const char *names[3] = {"emcal", "ihcal", "ohcal"};
+  const std::size_t neta[3] = {n_emcal_tower_etabin, n_hcal_tower_etabin, n_hcal_tower_etabin};
+  const std::size_t nphi[3] = {n_emcal_tower_phibin, n_hcal_tower_phibin, n_hcal_tower_phibin};
+  bool ok = true;
+  bool any_crop = false;
+  for (int i = 0; i < 3; i++) {
+    ok &= images[i].open(image_prefix + "_" + names[i] + "_image.npy", dtype, {neta[i], nphi[i]});
+    if (crop_size[i] > 0) {
+      ok &= crops[i].open(image_prefix + "_" + names[i] + "_crop.npy", dtype, {(std::size_t) crop_size[i], (std::size_t) crop_size[i]});
+      any_crop = true;
+    }
+  }
+  if (any_crop) ok &= crop_index.open(image_prefix + "_crop_index.npy", NpyWriter::kInt32, {2});
+  if (!ok) {
+    std::cout << "caloTreeGen::Open_images - cannot write the images to " << image_prefix << "_*.npy, images are disabled" << std::endl;
+    for (int i = 0; i < 3; i++) {
+      images[i].close();
+      crops[i].close();
+    }
+    crop_index.close();
+  }
+}
+
+void caloTreeGen::Fill_track_crops(PHCompositeNode *topNode) {
+  SvtxTrackMap *trackmap = findNode::getClass<SvtxTrackMap>(topNode, "SvtxTrackMap");
+  RawTowerGeomContainer *geom[3] = {
+      findNode::getClass<RawTowerGeomContainer>(topNode, "TOWERGEOM_CEMC"),
+      findNode::getClass<RawTowerGeomContainer>(topNode, "TOWERGEOM_HCALIN"),
+      findNode::getClass<RawTowerGeomContainer>(topNode, "TOWERGEOM_HCALOUT")};
+  if (!trackmap || !geom[0] || !geom[1] || !geom[2]) {
+    if (verbosity > 0) std::cout << "caloTreeGen::Fill_track_crops - SvtxTrackMap or a TOWERGEOM node is missing" << std::endl;
+    return;
+  }
+
+  const float *image[3] = {&emcal_tower_e[0][0], &ihcal_tower_e[0][0], &ohcal_tower_e[0][0]};
+  const int neta[3] = {n_emcal_tower_etabin, n_hcal_tower_etabin, n_hcal_tower_etabin};
+  const int nphi[3] = {n_emcal_tower_phibin, n_hcal_tower_phibin, n_hcal_tower_phibin};
+
+  for (const auto &entry : *trackmap) {
+    SvtxTrack *track = entry.second;
+    if (!track || track->get_pt() < crop_min_pt) continue;
+    // Every crop row needs the EMCal projection; the HCal crops fall back to it.
+    SvtxTrackState *emcal_state = track->get_state(geom[0]->get_radius());
+    if (!emcal_state) continue;
+
+    // Centers of all crops first, so that a track is written to every crop file or to none.
+    int ieta0[3] = {0, 0, 0};
+    int iphi0[3] = {0, 0, 0};
+    bool projected = true;
+    for (int i = 0; i < 3 && projected; i++) {
+      if (crop_size[i] <= 0) continue;
+      SvtxTrackState *state = i == 0 ? emcal_state : track->get_state(geom[i]->get_radius());
+      if (!state) state = emcal_state;
+      float phi = std::atan2(state->get_y(), state->get_x());
+      float eta = std::asinh(state->get_z() / std::hypot(state->get_x(), state->get_y()));
+      projected = inAcceptance(geom[i], eta, phi);
+      if (!projected) break;
+      ieta0[i] = geom[i]->get_etabin(eta) - crop_size[i] / 2;
+      iphi0[i] = geom[i]->get_phibin(phi) - crop_size[i] / 2;
+    }
+    if (!projected) continue;
+
+    for (int i = 0; i < 3; i++) {
+      if (crop_size[i] <= 0) continue;
+      // Eta outside the calorimeter is zero, phi wraps around.
+      crop_buffer.assign(crop_size[i] * crop_size[i], 0);
+      for (int de = 0; de < crop_size[i]; de++) {
+        int ieta = ieta0[i] + de;
+        if (ieta < 0 || ieta >= neta[i]) continue;
+        for (int dp = 0; dp < crop_size[i]; dp++) {
+          int iphi = ((iphi0[i] + dp) % nphi[i] + nphi[i]) % nphi[i];
+          crop_buffer[de * crop_size[i] + dp] = image[i][ieta * nphi[i] + iphi];
         }
-    } 
-    else 
-    { 
-        std::cout << "TowerInfoContainer for " << calorimeter << " is missing" << std::endl;
+      }
+      crops[i].append(crop_buffer.data());
     }
-}
\ No newline at end of file
+    int index[2] = {ievent, (int) entry.first};
+    crop_index.append(index);
+  }
+}
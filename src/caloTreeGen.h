@@ -11,13 +11,21 @@
 #include <TTree.h> 
 
 #include <fun4all/SubsysReco.h>
+#include <calobase/TowerInfo.h>
 #include <calobase/TowerInfoContainer.h>
 #include <calobase/TowerInfoContainerv1.h>
 #include <calobase/TowerInfoContainerv2.h>
 #include <calobase/TowerInfoContainerv3.h>
 #include <calobase/TowerInfoContainerv4.h>
 
+#include "AsyncTreeWriter.h"
+#include "NpyWriter.h"
+#include "OutputFileOptions.h"
+#include "TreeColumnRegistry.h"
+
 class PHCompositeNode;
+class RawTowerGeomContainer;
+class SvtxTrack;
 
 class caloTreeGen : public SubsysReco
 {
@@ -25,16 +33,35 @@ class caloTreeGen : public SubsysReco
   caloTreeGen(const std::string &name = "caloTreeGen", const std::string &outfilename = "output.root");
   ~caloTreeGen() override = default;
   int Init(PHCompositeNode *topNode) override;
+  int InitRun(PHCompositeNode *topNode) override;
   int process_event(PHCompositeNode *topNode) override;
   int ResetEvent(PHCompositeNode *topNode) override;
   int End(PHCompositeNode *topNode) override;
 
   // ********** Setters ********** //
   void SetVerbosity(int verbo) {verbosity = verbo;}
+  // Fill the tree on a background thread with up to depth events in flight; 0 fills in process_event.
+  void SetOutputQueueDepth(unsigned int depth) {writer.setDepth(depth);}
+  // Output file tuning: compression (ROOT::RCompressionSetting::EAlgorithm, level), basket sizes, TTree::SetAutoFlush/SetAutoSave.
+  void SetCompression(int algorithm, int level) {file_options.setCompression(algorithm, level);}
+  void SetBasketSize(const std::string &pattern, int bytes) {file_options.setBasketSize(pattern, bytes);}
+  void SetAutoFlush(long long value) {file_options.setAutoFlush(value);}
+  void SetAutoSave(long long value) {file_options.setAutoSave(value);}
+  // Calorimeter images as .npy files <prefix>_{emcal,ihcal,ohcal}_image.npy of shape (events, eta, phi), float16 or float32.
+  void SetImageOutput(const std::string &prefix, bool float16 = false) {image_prefix = prefix; image_float16 = float16;}
+  // Per-track crops of the images, centred on the track projection; size in towers (odd), 0 disables. Needs SetImageOutput.
+  void SetTrackCrops(int emcal_size, int hcal_size) {crop_size[0] = emcal_size; crop_size[1] = crop_size[2] = hcal_size;}
+  void SetTrackCropMinPt(float pt) {crop_min_pt = pt;}
 
   // ********** Functions ********** //
+  enum Calorimeter {kCEMC = 0, kHCALIN = 1, kHCALOUT = 2, kNCalorimeters = 3};
   void Initialize_calo_tower();
-  void Fill_calo_tower(PHCompositeNode *topNode, std::string calorimeter);
+  bool Resolve_calo_tower(PHCompositeNode *topNode, Calorimeter calo, int neta, int nphi);
+  // Copy the tower energies of calo into its (eta, phi) image; the channel -> bin table comes from InitRun.
+  template <int NETA, int NPHI>
+  void Fill_calo_tower(Calorimeter calo, float (&energy)[NETA][NPHI]);
+  void Open_images();
+  void Fill_track_crops(PHCompositeNode *topNode);
 
  private:
   // ********** General variables ********** //
@@ -49,11 +76,52 @@ class caloTreeGen : public SubsysReco
   static const int n_hcal_tower = 1536;
   static const int n_hcal_tower_etabin = 24;
   static const int n_hcal_tower_phibin = 64;
+  static const int n_emcal_tower_etabin = 96;
+  static const int n_emcal_tower_phibin = 256;
+  static const unsigned int ttree_bit = 1;
 
   // ********** Tree variables ********** //
   // Tower information.
   float ihcal_tower_e[n_hcal_tower_etabin][n_hcal_tower_phibin]{};
   float ohcal_tower_e[n_hcal_tower_etabin][n_hcal_tower_phibin]{};
+  // Only written to the images.
+  float emcal_tower_e[n_emcal_tower_etabin][n_emcal_tower_phibin]{};
+
+  // ********** Output ********** //
+  TreeColumnRegistry columns;
+  AsyncTreeWriter writer{columns};
+  OutputFileOptions file_options;
+  int tree_output{-1};
+
+  // ********** Towers ********** //
+  // Resolved once per run, indexed by Calorimeter.
+  TowerInfoContainer *towers[kNCalorimeters]{nullptr, nullptr, nullptr};
+  std::vector<int> tower_bin[kNCalorimeters];  // flat ieta * nphi + iphi of every channel
+
+  // ********** Images ********** //
+  // Index 0, 1, 2: CEMC, HCALIN, HCALOUT.
+  std::string image_prefix;
+  bool image_float16{false};
+  NpyWriter images[3];
+  NpyWriter crops[3];
+  NpyWriter crop_index;  // (event, track id) of every crop
+  int crop_size[3]{0, 0, 0};
+  float crop_min_pt{0.5};
+  std::vector<float> crop_buffer;
 };
 
+template <int NETA, int NPHI>
+void caloTreeGen::Fill_calo_tower(Calorimeter calo, float (&energy)[NETA][NPHI])
+{
+  TowerInfoContainer *container = towers[calo];
+  if (!container) return;
+  float *image = &energy[0][0];
+  const int *bin = tower_bin[calo].data();
+  const int n = tower_bin[calo].size();
+  for (int channel = 0; channel < n; ++channel)
+  {
+    image[bin[channel]] = container->get_tower_at_channel(channel)->get_energy();
+  }
+}
+
 #endif
\ No newline at end of file